@@ -0,0 +1,408 @@
+#include "Benchmark.h"
+#include "Vulkan/VulkanRenderer.h"
+#include "Vulkan/VulkanTexture.h"
+#include "Utilities.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	// Textures shipped in res/textures, objects cycle through the first textureCount of them
+	const std::vector<std::string> BenchmarkTextures = { "brick_0.jpg", "volcanic_rock_0.jpg" };
+
+	const float CubeSpacing = 2.0f;
+	const float QuadSize = 10.0f;
+
+	// Stands in for a large imported mesh, a grid of unit size in the xy plane like the quad primitive with a gentle swell
+	void MakeTerrain(const uint32_t _resolution, std::vector<Vertex>& _vertices, std::vector<uint32_t>& _indices)
+	{
+		const float step = 1.0f / static_cast<float>(_resolution - 1);
+		_vertices.reserve(static_cast<size_t>(_resolution) * _resolution);
+		_indices.reserve(static_cast<size_t>(_resolution - 1) * (_resolution - 1) * 6);
+
+		for (uint32_t y = 0; y < _resolution; ++y)
+		{
+			for (uint32_t x = 0; x < _resolution; ++x)
+			{
+				const glm::vec2 uv(x * step, y * step);
+				const float height = 0.05f * std::sin(uv.x * 20.0f) * std::cos(uv.y * 20.0f);
+				_vertices.emplace_back(glm::vec3(uv.x - 0.5f, uv.y - 0.5f, height), glm::vec3(1.0f), uv);
+			}
+		}
+
+		// Two triangles per cell, wound like the quad primitive
+		for (uint32_t y = 0; y + 1 < _resolution; ++y)
+		{
+			for (uint32_t x = 0; x + 1 < _resolution; ++x)
+			{
+				const uint32_t corner = y * _resolution + x;
+				_indices.insert(_indices.end(), { corner, corner + 1, corner + _resolution + 1, corner, corner + _resolution + 1, corner + _resolution });
+			}
+		}
+	}
+
+	void WriteSummary(std::ofstream& _file, const char* _name, const FrameTimeSummary& _summary, const size_t _sampleCount, const bool _isLast)
+	{
+		_file << "\t\"" << _name << "\": {\n";
+		_file << "\t\t\"samples\": " << _sampleCount << ",\n";
+		_file << "\t\t\"mean\": " << _summary.mean << ",\n";
+		_file << "\t\t\"min\": " << _summary.min << ",\n";
+		_file << "\t\t\"max\": " << _summary.max << ",\n";
+		_file << "\t\t\"p50\": " << _summary.p50 << ",\n";
+		_file << "\t\t\"p95\": " << _summary.p95 << ",\n";
+		_file << "\t\t\"p99\": " << _summary.p99 << "\n";
+		_file << "\t}" << (_isLast ? "\n" : ",\n");
+	}
+}
+
+Benchmark::Benchmark(const BenchmarkSettings& _settings) :
+	m_Settings(_settings),
+	m_SceneRadius(1.0f)
+{
+	m_Settings.textureCount = std::clamp(m_Settings.textureCount, 1u, static_cast<uint32_t>(BenchmarkTextures.size()));
+}
+
+bool Benchmark::IsRequested(int _argc, char* _argv[])
+{
+	for (int i = 1; i < _argc; ++i)
+	{
+		if (std::string(_argv[i]) == "--benchmark") return true;
+	}
+
+	return false;
+}
+
+BenchmarkSettings Benchmark::ParseArguments(int _argc, char* _argv[])
+{
+	BenchmarkSettings settings{};
+
+	for (int i = 1; i < _argc; ++i)
+	{
+		const std::string argument = _argv[i];
+		const bool hasValue = i + 1 < _argc;
+
+		if (argument == "--benchmark") continue;
+		else if (argument == "--cubes" && hasValue) settings.cubeCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--quads" && hasValue) settings.quadCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--textures" && hasValue) settings.textureCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--terrain" && hasValue) settings.terrainResolution = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--frames" && hasValue) settings.frameCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--warmup" && hasValue) settings.warmupFrameCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--width" && hasValue) settings.width = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--height" && hasValue) settings.height = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--output" && hasValue) settings.outputFile = _argv[++i];
+		else if (argument == "--threads" && hasValue) settings.threadCount = std::max(1u, static_cast<uint32_t>(std::stoul(_argv[++i])));
+		else if (argument == "--thread-scaling") settings.threadScaling = true;
+		else if (argument == "--decode-threads" && hasValue) settings.decodeThreadCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--gpu-culling") settings.gpuCulling = true;
+		else if (argument == "--no-frustum-culling") settings.frustumCulling = false;
+		else if (argument == "--no-bvh") settings.bvhCulling = false;
+		else if (argument == "--no-occlusion-culling") settings.occlusionCulling = false;
+		else if (argument == "--keep-mesh-data") settings.keepMeshData = true;
+		else if (argument == "--compact-vertices") settings.compactVertices = true;
+		else if (argument == "--no-mipmaps") settings.textureMipmaps = false;
+		else if (argument == "--source-textures") settings.cookedTextures = false;
+		else if (argument == "--no-texture-streaming") settings.textureStreaming = false;
+		else if (argument == "--texture-budget" && hasValue) settings.textureBudget = static_cast<uint64_t>(std::stoull(_argv[++i])) * 1024 * 1024;
+		else throw std::runtime_error("BENCHMARK ERROR: Unknown or incomplete argument " + argument + "\n");
+	}
+
+	return settings;
+}
+
+void Benchmark::Run()
+{
+	const BenchmarkRun run = RunPass(m_Settings.threadCount);
+
+	// Same scene and camera path at doubling thread counts, to show how recording scales
+	std::vector<BenchmarkRun> scalingRuns;
+
+	if (m_Settings.threadScaling)
+	{
+		for (uint32_t threadCount = 1; threadCount <= m_Settings.threadCount; threadCount *= 2)
+		{
+			std::cout << "Benchmark: measuring " << threadCount << " recording thread(s)\n";
+			scalingRuns.emplace_back(RunPass(threadCount));
+		}
+	}
+
+	WriteResults(run, scalingRuns);
+}
+
+BenchmarkRun Benchmark::RunPass(const uint32_t _threadCount)
+{
+	RendererSettings rendererSettings{};
+	rendererSettings.headless = true;
+	rendererSettings.width = m_Settings.width;
+	rendererSettings.height = m_Settings.height;
+	rendererSettings.recordThreadCount = _threadCount;
+	rendererSettings.textureDecodeThreadCount = m_Settings.decodeThreadCount;
+	rendererSettings.gpuCulling = m_Settings.gpuCulling;
+	rendererSettings.frustumCulling = m_Settings.frustumCulling;
+	rendererSettings.bvhCulling = m_Settings.bvhCulling;
+	rendererSettings.occlusionCulling = m_Settings.occlusionCulling;
+	rendererSettings.keepMeshData = m_Settings.keepMeshData;
+	rendererSettings.vertexFormat = m_Settings.compactVertices ? VertexFormat::Compact : VertexFormat::Full;
+	rendererSettings.textureMipmaps = m_Settings.textureMipmaps;
+	rendererSettings.cookedTextures = m_Settings.cookedTextures;
+	rendererSettings.textureStreaming = m_Settings.textureStreaming;
+	rendererSettings.textureBudget = m_Settings.textureBudget;
+
+	VulkanRenderer renderer(nullptr, rendererSettings);
+	renderer.GetCamera().SetInputEnabled(false);
+
+	BenchmarkRun run{};
+	run.residentBytesBeforeScene = Utilities::GetResidentMemory();
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+	BuildScene(renderer);
+	const auto loadEnd = std::chrono::high_resolution_clock::now();
+	run.sceneLoadTime = std::chrono::duration<double, std::milli>(loadEnd - loadStart).count();
+	run.residentBytesAfterScene = Utilities::GetResidentMemory();
+	run.decodeThreadCount = renderer.GetSettings().textureDecodeThreadCount;
+	run.textureBytes = VulkanTexture::GetResidentBytes();
+	run.blitMipmaps = VulkanTexture::BlitsMipmaps();
+	run.compressedTextures = VulkanTexture::GetCompressedCount();
+	run.textureStreaming = VulkanTexture::IsStreaming();
+	run.meshMemoryStats = VulkanMeshRegistry::GetMemoryStats();
+
+	run.threadCount = _threadCount;
+	run.gpuCulling = renderer.GetSettings().gpuCulling;
+	run.occlusionCulling = renderer.GetSettings().occlusionCulling;
+	run.cpuFrameTimes.reserve(m_Settings.frameCount);
+	run.gpuFrameTimes.reserve(m_Settings.frameCount);
+	run.recordTimes.reserve(m_Settings.frameCount);
+
+	const uint32_t totalFrames = m_Settings.warmupFrameCount + m_Settings.frameCount;
+
+	for (uint32_t frame = 0; frame < totalFrames; ++frame)
+	{
+		// The camera path only depends on the frame number so every run sees the same views
+		UpdateCameraPath(renderer.GetCamera(), frame);
+
+		const auto frameStart = std::chrono::high_resolution_clock::now();
+		renderer.Draw();
+		const auto frameEnd = std::chrono::high_resolution_clock::now();
+
+		if (frame < m_Settings.warmupFrameCount) continue;
+
+		run.cpuFrameTimes.emplace_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+
+		const RendererStats stats = renderer.GetStats();
+		if (stats.gpuTimeValid) run.gpuFrameTimes.emplace_back(stats.gpuFrameTime);
+		run.recordTimes.emplace_back(stats.cpuRecordTime);
+		run.visibleObjects += stats.visibleObjects;
+		run.culledObjects += stats.culledObjects;
+		run.occludedObjects += stats.occludedObjects;
+		run.occludedTriangles += stats.occludedTriangles;
+	}
+
+	run.memoryStats = VulkanUtilities::GetMemoryStats();
+	run.stagingStats = VulkanUtilities::GetStagingStats();
+	run.streamedTextureBytes = VulkanTexture::GetResidentBytes();
+	run.streamingStats = VulkanTexture::GetStreamingStats();
+	return run;
+}
+
+void Benchmark::BuildScene(VulkanRenderer& _renderer)
+{
+	Scene scene;
+
+	// Cubes on a square grid centred on the origin
+	const uint32_t cubesPerRow = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_Settings.cubeCount)))));
+	const float gridOffset = (cubesPerRow - 1) * CubeSpacing * 0.5f;
+
+	for (uint32_t i = 0; i < m_Settings.cubeCount; ++i)
+	{
+		const glm::vec3 position((i % cubesPerRow) * CubeSpacing - gridOffset, 0.0f, (i / cubesPerRow) * CubeSpacing - gridOffset);
+		scene.CreateRenderable(VulkanPrimative::Primative::Cube, BenchmarkTextures[i % m_Settings.textureCount], position, glm::vec3(0.0f, (i % 7) * 0.25f, 0.0f));
+	}
+
+	// Ground quads tiled beneath the cubes
+	const uint32_t quadsPerRow = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_Settings.quadCount)))));
+	const float quadOffset = (quadsPerRow - 1) * QuadSize * 0.5f;
+
+	for (uint32_t i = 0; i < m_Settings.quadCount; ++i)
+	{
+		const glm::vec3 position((i % quadsPerRow) * QuadSize - quadOffset, 0.5f, (i / quadsPerRow) * QuadSize - quadOffset);
+		scene.CreateRenderable(VulkanPrimative::Primative::Quad, BenchmarkTextures[(i + 1) % m_Settings.textureCount], position, glm::vec3(1.57f, 0.0f, 0.0f), glm::vec3(QuadSize, QuadSize, 1.0f));
+	}
+
+	m_SceneRadius = std::max(gridOffset, quadOffset) + QuadSize * 0.5f;
+
+	// One large mesh spanning the scene just below the ground, what happens to its CPU copy shows in the host memory report
+	if (m_Settings.terrainResolution >= 2)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		MakeTerrain(m_Settings.terrainResolution, vertices, indices);
+
+		const MeshId terrain = VulkanMeshRegistry::Acquire("benchmark:terrain", std::move(vertices), std::move(indices));
+		const float terrainSize = m_SceneRadius * 2.0f;
+		scene.CreateRenderable(terrain, BenchmarkTextures[0], glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.57f, 0.0f, 0.0f), glm::vec3(terrainSize, terrainSize, 1.0f));
+	}
+
+	_renderer.SetScene(std::move(scene));
+}
+
+void Benchmark::UpdateCameraPath(Camera& _camera, const uint32_t _frame)
+{
+	// One full orbit around the scene over the measured frames, bobbing up and down twice. Warmup frames hold the
+	// start pose, so runs with different warmup lengths still measure the same views
+	const uint32_t measuredFrame = _frame < m_Settings.warmupFrameCount ? 0 : _frame - m_Settings.warmupFrameCount;
+	const float progress = static_cast<float>(measuredFrame) / static_cast<float>(std::max(1u, m_Settings.frameCount));
+	const float angle = progress * glm::two_pi<float>();
+
+	const glm::vec3 position(std::cos(angle) * m_SceneRadius, -m_SceneRadius * (0.35f + 0.15f * std::sin(angle * 2.0f)), std::sin(angle) * m_SceneRadius);
+	const glm::vec3 target(0.0f);
+
+	_camera.SetView(position, glm::normalize(target - position));
+}
+
+FrameTimeSummary Benchmark::Summarize(std::vector<double> _frameTimes)
+{
+	FrameTimeSummary summary{};
+	if (_frameTimes.empty()) return summary;
+
+	std::sort(_frameTimes.begin(), _frameTimes.end());
+
+	// Nearest-rank percentile
+	auto percentile = [&_frameTimes](const double _percent)
+	{
+		const size_t rank = static_cast<size_t>(std::ceil(_percent / 100.0 * _frameTimes.size()));
+		return _frameTimes[std::clamp(rank, static_cast<size_t>(1), _frameTimes.size()) - 1];
+	};
+
+	double total = 0.0;
+	for (const double frameTime : _frameTimes) total += frameTime;
+
+	summary.mean = total / _frameTimes.size();
+	summary.min = _frameTimes.front();
+	summary.max = _frameTimes.back();
+	summary.p50 = percentile(50.0);
+	summary.p95 = percentile(95.0);
+	summary.p99 = percentile(99.0);
+	return summary;
+}
+
+void Benchmark::WriteResults(const BenchmarkRun& _run, const std::vector<BenchmarkRun>& _scalingRuns)
+{
+	std::ofstream file(m_Settings.outputFile);
+
+	if (!file.is_open())
+	{
+		throw std::runtime_error("BENCHMARK ERROR: Failed to open " + m_Settings.outputFile + "\n");
+	}
+
+	const MemoryStats& memoryStats = _run.memoryStats;
+	const StagingStats& stagingStats = _run.stagingStats;
+
+	file << "{\n";
+	file << "\t\"scene\": {\n";
+	file << "\t\t\"cubes\": " << m_Settings.cubeCount << ",\n";
+	file << "\t\t\"quads\": " << m_Settings.quadCount << ",\n";
+	file << "\t\t\"textures\": " << m_Settings.textureCount << ",\n";
+	file << "\t\t\"terrainResolution\": " << m_Settings.terrainResolution << ",\n";
+	file << "\t\t\"frames\": " << m_Settings.frameCount << ",\n";
+	file << "\t\t\"warmupFrames\": " << m_Settings.warmupFrameCount << ",\n";
+	file << "\t\t\"width\": " << m_Settings.width << ",\n";
+	file << "\t\t\"height\": " << m_Settings.height << ",\n";
+	file << "\t\t\"threads\": " << _run.threadCount << ",\n";
+	file << "\t\t\"gpuCulling\": " << (_run.gpuCulling ? "true" : "false") << ",\n";
+	file << "\t\t\"frustumCulling\": " << (m_Settings.frustumCulling ? "true" : "false") << ",\n";
+	file << "\t\t\"bvhCulling\": " << (m_Settings.bvhCulling ? "true" : "false") << ",\n";
+	file << "\t\t\"occlusionCulling\": " << (_run.occlusionCulling ? "true" : "false") << ",\n";
+	file << "\t\t\"compactVertices\": " << (m_Settings.compactVertices ? "true" : "false") << ",\n";
+	file << "\t\t\"textureMipmaps\": " << (m_Settings.textureMipmaps ? "true" : "false") << ",\n";
+	file << "\t\t\"cookedTextures\": " << (m_Settings.cookedTextures ? "true" : "false") << "\n";
+	file << "\t},\n";
+
+	const double measuredFrames = static_cast<double>(std::max<size_t>(1, _run.cpuFrameTimes.size()));
+	file << "\t\"culling\": {\n";
+	file << "\t\t\"meanVisibleObjects\": " << static_cast<double>(_run.visibleObjects) / measuredFrames << ",\n";
+	file << "\t\t\"meanCulledObjects\": " << static_cast<double>(_run.culledObjects) / measuredFrames << ",\n";
+	file << "\t\t\"meanOccludedObjects\": " << static_cast<double>(_run.occludedObjects) / measuredFrames << ",\n";
+	file << "\t\t\"meanOccludedTriangles\": " << static_cast<double>(_run.occludedTriangles) / measuredFrames << "\n";
+	file << "\t},\n";
+
+	WriteSummary(file, "cpuFrameTimeMs", Summarize(_run.cpuFrameTimes), _run.cpuFrameTimes.size(), false);
+	WriteSummary(file, "gpuFrameTimeMs", Summarize(_run.gpuFrameTimes), _run.gpuFrameTimes.size(), false);
+	WriteSummary(file, "cpuRecordTimeMs", Summarize(_run.recordTimes), _run.recordTimes.size(), false);
+
+	file << "\t\"deviceMemory\": {\n";
+	file << "\t\t\"allocationCount\": " << memoryStats.allocationCount << ",\n";
+	file << "\t\t\"totalAllocations\": " << memoryStats.totalAllocations << ",\n";
+	file << "\t\t\"bytesAllocated\": " << memoryStats.bytesAllocated << ",\n";
+	file << "\t\t\"bytesInUse\": " << memoryStats.bytesInUse << ",\n";
+	file << "\t\t\"resourceCount\": " << memoryStats.resourceCount << ",\n";
+	file << "\t\t\"blockCount\": " << memoryStats.blockCount << ",\n";
+	file << "\t\t\"freeRangeCount\": " << memoryStats.freeRangeCount << ",\n";
+	file << "\t\t\"largestFreeRange\": " << memoryStats.largestFreeRange << ",\n";
+	file << "\t\t\"fragmentation\": " << memoryStats.fragmentation << "\n";
+	file << "\t},\n";
+
+	file << "\t\"staging\": {\n";
+	file << "\t\t\"capacity\": " << stagingStats.capacity << ",\n";
+	file << "\t\t\"totalBytes\": " << stagingStats.totalBytes << ",\n";
+	file << "\t\t\"stallCount\": " << stagingStats.stallCount << ",\n";
+	file << "\t\t\"fallbackCount\": " << stagingStats.fallbackCount << "\n";
+	file << "\t},\n";
+
+	// Compare the default against --decode-threads 1 to see how much of the load was serial texture decode, and against
+	// --source-textures to see what cooking saved
+	file << "\t\"loading\": {\n";
+	file << "\t\t\"decodeThreads\": " << _run.decodeThreadCount << ",\n";
+	file << "\t\t\"sceneLoadMs\": " << _run.sceneLoadTime << "\n";
+	file << "\t},\n";
+
+	// The texture cache can't be queried portably, compare gpuFrameTimeMs against a --no-mipmaps run for its effect
+	file << "\t\"textures\": {\n";
+	file << "\t\t\"residentBytes\": " << _run.textureBytes << ",\n";
+	file << "\t\t\"mipmapsBlitted\": " << (_run.blitMipmaps ? "true" : "false") << ",\n";
+	file << "\t\t\"compressedTextures\": " << _run.compressedTextures << "\n";
+	file << "\t},\n";
+
+	// residentBytes above is what the scene loaded with, with streaming on that's only the small levels. Compare against
+	// --no-texture-streaming for the memory saved and a small --texture-budget for evictions
+	file << "\t\"streaming\": {\n";
+	file << "\t\t\"enabled\": " << (_run.textureStreaming ? "true" : "false") << ",\n";
+	file << "\t\t\"budgetBytes\": " << _run.streamingStats.budgetBytes << ",\n";
+	file << "\t\t\"residentBytesAfterFrames\": " << _run.streamedTextureBytes << ",\n";
+	file << "\t\t\"streamedLoads\": " << _run.streamingStats.streamedLoads << ",\n";
+	file << "\t\t\"evictions\": " << _run.streamingStats.evictions << "\n";
+	file << "\t},\n";
+
+	// Compare runs with and without --keep-mesh-data to see the resident memory saved by dropping mesh copies
+	file << "\t\"hostMemory\": {\n";
+	file << "\t\t\"keepMeshData\": " << (m_Settings.keepMeshData ? "true" : "false") << ",\n";
+	file << "\t\t\"residentBytesBeforeScene\": " << _run.residentBytesBeforeScene << ",\n";
+	file << "\t\t\"residentBytesAfterScene\": " << _run.residentBytesAfterScene << ",\n";
+	file << "\t\t\"meshCpuBytes\": " << _run.meshMemoryStats.cpuBytes << ",\n";
+	file << "\t\t\"meshCpuBytesReleased\": " << _run.meshMemoryStats.releasedCpuBytes << "\n";
+	file << "\t}" << (_scalingRuns.empty() ? "\n" : ",\n");
+
+	if (!_scalingRuns.empty())
+	{
+		file << "\t\"threadScaling\": [\n";
+
+		for (size_t i = 0; i < _scalingRuns.size(); ++i)
+		{
+			const FrameTimeSummary frameTime = Summarize(_scalingRuns[i].cpuFrameTimes);
+			const FrameTimeSummary recordTime = Summarize(_scalingRuns[i].recordTimes);
+
+			file << "\t\t{ \"threads\": " << _scalingRuns[i].threadCount;
+			file << ", \"cpuFrameTimeMeanMs\": " << frameTime.mean << ", \"cpuFrameTimeP95Ms\": " << frameTime.p95;
+			file << ", \"cpuRecordTimeMeanMs\": " << recordTime.mean << ", \"cpuRecordTimeP95Ms\": " << recordTime.p95 << " }";
+			file << (i + 1 < _scalingRuns.size() ? ",\n" : "\n");
+		}
+
+		file << "\t]\n";
+	}
+
+	file << "}\n";
+
+	std::cout << "Benchmark results written to " << m_Settings.outputFile << '\n';
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Vulkan/VulkanUtilities.h"
+#include "Vulkan/VulkanMeshRegistry.h"
+#include "Vulkan/VulkanTexture.h"
+
+class VulkanRenderer;
+class Camera;
+
+struct BenchmarkSettings
+{
+	uint32_t cubeCount = 1000;					// Number of cubes laid out on a grid
+	uint32_t quadCount = 16;					// Number of ground quads tiled under the cubes
+	uint32_t textureCount = 2;					// Number of distinct textures spread over the objects
+	uint32_t terrainResolution = 0;				// Vertices along each side of a terrain mesh under the scene, 0 for none
+	uint32_t frameCount = 1000;					// Number of measured frames
+	uint32_t warmupFrameCount = 60;				// Frames rendered before measuring starts
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	uint32_t threadCount = 1;					// Threads recording draw commands
+	uint32_t decodeThreadCount = 0;				// Workers decoding textures, 0 for every spare hardware thread
+	bool threadScaling = false;					// Also measure 1, 2, 4, ... threads up to threadCount
+	bool gpuCulling = false;					// Cull and build draws in a compute pass
+	bool frustumCulling = true;					// Cull object bounds on the CPU before drawing
+	bool bvhCulling = true;						// Cull through the scene BVH rather than a linear pass
+	bool occlusionCulling = true;				// Test GPU culled objects against a depth pyramid
+	bool keepMeshData = false;					// Keep CPU copies of mesh geometry after upload
+	bool compactVertices = false;				// Store vertices quantized to 16 bytes instead of 32
+	bool textureMipmaps = true;					// Generate mip chains for loaded textures
+	bool cookedTextures = true;					// Prefer cooked KTX2 files over decoding the source images
+	bool textureStreaming = true;				// Stream mip levels by screen size instead of loading whole chains
+	uint64_t textureBudget = 0;					// Bytes streaming may keep resident, 0 follows the device's memory budget
+	std::string outputFile = "benchmark.json";
+};
+
+struct FrameTimeSummary
+{
+	double mean = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+};
+
+struct BenchmarkRun
+{
+	uint32_t threadCount = 1;
+	bool gpuCulling = false;		// Whether the renderer actually used GPU culling, it falls back without device support
+	bool occlusionCulling = false;	// Likewise, it needs GPU culling
+	std::vector<double> cpuFrameTimes;
+	std::vector<double> gpuFrameTimes;
+	std::vector<double> recordTimes;
+	uint64_t visibleObjects = 0;	// Summed over measured frames
+	uint64_t culledObjects = 0;
+	uint64_t occludedObjects = 0;	// GPU culling only
+	uint64_t occludedTriangles = 0;
+	MemoryStats memoryStats{};		// Captured before the renderer is torn down
+	StagingStats stagingStats{};
+	MeshMemoryStats meshMemoryStats{};
+	uint64_t residentBytesBeforeScene = 0;	// Host memory resident before the scene was built
+	uint64_t residentBytesAfterScene = 0;	// And once its uploads had finished
+	uint32_t decodeThreadCount = 0;			// As resolved by the renderer
+	double sceneLoadTime = 0.0;				// Building the scene until its meshes and textures were resident, in ms
+	uint64_t textureBytes = 0;				// Every resident texture level
+	bool blitMipmaps = false;				// Mip chains were blitted on the GPU rather than filtered by the decoding workers
+	uint32_t compressedTextures = 0;		// Loaded from block compressed cooked files
+	bool textureStreaming = false;			// As resolved by the renderer, it needs mipmaps
+	uint64_t streamedTextureBytes = 0;		// Resident texture levels once the measured frames are done
+	TextureStreamingStats streamingStats{};
+};
+
+class Benchmark
+{
+public:
+	Benchmark(const BenchmarkSettings& _settings);
+
+	void Run();
+	static bool IsRequested(int _argc, char* _argv[]);
+	static BenchmarkSettings ParseArguments(int _argc, char* _argv[]);
+
+private:
+	void BuildScene(VulkanRenderer& _renderer);
+	void UpdateCameraPath(Camera& _camera, const uint32_t _frame);
+	BenchmarkRun RunPass(const uint32_t _threadCount);
+	void WriteResults(const BenchmarkRun& _run, const std::vector<BenchmarkRun>& _scalingRuns);
+	static FrameTimeSummary Summarize(std::vector<double> _frameTimes);
+
+private:
+	BenchmarkSettings m_Settings;
+	float m_SceneRadius;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis aligned bounding box. Empty boxes have min > max so the first Expand sets both corners.
+struct Aabb
+{
+	glm::vec3 min{ std::numeric_limits<float>::max() };
+	glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+	bool IsEmpty() const { return min.x > max.x; }
+	glm::vec3 GetCentre() const { return (min + max) * 0.5f; }
+	glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+
+	void Expand(const glm::vec3& _point)
+	{
+		min = glm::min(min, _point);
+		max = glm::max(max, _point);
+	}
+
+	void Expand(const Aabb& _bounds)
+	{
+		min = glm::min(min, _bounds.min);
+		max = glm::max(max, _bounds.max);
+	}
+
+	bool Overlaps(const Aabb& _bounds) const
+	{
+		return min.x <= _bounds.max.x && max.x >= _bounds.min.x &&
+			   min.y <= _bounds.max.y && max.y >= _bounds.min.y &&
+			   min.z <= _bounds.max.z && max.z >= _bounds.min.z;
+	}
+
+	// Half the surface area, all the SAH needs is the ratio between boxes
+	float GetHalfArea() const
+	{
+		if (IsEmpty()) return 0.0f;
+
+		const glm::vec3 size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	bool operator==(const Aabb& _bounds) const { return min == _bounds.min && max == _bounds.max; }
+
+	// Box around the transformed box, extents are projected with the absolute matrix (Arvo) instead of transforming 8 corners
+	Aabb Transform(const glm::mat4& _matrix) const
+	{
+		if (IsEmpty()) return *this;
+
+		const glm::vec3 centre = glm::vec3(_matrix * glm::vec4(GetCentre(), 1.0f));
+		const glm::vec3 extents = GetExtents();
+		const glm::vec3 worldExtents = glm::abs(glm::vec3(_matrix[0])) * extents.x + glm::abs(glm::vec3(_matrix[1])) * extents.y + glm::abs(glm::vec3(_matrix[2])) * extents.z;
+
+		Aabb transformed;
+		transformed.min = centre - worldExtents;
+		transformed.max = centre + worldExtents;
+		return transformed;
+	}
+};
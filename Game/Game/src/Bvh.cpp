@@ -0,0 +1,430 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+
+#define BvhBinCount 16
+#define BvhMaxLeafSize 4
+#define BvhMaxSahDepth 48		// Deeper nodes are split at the median so queries can recurse safely
+#define BvhTraversalCost 1.0f	// Relative to testing one object
+#define BvhRebuildCostRatio 1.5f
+
+namespace
+{
+	struct Bin
+	{
+		Aabb bounds;
+		uint32_t count = 0;
+	};
+
+	// Slab test, returns the entry distance or infinity on a miss
+	float IntersectRay(const Aabb& _bounds, const glm::vec3& _origin, const glm::vec3& _inverseDirection, const float _maxDistance)
+	{
+		const glm::vec3 t0 = (_bounds.min - _origin) * _inverseDirection;
+		const glm::vec3 t1 = (_bounds.max - _origin) * _inverseDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+
+		const float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+		return entry <= exit && entry < _maxDistance ? entry : INFINITY;
+	}
+}
+
+void Bvh::Build(const std::vector<Aabb>& _objectBounds)
+{
+	m_ObjectBounds = _objectBounds;
+	Rebuild();
+}
+
+void Bvh::Rebuild()
+{
+	const uint32_t objectCount = static_cast<uint32_t>(m_ObjectBounds.size());
+
+	m_Nodes.clear();
+	m_Parents.clear();
+	m_ObjectIndices.clear();
+	m_DirtyLeaves.clear();
+	m_ObjectLeaves.assign(objectCount, UINT32_MAX);
+	m_Centroids.resize(objectCount);
+	m_CostSum = 0.0;
+	m_BuildCost = 0.0f;
+
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		if (m_ObjectBounds[i].IsEmpty()) continue;
+
+		m_ObjectIndices.emplace_back(i);
+		m_Centroids[i] = m_ObjectBounds[i].GetCentre();
+	}
+
+	if (m_ObjectIndices.empty()) return;
+
+	// A binary tree with single object leaves is the worst case
+	m_Nodes.reserve(m_ObjectIndices.size() * 2 - 1);
+	m_Parents.reserve(m_ObjectIndices.size() * 2 - 1);
+
+	m_Nodes.emplace_back();
+	m_Parents.emplace_back(UINT32_MAX);
+	BuildNode(0, 0, static_cast<uint32_t>(m_ObjectIndices.size()), 0);
+
+	for (const auto& node : m_Nodes)
+	{
+		m_CostSum += GetNodeCost(node);
+	}
+
+	m_BuildCost = GetCost();
+}
+
+void Bvh::Update(const uint32_t _objectIndex, const Aabb& _bounds)
+{
+	m_ObjectBounds[_objectIndex] = _bounds;
+
+	// Objects that were empty at build time only join the tree on the next rebuild
+	const uint32_t leaf = m_ObjectLeaves[_objectIndex];
+	if (leaf != UINT32_MAX) m_DirtyLeaves.emplace_back(leaf);
+}
+
+void Bvh::Refit()
+{
+	if (m_DirtyLeaves.empty()) return;
+
+	// Walking up from every leaf touches the same top nodes over and over, past a point one sweep is cheaper
+	if (m_DirtyLeaves.size() * 8 > m_Nodes.size())
+	{
+		// Children always come after their parent, so a reverse sweep refits bottom up
+		for (uint32_t i = static_cast<uint32_t>(m_Nodes.size()); i-- > 0;)
+		{
+			RefitNode(i);
+		}
+	}
+	else
+	{
+		for (const uint32_t leaf : m_DirtyLeaves)
+		{
+			// Stop as soon as a box doesn't change, nothing above it can either
+			for (uint32_t nodeIndex = leaf; nodeIndex != UINT32_MAX; nodeIndex = m_Parents[nodeIndex])
+			{
+				const Aabb previousBounds = m_Nodes[nodeIndex].bounds;
+				RefitNode(nodeIndex);
+				if (m_Nodes[nodeIndex].bounds == previousBounds) break;
+			}
+		}
+	}
+
+	m_DirtyLeaves.clear();
+}
+
+bool Bvh::NeedsRebuild() const
+{
+	return m_BuildCost > 0.0f && GetCost() > m_BuildCost * BvhRebuildCostRatio;
+}
+
+float Bvh::GetCost() const
+{
+	if (m_Nodes.empty()) return 0.0f;
+
+	const float rootArea = m_Nodes[0].bounds.GetHalfArea();
+	return rootArea > 0.0f ? static_cast<float>(m_CostSum / rootArea) : 0.0f;
+}
+
+void Bvh::QueryFrustum(const std::array<glm::vec4, 6>& _planes, std::vector<uint32_t>& _results) const
+{
+	if (!m_Nodes.empty()) QueryFrustumNode(0, _planes, (1 << 6) - 1, _results);
+}
+
+void Bvh::QueryAabb(const Aabb& _bounds, std::vector<uint32_t>& _results) const
+{
+	if (!m_Nodes.empty()) QueryAabbNode(0, _bounds, _results);
+}
+
+bool Bvh::Raycast(const glm::vec3& _origin, const glm::vec3& _direction, const float _maxDistance, RayHit& _hit) const
+{
+	_hit = RayHit();
+	_hit.distance = _maxDistance;
+
+	if (!m_Nodes.empty()) RaycastNode(0, _origin, 1.0f / _direction, _hit);
+	return _hit.objectIndex != UINT32_MAX;
+}
+
+void Bvh::BuildNode(const uint32_t _nodeIndex, const uint32_t _first, const uint32_t _count, const uint32_t _depth)
+{
+	Aabb bounds;
+
+	for (uint32_t i = _first; i < _first + _count; ++i)
+	{
+		bounds.Expand(m_ObjectBounds[m_ObjectIndices[i]]);
+	}
+
+	m_Nodes[_nodeIndex].bounds = bounds;
+	m_Nodes[_nodeIndex].rightOrFirst = _first;
+	m_Nodes[_nodeIndex].count = _count;
+
+	Split split{};
+	const bool sahSplit = _depth < BvhMaxSahDepth && FindSplit(m_Nodes[_nodeIndex], _first, _count, split);
+
+	// Leaf when the SAH finds nothing cheaper and the leaf is small enough
+	if (!sahSplit && _count <= BvhMaxLeafSize)
+	{
+		for (uint32_t i = _first; i < _first + _count; ++i)
+		{
+			m_ObjectLeaves[m_ObjectIndices[i]] = _nodeIndex;
+		}
+
+		return;
+	}
+
+	const auto begin = m_ObjectIndices.begin() + _first;
+	const auto end = begin + _count;
+	uint32_t leftCount = 0;
+
+	if (sahSplit)
+	{
+		leftCount = static_cast<uint32_t>(std::partition(begin, end, [&](const uint32_t _objectIndex)
+		{
+			const float offset = (m_Centroids[_objectIndex][split.axis] - split.centroidMin) * split.binScale;
+			return std::min(static_cast<uint32_t>(offset), BvhBinCount - 1u) <= split.lastLeftBin;
+		}) - begin);
+	}
+
+	// Too many objects for a leaf but nothing to separate them (or too deep), split the widest axis at the median
+	if (leftCount == 0 || leftCount == _count)
+	{
+		const glm::vec3 size = bounds.max - bounds.min;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+		leftCount = _count / 2;
+		std::nth_element(begin, begin + leftCount, end, [&](const uint32_t _a, const uint32_t _b)
+		{
+			return m_Centroids[_a][axis] < m_Centroids[_b][axis];
+		});
+	}
+
+	const uint32_t leftIndex = static_cast<uint32_t>(m_Nodes.size());
+	m_Nodes.emplace_back();
+	m_Parents.emplace_back(_nodeIndex);
+	BuildNode(leftIndex, _first, leftCount, _depth + 1);
+
+	const uint32_t rightIndex = static_cast<uint32_t>(m_Nodes.size());
+	m_Nodes.emplace_back();
+	m_Parents.emplace_back(_nodeIndex);
+	BuildNode(rightIndex, _first + leftCount, _count - leftCount, _depth + 1);
+
+	m_Nodes[_nodeIndex].rightOrFirst = rightIndex;
+	m_Nodes[_nodeIndex].count = 0;
+}
+
+bool Bvh::FindSplit(const BvhNode& _node, const uint32_t _first, const uint32_t _count, Split& _split) const
+{
+	if (_count < 2) return false;
+
+	Aabb centroidBounds;
+
+	for (uint32_t i = _first; i < _first + _count; ++i)
+	{
+		centroidBounds.Expand(m_Centroids[m_ObjectIndices[i]]);
+	}
+
+	// Cost of the children relative to this node, compared against testing every object in a leaf
+	float bestCost = static_cast<float>(_count) - BvhTraversalCost;
+	const float nodeArea = _node.bounds.GetHalfArea();
+	bool found = false;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f) continue;
+
+		const float binScale = BvhBinCount / extent;
+		Bin bins[BvhBinCount];
+
+		for (uint32_t i = _first; i < _first + _count; ++i)
+		{
+			const uint32_t objectIndex = m_ObjectIndices[i];
+			const float offset = (m_Centroids[objectIndex][axis] - centroidBounds.min[axis]) * binScale;
+			Bin& bin = bins[std::min(static_cast<uint32_t>(offset), BvhBinCount - 1u)];
+
+			bin.bounds.Expand(m_ObjectBounds[objectIndex]);
+			++bin.count;
+		}
+
+		// Sweep from the right to get the area and count on the right of every bin boundary
+		float rightAreas[BvhBinCount - 1];
+		uint32_t rightCounts[BvhBinCount - 1];
+		Aabb rightBounds;
+		uint32_t rightCount = 0;
+
+		for (int b = BvhBinCount - 1; b > 0; --b)
+		{
+			rightBounds.Expand(bins[b].bounds);
+			rightCount += bins[b].count;
+			rightAreas[b - 1] = rightBounds.GetHalfArea();
+			rightCounts[b - 1] = rightCount;
+		}
+
+		Aabb leftBounds;
+		uint32_t leftCount = 0;
+
+		for (uint32_t b = 0; b < BvhBinCount - 1; ++b)
+		{
+			leftBounds.Expand(bins[b].bounds);
+			leftCount += bins[b].count;
+			if (leftCount == 0 || rightCounts[b] == 0) continue;
+
+			const float cost = nodeArea > 0.0f ? (leftCount * leftBounds.GetHalfArea() + rightCounts[b] * rightAreas[b]) / nodeArea : 0.0f;
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				_split = { axis, b, centroidBounds.min[axis], binScale };
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+void Bvh::RefitNode(const uint32_t _nodeIndex)
+{
+	BvhNode& node = m_Nodes[_nodeIndex];
+	m_CostSum -= GetNodeCost(node);
+
+	if (node.count > 0)
+	{
+		node.bounds = Aabb();
+
+		for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i)
+		{
+			node.bounds.Expand(m_ObjectBounds[m_ObjectIndices[i]]);
+		}
+	}
+	else
+	{
+		node.bounds = m_Nodes[_nodeIndex + 1].bounds;
+		node.bounds.Expand(m_Nodes[node.rightOrFirst].bounds);
+	}
+
+	m_CostSum += GetNodeCost(node);
+}
+
+float Bvh::GetNodeCost(const BvhNode& _node) const
+{
+	return _node.bounds.GetHalfArea() * (_node.count > 0 ? static_cast<float>(_node.count) : BvhTraversalCost);
+}
+
+void Bvh::AppendSubtree(const uint32_t _nodeIndex, std::vector<uint32_t>& _results) const
+{
+	// Nodes are stored depth first, so a subtree's objects form one range from its leftmost to its rightmost leaf
+	uint32_t first = _nodeIndex;
+	uint32_t last = _nodeIndex;
+
+	while (m_Nodes[first].count == 0) first = first + 1;
+	while (m_Nodes[last].count == 0) last = m_Nodes[last].rightOrFirst;
+
+	_results.insert(_results.end(), m_ObjectIndices.begin() + m_Nodes[first].rightOrFirst, m_ObjectIndices.begin() + m_Nodes[last].rightOrFirst + m_Nodes[last].count);
+}
+
+void Bvh::QueryFrustumNode(const uint32_t _nodeIndex, const std::array<glm::vec4, 6>& _planes, uint32_t _planeMask, std::vector<uint32_t>& _results) const
+{
+	const BvhNode& node = m_Nodes[_nodeIndex];
+	const glm::vec3 centre = node.bounds.GetCentre();
+	const glm::vec3 extents = node.bounds.GetExtents();
+
+	// Planes the box is completely in front of are dropped for the whole subtree
+	for (int p = 0; p < 6; ++p)
+	{
+		if (!(_planeMask & (1 << p))) continue;
+
+		const float distance = glm::dot(glm::vec3(_planes[p]), centre) + _planes[p].w;
+		const float radius = glm::dot(glm::abs(glm::vec3(_planes[p])), extents);
+
+		if (distance + radius < 0.0f) return;
+		if (distance - radius >= 0.0f) _planeMask &= ~(1 << p);
+	}
+
+	if (_planeMask == 0)
+	{
+		AppendSubtree(_nodeIndex, _results);
+		return;
+	}
+
+	if (node.count == 0)
+	{
+		QueryFrustumNode(_nodeIndex + 1, _planes, _planeMask, _results);
+		QueryFrustumNode(node.rightOrFirst, _planes, _planeMask, _results);
+		return;
+	}
+
+	for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i)
+	{
+		const Aabb& bounds = m_ObjectBounds[m_ObjectIndices[i]];
+		const glm::vec3 objectCentre = bounds.GetCentre();
+		const glm::vec3 objectExtents = bounds.GetExtents();
+		bool inside = true;
+
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			if (!(_planeMask & (1 << p))) continue;
+
+			const float distance = glm::dot(glm::vec3(_planes[p]), objectCentre) + _planes[p].w;
+			inside = distance + glm::dot(glm::abs(glm::vec3(_planes[p])), objectExtents) >= 0.0f;
+		}
+
+		if (inside) _results.emplace_back(m_ObjectIndices[i]);
+	}
+}
+
+void Bvh::QueryAabbNode(const uint32_t _nodeIndex, const Aabb& _bounds, std::vector<uint32_t>& _results) const
+{
+	const BvhNode& node = m_Nodes[_nodeIndex];
+	if (!node.bounds.Overlaps(_bounds)) return;
+
+	if (node.count == 0)
+	{
+		QueryAabbNode(_nodeIndex + 1, _bounds, _results);
+		QueryAabbNode(node.rightOrFirst, _bounds, _results);
+		return;
+	}
+
+	for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i)
+	{
+		if (m_ObjectBounds[m_ObjectIndices[i]].Overlaps(_bounds)) _results.emplace_back(m_ObjectIndices[i]);
+	}
+}
+
+void Bvh::RaycastNode(const uint32_t _nodeIndex, const glm::vec3& _origin, const glm::vec3& _inverseDirection, RayHit& _hit) const
+{
+	const BvhNode& node = m_Nodes[_nodeIndex];
+
+	if (node.count > 0)
+	{
+		for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i)
+		{
+			const float distance = IntersectRay(m_ObjectBounds[m_ObjectIndices[i]], _origin, _inverseDirection, _hit.distance);
+
+			if (distance < _hit.distance)
+			{
+				_hit.distance = distance;
+				_hit.objectIndex = m_ObjectIndices[i];
+			}
+		}
+
+		return;
+	}
+
+	// Visit the nearer child first so the further one is often skipped by the shortened hit distance
+	uint32_t nearChild = _nodeIndex + 1;
+	uint32_t farChild = node.rightOrFirst;
+	float nearDistance = IntersectRay(m_Nodes[nearChild].bounds, _origin, _inverseDirection, _hit.distance);
+	float farDistance = IntersectRay(m_Nodes[farChild].bounds, _origin, _inverseDirection, _hit.distance);
+
+	if (farDistance < nearDistance)
+	{
+		std::swap(nearChild, farChild);
+		std::swap(nearDistance, farDistance);
+	}
+
+	if (nearDistance < _hit.distance) RaycastNode(nearChild, _origin, _inverseDirection, _hit);
+	if (farDistance < _hit.distance) RaycastNode(farChild, _origin, _inverseDirection, _hit);
+}
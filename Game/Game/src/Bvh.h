@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Bounds.h"
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// 32 bytes so two nodes share a cache line
+struct BvhNode
+{
+	Aabb bounds;
+	uint32_t rightOrFirst;		// Interior: index of the right child, the left child always follows its parent. Leaf: first entry in the object list
+	uint32_t count;				// Objects in the leaf, 0 for interior nodes
+};
+
+struct RayHit
+{
+	uint32_t objectIndex = UINT32_MAX;
+	float distance = 0.0f;		// Along the ray direction to the entry point of the object's box
+};
+
+// Bounding volume hierarchy over object bounds, addressed by the index the objects were built with.
+// Built top-down with a binned surface area heuristic into a depth-first node array. Moving objects only refit
+// the boxes above them, so the tree loosens as things move; NeedsRebuild reports when its SAH cost has grown enough
+// that rebuilding is worth it. Objects with empty bounds are kept out of the tree.
+class Bvh
+{
+public:
+	void Build(const std::vector<Aabb>& _objectBounds);
+	void Rebuild();
+	void Update(const uint32_t _objectIndex, const Aabb& _bounds);
+	void Refit();
+	bool NeedsRebuild() const;
+
+	// Queries append object indices in no particular order
+	void QueryFrustum(const std::array<glm::vec4, 6>& _planes, std::vector<uint32_t>& _results) const;
+	void QueryAabb(const Aabb& _bounds, std::vector<uint32_t>& _results) const;
+	bool Raycast(const glm::vec3& _origin, const glm::vec3& _direction, const float _maxDistance, RayHit& _hit) const;
+
+	uint32_t GetObjectCount() const { return static_cast<uint32_t>(m_ObjectIndices.size()); }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_Nodes.size()); }
+	float GetCost() const;		// SAH cost relative to the root box
+
+private:
+	struct Split
+	{
+		int axis;
+		uint32_t lastLeftBin;
+		float centroidMin;
+		float binScale;
+	};
+
+	void BuildNode(const uint32_t _nodeIndex, const uint32_t _first, const uint32_t _count, const uint32_t _depth);
+	bool FindSplit(const BvhNode& _node, const uint32_t _first, const uint32_t _count, Split& _split) const;
+	void RefitNode(const uint32_t _nodeIndex);
+	float GetNodeCost(const BvhNode& _node) const;
+	void AppendSubtree(const uint32_t _nodeIndex, std::vector<uint32_t>& _results) const;
+	void QueryFrustumNode(const uint32_t _nodeIndex, const std::array<glm::vec4, 6>& _planes, uint32_t _planeMask, std::vector<uint32_t>& _results) const;
+	void QueryAabbNode(const uint32_t _nodeIndex, const Aabb& _bounds, std::vector<uint32_t>& _results) const;
+	void RaycastNode(const uint32_t _nodeIndex, const glm::vec3& _origin, const glm::vec3& _inverseDirection, RayHit& _hit) const;
+
+private:
+	std::vector<BvhNode> m_Nodes;
+	std::vector<uint32_t> m_ObjectIndices;		// Leaves reference contiguous ranges of this list
+	std::vector<Aabb> m_ObjectBounds;			// Indexed by object
+	std::vector<glm::vec3> m_Centroids;			// Build scratch, indexed by object
+	std::vector<uint32_t> m_Parents;			// Indexed by node, UINT32_MAX for the root
+	std::vector<uint32_t> m_ObjectLeaves;		// Indexed by object, UINT32_MAX for objects outside the tree
+	std::vector<uint32_t> m_DirtyLeaves;		// Leaves whose objects moved since the last refit
+	double m_CostSum = 0.0;						// Unnormalised SAH cost, kept up to date by refits
+	float m_BuildCost = 0.0f;					// GetCost right after the last build
+};
@@ -0,0 +1,275 @@
+#include "BvhBenchmark.h"
+#include "Bvh.h"
+#include "FrustumCuller.h"
+#include "Camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	const float ObjectSpacing = 4.0f;		// World units per object along each axis
+	const float MinHalfExtent = 0.25f;
+	const float MaxHalfExtent = 1.0f;
+	const float MoveDistance = 0.5f;		// Largest per axis offset of a moved object each refit frame
+	const float QueryBoxSize = 20.0f;
+
+	template<typename Function>
+	double MeasureMilliseconds(Function&& _function)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		_function();
+		const auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+BvhBenchmark::BvhBenchmark(const BvhBenchmarkSettings& _settings) :
+	m_Settings(_settings)
+{
+	m_Settings.queryCount = std::max(1u, m_Settings.queryCount);
+	m_Settings.refitFrameCount = std::max(1u, m_Settings.refitFrameCount);
+	m_Settings.movedFraction = std::clamp(m_Settings.movedFraction, 0.0f, 1.0f);
+}
+
+bool BvhBenchmark::IsRequested(int _argc, char* _argv[])
+{
+	for (int i = 1; i < _argc; ++i)
+	{
+		if (std::string(_argv[i]) == "--bvh-benchmark") return true;
+	}
+
+	return false;
+}
+
+BvhBenchmarkSettings BvhBenchmark::ParseArguments(int _argc, char* _argv[])
+{
+	BvhBenchmarkSettings settings{};
+	bool objectCountsGiven = false;
+
+	for (int i = 1; i < _argc; ++i)
+	{
+		const std::string argument = _argv[i];
+		const bool hasValue = i + 1 < _argc;
+
+		if (argument == "--bvh-benchmark") continue;
+		else if (argument == "--objects" && hasValue)
+		{
+			// Repeatable, the first one replaces the default sizes
+			if (!objectCountsGiven) settings.objectCounts.clear();
+			settings.objectCounts.emplace_back(std::max(1u, static_cast<uint32_t>(std::stoul(_argv[++i]))));
+			objectCountsGiven = true;
+		}
+		else if (argument == "--queries" && hasValue) settings.queryCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--refit-frames" && hasValue) settings.refitFrameCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--moved" && hasValue) settings.movedFraction = std::stof(_argv[++i]);
+		else if (argument == "--output" && hasValue) settings.outputFile = _argv[++i];
+		else throw std::runtime_error("BENCHMARK ERROR: Unknown or incomplete argument " + argument + "\n");
+	}
+
+	return settings;
+}
+
+void BvhBenchmark::Run()
+{
+	std::vector<BvhBenchmarkResult> results;
+
+	for (const uint32_t objectCount : m_Settings.objectCounts)
+	{
+		std::cout << "BVH benchmark: measuring " << objectCount << " objects\n";
+		results.emplace_back(Measure(objectCount));
+	}
+
+	WriteResults(results);
+}
+
+BvhBenchmarkResult BvhBenchmark::Measure(const uint32_t _objectCount)
+{
+	// Fixed seed so every run and scene size sees the same layout and queries
+	std::mt19937 random(_objectCount);
+	const float worldSize = std::cbrt(static_cast<float>(_objectCount)) * ObjectSpacing;
+	std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+	std::uniform_real_distribution<float> halfExtent(MinHalfExtent, MaxHalfExtent);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<Aabb> objectBounds(_objectCount);
+
+	for (auto& bounds : objectBounds)
+	{
+		const glm::vec3 centre(position(random), position(random), position(random));
+		const glm::vec3 extents(halfExtent(random), halfExtent(random), halfExtent(random));
+		bounds.min = centre - extents;
+		bounds.max = centre + extents;
+	}
+
+	BvhBenchmarkResult result{};
+	result.objectCount = _objectCount;
+
+	Bvh bvh;
+	result.buildTime = MeasureMilliseconds([&]() { bvh.Build(objectBounds); });
+	result.nodeCount = bvh.GetNodeCount();
+	result.buildCost = bvh.GetCost();
+
+	// Refit, the same objects move every frame so the tree keeps loosening
+	const uint32_t movedCount = static_cast<uint32_t>(_objectCount * m_Settings.movedFraction);
+	std::vector<glm::vec3> velocities(movedCount);
+	for (auto& velocity : velocities) velocity = glm::vec3(unit(random), unit(random), unit(random)) * MoveDistance;
+
+	for (uint32_t frame = 0; frame < m_Settings.refitFrameCount; ++frame)
+	{
+		result.refitTime += MeasureMilliseconds([&]()
+		{
+			for (uint32_t i = 0; i < movedCount; ++i)
+			{
+				Aabb& bounds = objectBounds[i];
+				bounds.min += velocities[i];
+				bounds.max += velocities[i];
+				bvh.Update(i, bounds);
+			}
+
+			bvh.Refit();
+		});
+	}
+
+	result.refitTime /= m_Settings.refitFrameCount;
+	result.refitCost = bvh.GetCost();
+	result.rebuildTime = MeasureMilliseconds([&]() { bvh.Rebuild(); });
+	result.rebuildCost = bvh.GetCost();
+
+	// Frustum queries from random points looking in random directions, against a linear SIMD pass over the same boxes
+	std::vector<std::array<glm::vec4, 6>> frustums(m_Settings.queryCount);
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, worldSize * 0.5f);
+
+	for (auto& planes : frustums)
+	{
+		const glm::vec3 eye(position(random), position(random), position(random));
+		const glm::vec3 forward = glm::normalize(glm::vec3(unit(random), unit(random) * 0.5f, unit(random)) + glm::vec3(0.0f, 0.0f, 0.001f));
+		planes = Camera::ExtractFrustumPlanes(projection * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+
+	std::vector<uint32_t> queryResults;
+	queryResults.reserve(_objectCount);
+	uint64_t visibleObjects = 0;
+
+	result.frustumQueryTime = MeasureMilliseconds([&]()
+	{
+		for (const auto& planes : frustums)
+		{
+			queryResults.clear();
+			bvh.QueryFrustum(planes, queryResults);
+			visibleObjects += queryResults.size();
+		}
+	}) * 1000.0 / m_Settings.queryCount;
+
+	result.meanVisibleObjects = static_cast<double>(visibleObjects) / m_Settings.queryCount;
+
+	FrustumCuller frustumCuller;
+	for (const auto& bounds : objectBounds) frustumCuller.Add(bounds);
+
+	result.linearCullTime = MeasureMilliseconds([&]()
+	{
+		for (const auto& planes : frustums)
+		{
+			queryResults.clear();
+			frustumCuller.Cull(planes, queryResults);
+		}
+	}) * 1000.0 / m_Settings.queryCount;
+
+	// Rays from random points in random directions, limited to the world size
+	std::vector<std::pair<glm::vec3, glm::vec3>> rays(m_Settings.queryCount);
+
+	for (auto& ray : rays)
+	{
+		ray.first = glm::vec3(position(random), position(random), position(random));
+		ray.second = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 0.001f));
+	}
+
+	uint32_t rayHits = 0;
+
+	result.rayQueryTime = MeasureMilliseconds([&]()
+	{
+		for (const auto& ray : rays)
+		{
+			RayHit hit;
+			if (bvh.Raycast(ray.first, ray.second, worldSize, hit)) ++rayHits;
+		}
+	}) * 1000.0 / m_Settings.queryCount;
+
+	result.rayHitRate = static_cast<double>(rayHits) / m_Settings.queryCount;
+
+	// Fixed size boxes, the kind of query proximity checks make
+	std::vector<Aabb> queryBoxes(m_Settings.queryCount);
+
+	for (auto& queryBox : queryBoxes)
+	{
+		const glm::vec3 centre(position(random), position(random), position(random));
+		queryBox.min = centre - glm::vec3(QueryBoxSize * 0.5f);
+		queryBox.max = centre + glm::vec3(QueryBoxSize * 0.5f);
+	}
+
+	uint64_t overlappingObjects = 0;
+
+	result.aabbQueryTime = MeasureMilliseconds([&]()
+	{
+		for (const auto& queryBox : queryBoxes)
+		{
+			queryResults.clear();
+			bvh.QueryAabb(queryBox, queryResults);
+			overlappingObjects += queryResults.size();
+		}
+	}) * 1000.0 / m_Settings.queryCount;
+
+	result.meanOverlappingObjects = static_cast<double>(overlappingObjects) / m_Settings.queryCount;
+	return result;
+}
+
+void BvhBenchmark::WriteResults(const std::vector<BvhBenchmarkResult>& _results)
+{
+	std::ofstream file(m_Settings.outputFile);
+
+	if (!file.is_open())
+	{
+		throw std::runtime_error("BENCHMARK ERROR: Failed to open " + m_Settings.outputFile + "\n");
+	}
+
+	file << "{\n";
+	file << "\t\"settings\": {\n";
+	file << "\t\t\"queries\": " << m_Settings.queryCount << ",\n";
+	file << "\t\t\"refitFrames\": " << m_Settings.refitFrameCount << ",\n";
+	file << "\t\t\"movedFraction\": " << m_Settings.movedFraction << "\n";
+	file << "\t},\n";
+	file << "\t\"results\": [\n";
+
+	for (size_t i = 0; i < _results.size(); ++i)
+	{
+		const BvhBenchmarkResult& result = _results[i];
+
+		file << "\t\t{\n";
+		file << "\t\t\t\"objects\": " << result.objectCount << ",\n";
+		file << "\t\t\t\"nodes\": " << result.nodeCount << ",\n";
+		file << "\t\t\t\"buildMs\": " << result.buildTime << ",\n";
+		file << "\t\t\t\"refitMs\": " << result.refitTime << ",\n";
+		file << "\t\t\t\"rebuildMs\": " << result.rebuildTime << ",\n";
+		file << "\t\t\t\"buildCost\": " << result.buildCost << ",\n";
+		file << "\t\t\t\"refitCost\": " << result.refitCost << ",\n";
+		file << "\t\t\t\"rebuildCost\": " << result.rebuildCost << ",\n";
+		file << "\t\t\t\"frustumQueryUs\": " << result.frustumQueryTime << ",\n";
+		file << "\t\t\t\"linearCullUs\": " << result.linearCullTime << ",\n";
+		file << "\t\t\t\"meanVisibleObjects\": " << result.meanVisibleObjects << ",\n";
+		file << "\t\t\t\"rayQueryUs\": " << result.rayQueryTime << ",\n";
+		file << "\t\t\t\"rayHitRate\": " << result.rayHitRate << ",\n";
+		file << "\t\t\t\"aabbQueryUs\": " << result.aabbQueryTime << ",\n";
+		file << "\t\t\t\"meanOverlappingObjects\": " << result.meanOverlappingObjects << "\n";
+		file << "\t\t}" << (i + 1 < _results.size() ? ",\n" : "\n");
+	}
+
+	file << "\t]\n";
+	file << "}\n";
+
+	std::cout << "BVH benchmark results written to " << m_Settings.outputFile << '\n';
+}
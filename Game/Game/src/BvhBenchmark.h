@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct BvhBenchmarkSettings
+{
+	std::vector<uint32_t> objectCounts = { 10000, 100000, 1000000 };	// One measurement per scene size
+	uint32_t queryCount = 1000;						// Frustums, rays and boxes queried per scene size
+	uint32_t refitFrameCount = 10;					// Refits measured per scene size
+	float movedFraction = 0.1f;						// Share of objects moved before every refit
+	std::string outputFile = "bvh_benchmark.json";
+};
+
+struct BvhBenchmarkResult
+{
+	uint32_t objectCount = 0;
+	uint32_t nodeCount = 0;
+	double buildTime = 0.0;				// Milliseconds for a full SAH build
+	double refitTime = 0.0;				// Milliseconds to update the moved objects and refit, mean over the refit frames
+	double rebuildTime = 0.0;			// Milliseconds to rebuild the refitted tree
+	float buildCost = 0.0f;				// SAH cost after the build, after the refits and after the rebuild
+	float refitCost = 0.0f;
+	float rebuildCost = 0.0f;
+	double frustumQueryTime = 0.0;		// Microseconds per query
+	double linearCullTime = 0.0;		// Microseconds per FrustumCuller pass over every object, for comparison
+	double meanVisibleObjects = 0.0;
+	double rayQueryTime = 0.0;			// Microseconds per query
+	double rayHitRate = 0.0;
+	double aabbQueryTime = 0.0;			// Microseconds per query
+	double meanOverlappingObjects = 0.0;
+};
+
+// CPU only microbenchmark of the scene BVH over randomly placed boxes, no device is created.
+// Scenes keep the same object density at every size so query cost reflects scaling rather than emptier space.
+class BvhBenchmark
+{
+public:
+	BvhBenchmark(const BvhBenchmarkSettings& _settings);
+
+	void Run();
+	static bool IsRequested(int _argc, char* _argv[]);
+	static BvhBenchmarkSettings ParseArguments(int _argc, char* _argv[]);
+
+private:
+	BvhBenchmarkResult Measure(const uint32_t _objectCount);
+	void WriteResults(const std::vector<BvhBenchmarkResult>& _results);
+
+private:
+	BvhBenchmarkSettings m_Settings;
+};
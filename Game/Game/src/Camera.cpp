@@ -5,7 +5,11 @@
 
 Camera::Camera() :
 	m_CameraTransform{},
+	m_PreviousTransform{},
 	m_CameraMatricesBuffer{},
+	m_UniformStride(0),
+	m_FrameCount(0),
+	m_pUniformData(nullptr),
 	m_Position(0.0f),
 	m_Direction(0.0f),
 	m_Up(0.0f),
@@ -15,12 +19,13 @@ Camera::Camera() :
 	m_MoveForward(false),
 	m_MoveBackward(false),
 	m_MoveLeft(false),
-	m_MoveRight(false)
+	m_MoveRight(false),
+	m_InputEnabled(true)
 {}
 
-void Camera::Init()
+void Camera::Init(const uint32_t _frameCount)
 {
-	CreateUniformBuffer();
+	CreateUniformBuffer(_frameCount);
 
 	Input::AddBinding(INPUT_KEY_W, std::bind(&Camera::OnMoveForward, this, std::placeholders::_1));
 	Input::AddBinding(INPUT_KEY_S, std::bind(&Camera::OnMoveBackward, this, std::placeholders::_1));
@@ -38,15 +43,24 @@ void Camera::CleanUp()
 	VulkanUtilities::DestroyBuffer(m_CameraMatricesBuffer.buffer, m_CameraMatricesBuffer.bufferMemory);
 }
 
-void Camera::CreateUniformBuffer()
+void Camera::CreateUniformBuffer(const uint32_t _frameCount)
 {
+	// One slice per frame in flight so the CPU never writes matrices a previous frame is still reading. A second set
+	// of slices holds each frame's copy of the camera from the frame before it, for occlusion culling
+	m_UniformStride = VulkanUtilities::PadUniformBufferSize(sizeof(CameraTransform));
+	m_FrameCount = _frameCount;
+
 	BufferInfo bufferInfo{};
 	bufferInfo.bufferUsage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-	bufferInfo.bufferSize = sizeof(CameraTransform);
+	bufferInfo.bufferSize = m_UniformStride * _frameCount * 2;
 	bufferInfo.pBuffer = &m_CameraMatricesBuffer.buffer;
 	bufferInfo.pBufferMemory = &m_CameraMatricesBuffer.bufferMemory;
 	bufferInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 	VulkanUtilities::CreateBuffer(bufferInfo);
+
+	void* pData = nullptr;
+	VulkanUtilities::MapMemory(m_CameraMatricesBuffer.bufferMemory, &pData);
+	m_pUniformData = static_cast<uint8_t*>(pData);
 }
 
 void Camera::OnMoveForward(const InputAction _inputAction)
@@ -138,19 +152,47 @@ void Camera::UpdateRotation()
 	m_Direction = glm::normalize(direction);
 }
 
-void Camera::Update()
+std::array<glm::vec4, 6> Camera::GetFrustumPlanes() const
 {
-	UpdateRotation();
+	return ExtractFrustumPlanes(m_CameraTransform.proj * m_CameraTransform.view);
+}
 
-	if (m_MoveForward)	m_Position += m_Direction * 0.001f;
-	if (m_MoveBackward) m_Position -= m_Direction * 0.001f;
-	if (m_MoveRight)	m_Position += glm::normalize(glm::cross(m_Direction, m_Up)) * 0.001f;
-	if (m_MoveLeft)		m_Position -= glm::normalize(glm::cross(m_Direction, m_Up)) * 0.001f;
+std::array<glm::vec4, 6> Camera::ExtractFrustumPlanes(const glm::mat4& _viewProjection)
+{
+	// Planes are the clip matrix rows combined (Gribb-Hartmann), xyz points inwards and a point is inside when dot(xyz, p) + w >= 0
+	const glm::mat4& clip = _viewProjection;
+	const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+	const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+	const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+	const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
 
-	UpdateMove();
+	// Depth is in [0, 1], so the near plane is row2 alone
+	std::array<glm::vec4, 6> planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
 
-	void* pData = nullptr;
-	VulkanUtilities::MapMemory(m_CameraMatricesBuffer.bufferMemory, sizeof(CameraTransform), &pData);
-	memcpy(pData, &m_CameraTransform, sizeof(CameraTransform));
-	VulkanUtilities::UnmapMemory(m_CameraMatricesBuffer.bufferMemory);
+	for (auto& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
+
+void Camera::Update(const uint32_t _frameIndex)
+{
+	// Scripted cameras are driven through SetView only
+	if (m_InputEnabled)
+	{
+		UpdateRotation();
+
+		if (m_MoveForward)	m_Position += m_Direction * 0.001f;
+		if (m_MoveBackward) m_Position -= m_Direction * 0.001f;
+		if (m_MoveRight)	m_Position += glm::normalize(glm::cross(m_Direction, m_Up)) * 0.001f;
+		if (m_MoveLeft)		m_Position -= glm::normalize(glm::cross(m_Direction, m_Up)) * 0.001f;
+
+		UpdateMove();
+	}
+
+	memcpy(m_pUniformData + m_UniformStride * _frameIndex, &m_CameraTransform, sizeof(CameraTransform));
+	memcpy(m_pUniformData + m_UniformStride * (m_FrameCount + _frameIndex), &m_PreviousTransform, sizeof(CameraTransform));
+	m_PreviousTransform = m_CameraTransform;
 }
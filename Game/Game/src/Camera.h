@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <array>
 #include "Vulkan/VulkanUtilities.h"
 
 enum class InputAction : unsigned short;
@@ -16,16 +17,22 @@ class Camera
 public:
 	Camera();
 
-	void Init();
+	void Init(const uint32_t _frameCount);
 	void CleanUp();
 	void SetView(const glm::vec3& _pos, const glm::vec3& _lookDir, const glm::vec3& _up = glm::vec3(0.0f, 1.0f, 0.0f));
 	void SetProjection(const float _fov, const float _aspectRatio, const float _near, const float _far);
-	void Update();
+	void Update(const uint32_t _frameIndex);
+	void SetInputEnabled(const bool _inputEnabled) { m_InputEnabled = _inputEnabled; }
 	CameraTransform GetCameraTransform() const { return m_CameraTransform; }
+	std::array<glm::vec4, 6> GetFrustumPlanes() const;
+	const glm::vec3& GetPosition() const { return m_Position; }
+	static std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& _viewProjection);
 	UniformBuffer GetUniformBuffer() const { return m_CameraMatricesBuffer; }
+	uint32_t GetUniformOffset(const uint32_t _frameIndex) const { return static_cast<uint32_t>(m_UniformStride * _frameIndex); }
+	uint32_t GetPreviousUniformOffset(const uint32_t _frameIndex) const { return static_cast<uint32_t>(m_UniformStride * (m_FrameCount + _frameIndex)); }
 
 private:
-	void CreateUniformBuffer();
+	void CreateUniformBuffer(const uint32_t _frameCount);
 	void OnMoveForward(const InputAction _inputAction);
 	void OnMoveBackward(const InputAction _inputAction);
 	void OnMoveLeft(const InputAction _inputAction);
@@ -35,7 +42,11 @@ private:
 
 private:
 	CameraTransform m_CameraTransform;
+	CameraTransform m_PreviousTransform;	// Written by the last Update, copied into the next frame's previous slice
 	UniformBuffer m_CameraMatricesBuffer;
+	VkDeviceSize m_UniformStride;		// Size of one frame's slice, padded to the device's offset alignment
+	uint32_t m_FrameCount;
+	uint8_t* m_pUniformData;			// Persistently mapped start of the buffer
 	glm::vec3 m_Position;
 	glm::vec3 m_Direction;
 	glm::vec3 m_Up;
@@ -46,4 +57,5 @@ private:
 	bool m_MoveBackward;
 	bool m_MoveLeft;
 	bool m_MoveRight;
+	bool m_InputEnabled;
 };
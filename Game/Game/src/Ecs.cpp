@@ -0,0 +1,61 @@
+#include "Ecs.h"
+#include <stdexcept>
+
+Entity EntityRegistry::Create()
+{
+	uint32_t index = 0;
+
+	if (!m_FreeIndices.empty())
+	{
+		index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else
+	{
+		// The top index is left out so no handle can equal InvalidEntity
+		if (m_Generations.size() >= EntityIndexMask)
+		{
+			throw std::runtime_error("ENTITY ERROR: Out of entity indices\n");
+		}
+
+		index = static_cast<uint32_t>(m_Generations.size());
+		m_Generations.emplace_back(0);
+	}
+
+	++m_AliveCount;
+	return (static_cast<uint32_t>(m_Generations[index]) << EntityIndexBits) | index;
+}
+
+void EntityRegistry::Destroy(const Entity _entity)
+{
+	if (!IsAlive(_entity)) return;
+
+	for (const auto& pPool : m_Pools)
+	{
+		if (pPool) pPool->Remove(_entity);
+	}
+
+	const uint32_t index = GetEntityIndex(_entity);
+	++m_Generations[index];
+	m_FreeIndices.emplace_back(index);
+	--m_AliveCount;
+}
+
+bool EntityRegistry::IsAlive(const Entity _entity) const
+{
+	const uint32_t index = GetEntityIndex(_entity);
+	return _entity != InvalidEntity && index < m_Generations.size() && m_Generations[index] == GetEntityGeneration(_entity);
+}
+
+void EntityRegistry::Clear()
+{
+	// Pools stay allocated, their type ids are global
+	for (const auto& pPool : m_Pools)
+	{
+		if (pPool) pPool->Clear();
+	}
+
+	m_Generations.clear();
+	m_FreeIndices.clear();
+	m_AliveCount = 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+
+// Index in the low bits, the slot's generation in the high bits so handles to a destroyed entity stop matching once its
+// slot is reused
+typedef uint32_t Entity;
+static constexpr Entity InvalidEntity = UINT32_MAX;
+static constexpr uint32_t EntityIndexBits = 24;
+static constexpr uint32_t EntityIndexMask = (1u << EntityIndexBits) - 1;
+
+inline uint32_t GetEntityIndex(const Entity _entity) { return _entity & EntityIndexMask; }
+inline uint32_t GetEntityGeneration(const Entity _entity) { return _entity >> EntityIndexBits; }
+
+// Sparse set: m_Sparse maps an entity's index to its position in the dense arrays, which hold every owner and component
+// back to back so systems walk them without gaps. Removal swaps the last element into the hole
+class ComponentPoolBase
+{
+public:
+	virtual ~ComponentPoolBase() = default;
+	virtual void Remove(const Entity _entity) = 0;
+	virtual void Clear() = 0;
+
+	bool Has(const Entity _entity) const
+	{
+		const uint32_t index = GetEntityIndex(_entity);
+		return index < m_Sparse.size() && m_Sparse[index] != InvalidSlot && m_Dense[m_Sparse[index]] == _entity;
+	}
+
+	const std::vector<Entity>& GetEntities() const { return m_Dense; }
+	uint32_t GetCount() const { return static_cast<uint32_t>(m_Dense.size()); }
+
+protected:
+	static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+	std::vector<uint32_t> m_Sparse;		// Entity index to dense slot
+	std::vector<Entity> m_Dense;		// Owner of each dense slot
+};
+
+template<typename T>
+class ComponentPool : public ComponentPoolBase
+{
+public:
+	template<typename... Args>
+	T& Add(const Entity _entity, Args&&... _args)
+	{
+		// Replaces the component if the entity already has one
+		if (Has(_entity))
+		{
+			T& component = m_Components[m_Sparse[GetEntityIndex(_entity)]];
+			component = T{ std::forward<Args>(_args)... };
+			return component;
+		}
+
+		const uint32_t index = GetEntityIndex(_entity);
+		if (index >= m_Sparse.size()) m_Sparse.resize(index + 1, InvalidSlot);
+
+		m_Sparse[index] = static_cast<uint32_t>(m_Dense.size());
+		m_Dense.emplace_back(_entity);
+		m_Components.push_back(T{ std::forward<Args>(_args)... });
+		return m_Components.back();
+	}
+
+	void Remove(const Entity _entity) override
+	{
+		if (!Has(_entity)) return;
+
+		const uint32_t index = GetEntityIndex(_entity);
+		const uint32_t slot = m_Sparse[index];
+		const uint32_t lastSlot = static_cast<uint32_t>(m_Dense.size() - 1);
+
+		if (slot != lastSlot)
+		{
+			m_Dense[slot] = m_Dense[lastSlot];
+			m_Components[slot] = std::move(m_Components[lastSlot]);
+			m_Sparse[GetEntityIndex(m_Dense[slot])] = slot;
+		}
+
+		m_Dense.pop_back();
+		m_Components.pop_back();
+		m_Sparse[index] = InvalidSlot;
+	}
+
+	void Clear() override
+	{
+		m_Sparse.clear();
+		m_Dense.clear();
+		m_Components.clear();
+	}
+
+	T& Get(const Entity _entity) { return m_Components[m_Sparse[GetEntityIndex(_entity)]]; }
+	const T& Get(const Entity _entity) const { return m_Components[m_Sparse[GetEntityIndex(_entity)]]; }
+	T* TryGet(const Entity _entity) { return Has(_entity) ? &Get(_entity) : nullptr; }
+	const T* TryGet(const Entity _entity) const { return Has(_entity) ? &Get(_entity) : nullptr; }
+
+	// In the same order as GetEntities
+	std::vector<T>& GetComponents() { return m_Components; }
+	const std::vector<T>& GetComponents() const { return m_Components; }
+
+private:
+	std::vector<T> m_Components;
+};
+
+// Entities are plain ids, everything about them lives in one pool per component type. Systems go through Each, which
+// walks the smallest of the pools it needs densely and looks the rest up through their sparse arrays.
+// Components must not be added to or removed from the iterated pools inside Each
+class EntityRegistry
+{
+public:
+	Entity Create();
+	void Destroy(const Entity _entity);		// Removes every component and frees the slot for reuse
+	bool IsAlive(const Entity _entity) const;
+	void Clear();							// Handles from before the clear may match new entities, drop them
+	uint32_t GetCount() const { return m_AliveCount; }
+
+	template<typename T, typename... Args>
+	T& Add(const Entity _entity, Args&&... _args) { return GetPool<T>().Add(_entity, std::forward<Args>(_args)...); }
+
+	template<typename T>
+	void Remove(const Entity _entity) { GetPool<T>().Remove(_entity); }
+
+	template<typename T>
+	bool Has(const Entity _entity) const { const ComponentPool<T>* pPool = FindPool<T>(); return pPool && pPool->Has(_entity); }
+
+	// Throws if the entity has no T, use TryGet when it may not
+	template<typename T>
+	T& Get(const Entity _entity) { ComponentPool<T>& pool = GetPool<T>(); CheckHas(&pool, _entity); return pool.Get(_entity); }
+
+	template<typename T>
+	const T& Get(const Entity _entity) const { const ComponentPool<T>* pPool = FindPool<T>(); CheckHas(pPool, _entity); return pPool->Get(_entity); }
+
+	template<typename T>
+	T* TryGet(const Entity _entity) { return GetPool<T>().TryGet(_entity); }
+
+	template<typename T>
+	const T* TryGet(const Entity _entity) const { const ComponentPool<T>* pPool = FindPool<T>(); return pPool ? pPool->TryGet(_entity) : nullptr; }
+
+	template<typename T>
+	ComponentPool<T>& GetPool()
+	{
+		const uint32_t type = GetComponentType<T>();
+		if (type >= m_Pools.size()) m_Pools.resize(type + 1);
+		if (!m_Pools[type]) m_Pools[type] = std::make_unique<ComponentPool<T>>();
+
+		return *static_cast<ComponentPool<T>*>(m_Pools[type].get());
+	}
+
+	// Calls _function(entity, components&...) for every entity that has all of Components
+	template<typename... Components, typename Function>
+	void Each(Function&& _function)
+	{
+		const ComponentPoolBase* pools[] = { &GetPool<Components>()... };
+
+		const ComponentPoolBase* pSmallest = pools[0];
+		for (const ComponentPoolBase* pPool : pools)
+		{
+			if (pPool->GetCount() < pSmallest->GetCount()) pSmallest = pPool;
+		}
+
+		for (const Entity entity : pSmallest->GetEntities())
+		{
+			bool matches = true;
+			for (const ComponentPoolBase* pPool : pools) matches = matches && (pPool == pSmallest || pPool->Has(entity));
+
+			if (matches) _function(entity, GetPool<Components>().Get(entity)...);
+		}
+	}
+
+private:
+	static void CheckHas(const ComponentPoolBase* _pPool, const Entity _entity)
+	{
+		if (!_pPool || !_pPool->Has(_entity)) throw std::runtime_error("ENTITY ERROR: Entity does not have the requested component\n");
+	}
+
+	template<typename T>
+	const ComponentPool<T>* FindPool() const
+	{
+		const uint32_t type = GetComponentType<T>();
+		return type < m_Pools.size() ? static_cast<const ComponentPool<T>*>(m_Pools[type].get()) : nullptr;
+	}
+
+	// Handed out the first time each component type is used
+	template<typename T>
+	static uint32_t GetComponentType()
+	{
+		static const uint32_t type = s_NextComponentType++;
+		return type;
+	}
+
+private:
+	inline static uint32_t s_NextComponentType = 0;
+
+	std::vector<uint8_t> m_Generations;					// Per slot, bumped when the entity in it is destroyed
+	std::vector<uint32_t> m_FreeIndices;
+	std::vector<std::unique_ptr<ComponentPoolBase>> m_Pools;	// Indexed by component type
+	uint32_t m_AliveCount = 0;
+};
@@ -0,0 +1,135 @@
+#include "FrustumCuller.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CullBatchWidth 8
+#else
+#include <emmintrin.h>
+#define CullBatchWidth 4
+#endif
+
+void FrustumCuller::Reset()
+{
+	m_Count = 0;
+	m_CentreX.clear();
+	m_CentreY.clear();
+	m_CentreZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+}
+
+void FrustumCuller::Add(const Aabb& _bounds)
+{
+	const glm::vec3 centre = _bounds.GetCentre();
+	const glm::vec3 extents = _bounds.GetExtents();
+
+	m_CentreX.emplace_back(centre.x);
+	m_CentreY.emplace_back(centre.y);
+	m_CentreZ.emplace_back(centre.z);
+	m_ExtentX.emplace_back(extents.x);
+	m_ExtentY.emplace_back(extents.y);
+	m_ExtentZ.emplace_back(extents.z);
+	++m_Count;
+}
+
+void FrustumCuller::Cull(const std::array<glm::vec4, 6>& _planes, std::vector<uint32_t>& _visible)
+{
+	// A box is outside when its centre is further behind a plane than its extents projected onto the plane normal
+	const uint32_t batchEnd = m_Count - m_Count % CullBatchWidth;
+
+#if defined(__AVX__)
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm256_set1_ps(_planes[p].x);
+		planeY[p] = _mm256_set1_ps(_planes[p].y);
+		planeZ[p] = _mm256_set1_ps(_planes[p].z);
+		planeW[p] = _mm256_set1_ps(_planes[p].w);
+		absX[p] = _mm256_set1_ps(std::abs(_planes[p].x));
+		absY[p] = _mm256_set1_ps(std::abs(_planes[p].y));
+		absZ[p] = _mm256_set1_ps(std::abs(_planes[p].z));
+	}
+
+	for (uint32_t i = 0; i < batchEnd; i += CullBatchWidth)
+	{
+		const __m256 centreX = _mm256_loadu_ps(&m_CentreX[i]);
+		const __m256 centreY = _mm256_loadu_ps(&m_CentreY[i]);
+		const __m256 centreZ = _mm256_loadu_ps(&m_CentreZ[i]);
+		const __m256 extentX = _mm256_loadu_ps(&m_ExtentX[i]);
+		const __m256 extentY = _mm256_loadu_ps(&m_ExtentY[i]);
+		const __m256 extentZ = _mm256_loadu_ps(&m_ExtentZ[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int p = 0; p < 6; ++p)
+		{
+			const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], centreX), _mm256_mul_ps(planeY[p], centreY)), _mm256_add_ps(_mm256_mul_ps(planeZ[p], centreZ), planeW[p]));
+			const __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], extentX), _mm256_mul_ps(absY[p], extentY)), _mm256_mul_ps(absZ[p], extentZ));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		const int mask = _mm256_movemask_ps(inside);
+#else
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm_set1_ps(_planes[p].x);
+		planeY[p] = _mm_set1_ps(_planes[p].y);
+		planeZ[p] = _mm_set1_ps(_planes[p].z);
+		planeW[p] = _mm_set1_ps(_planes[p].w);
+		absX[p] = _mm_set1_ps(std::abs(_planes[p].x));
+		absY[p] = _mm_set1_ps(std::abs(_planes[p].y));
+		absZ[p] = _mm_set1_ps(std::abs(_planes[p].z));
+	}
+
+	for (uint32_t i = 0; i < batchEnd; i += CullBatchWidth)
+	{
+		const __m128 centreX = _mm_loadu_ps(&m_CentreX[i]);
+		const __m128 centreY = _mm_loadu_ps(&m_CentreY[i]);
+		const __m128 centreZ = _mm_loadu_ps(&m_CentreZ[i]);
+		const __m128 extentX = _mm_loadu_ps(&m_ExtentX[i]);
+		const __m128 extentY = _mm_loadu_ps(&m_ExtentY[i]);
+		const __m128 extentZ = _mm_loadu_ps(&m_ExtentZ[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int p = 0; p < 6; ++p)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centreX), _mm_mul_ps(planeY[p], centreY)), _mm_add_ps(_mm_mul_ps(planeZ[p], centreZ), planeW[p]));
+			const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		const int mask = _mm_movemask_ps(inside);
+#endif
+
+		// One bit per box in the batch
+		for (uint32_t lane = 0; lane < CullBatchWidth; ++lane)
+		{
+			if (mask & (1 << lane)) _visible.emplace_back(i + lane);
+		}
+	}
+
+	CullScalar(_planes, batchEnd, _visible);
+}
+
+void FrustumCuller::CullScalar(const std::array<glm::vec4, 6>& _planes, const uint32_t _first, std::vector<uint32_t>& _visible) const
+{
+	for (uint32_t i = _first; i < m_Count; ++i)
+	{
+		bool inside = true;
+
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			const float distance = _planes[p].x * m_CentreX[i] + _planes[p].y * m_CentreY[i] + _planes[p].z * m_CentreZ[i] + _planes[p].w;
+			const float radius = std::abs(_planes[p].x) * m_ExtentX[i] + std::abs(_planes[p].y) * m_ExtentY[i] + std::abs(_planes[p].z) * m_ExtentZ[i];
+			inside = distance + radius >= 0.0f;
+		}
+
+		if (inside) _visible.emplace_back(i);
+	}
+}
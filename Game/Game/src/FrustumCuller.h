@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Bounds.h"
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// Tests batches of boxes against the six camera planes.
+// Boxes are stored as centre/extents in structure-of-arrays form so SSE (or AVX when compiled with it) tests 4 (8) at once.
+class FrustumCuller
+{
+public:
+	void Reset();
+	void Add(const Aabb& _bounds);
+	uint32_t GetCount() const { return m_Count; }
+
+	// Appends the Add order index of every box at least partially inside the planes
+	void Cull(const std::array<glm::vec4, 6>& _planes, std::vector<uint32_t>& _visible);
+
+private:
+	void CullScalar(const std::array<glm::vec4, 6>& _planes, const uint32_t _first, std::vector<uint32_t>& _visible) const;
+
+private:
+	uint32_t m_Count = 0;
+	std::vector<float> m_CentreX;
+	std::vector<float> m_CentreY;
+	std::vector<float> m_CentreZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+};
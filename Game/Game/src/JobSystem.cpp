@@ -0,0 +1,155 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(const uint32_t _workerCount) :
+	m_Workers{},
+	m_Job{},
+	m_Tasks{},
+	m_NextJob(0),
+	m_JobsRemaining(0),
+	m_JobCount(0),
+	m_ActiveWorkers(0),
+	m_RunningTasks(0),
+	m_Generation(0),
+	m_Stopping(false)
+{
+	m_Workers.reserve(_workerCount);
+
+	for (uint32_t i = 0; i < _workerCount; ++i)
+	{
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	for (auto& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::ParallelFor(const uint32_t _jobCount, const std::function<void(const uint32_t)>& _job)
+{
+	if (_jobCount == 0) return;
+
+	uint64_t generation = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		generation = ++m_Generation;
+		m_Job = _job;
+		m_JobCount = _jobCount;
+		m_NextJob = generation << 32;
+		m_JobsRemaining = _jobCount;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	// The calling thread works through jobs too instead of sitting idle
+	RunJobs(_job, generation, _jobCount);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_WorkDone.wait(lock, [this]() { return m_JobsRemaining == 0 && m_ActiveWorkers == 0; });
+}
+
+void JobSystem::Submit(std::function<void()> _task)
+{
+	if (m_Workers.empty())
+	{
+		_task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.emplace_back(std::move(_task));
+	}
+
+	m_WorkAvailable.notify_one();
+}
+
+void JobSystem::WaitForTasks()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_WorkDone.wait(lock, [this]() { return m_Tasks.empty() && m_RunningTasks == 0; });
+}
+
+void JobSystem::WorkerLoop()
+{
+	uint64_t lastGeneration = 0;
+
+	while (true)
+	{
+		std::function<void(const uint32_t)> job;
+		std::function<void()> task;
+		uint32_t jobCount = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkAvailable.wait(lock, [this, lastGeneration]() { return m_Stopping || m_Generation != lastGeneration || !m_Tasks.empty(); });
+
+			// Queued tasks are dropped, owners wait for theirs before the pool is destroyed
+			if (m_Stopping) return;
+
+			if (m_Generation != lastGeneration)
+			{
+				lastGeneration = m_Generation;
+				job = m_Job;
+				jobCount = m_JobCount;
+				++m_ActiveWorkers;
+			}
+			else
+			{
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+				++m_RunningTasks;
+			}
+		}
+
+		if (job) RunJobs(job, lastGeneration, jobCount);
+		else task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (job) --m_ActiveWorkers;
+			else --m_RunningTasks;
+		}
+
+		m_WorkDone.notify_all();
+	}
+}
+
+void JobSystem::RunJobs(const std::function<void(const uint32_t)>& _job, const uint64_t _generation, const uint32_t _jobCount)
+{
+	// A worker can wake after the ParallelFor it was woken for has returned and the next one has started. Its copy of
+	// the job may point into a dead stack frame, so indices are only claimed while the counter still carries the
+	// generation the job was copied with
+	const uint64_t generationBits = _generation << 32;
+	uint64_t next = m_NextJob.load();
+
+	while (true)
+	{
+		if ((next & ~0xFFFFFFFFull) != generationBits) break;
+
+		const uint32_t jobIndex = static_cast<uint32_t>(next);
+		if (jobIndex >= _jobCount) break;
+		if (!m_NextJob.compare_exchange_weak(next, next + 1)) continue;
+
+		_job(jobIndex);
+		next = m_NextJob.load();
+
+		if (m_JobsRemaining.fetch_sub(1) == 1)
+		{
+			// Take the lock so the wake up can't slip in between ParallelFor checking and going to sleep
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_WorkDone.notify_all();
+		}
+	}
+}
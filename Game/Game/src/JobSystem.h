@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads for data parallel work.
+// ParallelFor hands out job indices to the workers and the calling thread, and returns once every job has run.
+// Submit queues a background task that the next idle worker runs, ParallelFor work is always picked up first.
+class JobSystem
+{
+public:
+	JobSystem(const uint32_t _workerCount);
+	~JobSystem();
+
+	void ParallelFor(const uint32_t _jobCount, const std::function<void(const uint32_t)>& _job);
+	void Submit(std::function<void()> _task);		// Runs the task inline when there are no workers
+	void WaitForTasks();							// Returns once every submitted task has finished
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+private:
+	void WorkerLoop();
+	// Claims indices until the generation's jobs run out, or stops straight away once a newer ParallelFor has started
+	void RunJobs(const std::function<void(const uint32_t)>& _job, const uint64_t _generation, const uint32_t _jobCount);
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkDone;
+	std::function<void(const uint32_t)> m_Job;
+	std::deque<std::function<void()>> m_Tasks;
+	// Generation in the high 32 bits, next job index in the low 32
+	std::atomic<uint64_t> m_NextJob;
+	std::atomic<uint32_t> m_JobsRemaining;
+	uint32_t m_JobCount;			// Guarded by m_Mutex, workers take a copy with the job
+	uint32_t m_ActiveWorkers;		// Workers inside RunJobs, ParallelFor waits for them to leave before returning
+	uint32_t m_RunningTasks;		// Submitted tasks taken off the queue but not finished yet
+	uint64_t m_Generation;			// Bumped for every ParallelFor so sleeping workers know there is new work
+	bool m_Stopping;
+};
@@ -0,0 +1,195 @@
+#include "Ktx2.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#define HeaderSize 80			// Identifier, header and index up to the level index
+#define LevelIndexEntrySize 24
+
+namespace
+{
+	const unsigned char Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// Data format descriptor values from the Khronos Data Format specification
+	const uint32_t ModelRgbsda = 1;
+	const uint32_t ModelBc1a = 128;
+	const uint32_t ModelBc7 = 134;
+	const uint32_t PrimariesBt709 = 1;
+	const uint32_t TransferLinear = 1;
+	const uint32_t ChannelAlpha = 15;
+
+	// The 64-bit fields sit at offset 52, off their natural alignment
+#pragma pack(push, 1)
+	struct Header
+	{
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(Identifier) + sizeof(Header) == HeaderSize, "KTX2 header must be packed");
+
+	struct LevelIndexEntry
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	template<typename T>
+	void Append(std::vector<unsigned char>& _output, const T& _value)
+	{
+		const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(&_value);
+		_output.insert(_output.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	// Basic data format descriptor block, preceded by the descriptor's total size
+	std::vector<unsigned char> BuildDataFormatDescriptor(const VkFormat _format)
+	{
+		const bool blockCompressed = TextureCompression::IsBlockCompressed(_format);
+		const uint32_t sampleCount = blockCompressed ? 1 : 4;
+		const uint32_t blockSize = 24 + 16 * sampleCount;
+		const uint32_t model = _format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? ModelBc1a : _format == VK_FORMAT_BC7_UNORM_BLOCK ? ModelBc7 : ModelRgbsda;
+		const uint32_t blockDimension = blockCompressed ? 3 : 0;	// Stored as size - 1
+
+		std::vector<unsigned char> descriptor;
+		Append(descriptor, 4 + blockSize);
+		Append(descriptor, 0u);										// Khronos vendor, basic descriptor type
+		Append(descriptor, 2u | (blockSize << 16));					// Version 1.3
+		Append(descriptor, model | (PrimariesBt709 << 8) | (TransferLinear << 16));
+		Append(descriptor, blockDimension | (blockDimension << 8));
+		Append(descriptor, TextureCompression::GetBlockSize(_format));	// Bytes in plane 0, the other seven planes are unused
+		Append(descriptor, 0u);
+
+		if (blockCompressed)
+		{
+			// One sample covering the whole block
+			const uint32_t bitLength = TextureCompression::GetBlockSize(_format) * 8 - 1;
+			Append(descriptor, bitLength << 16);
+			Append(descriptor, 0u);
+			Append(descriptor, 0u);
+			Append(descriptor, 0xFFFFFFFFu);
+		}
+		else
+		{
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				const uint32_t channelType = channel == 3 ? ChannelAlpha : channel;
+				Append(descriptor, (channel * 8) | (7u << 16) | (channelType << 24));
+				Append(descriptor, 0u);
+				Append(descriptor, 0u);
+				Append(descriptor, 255u);
+			}
+		}
+
+		return descriptor;
+	}
+
+	uint64_t AlignUp(const uint64_t _value, const uint64_t _alignment)
+	{
+		return (_value + _alignment - 1) / _alignment * _alignment;
+	}
+}
+
+bool Ktx2::Load(const std::string& _path, TextureData& _texture)
+{
+	std::ifstream file(_path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (bytes.size() < HeaderSize || std::memcmp(bytes.data(), Identifier, sizeof(Identifier)) != 0) return false;
+
+	Header header{};
+	std::memcpy(&header, bytes.data() + sizeof(Identifier), sizeof(header));
+
+	const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+	if (format != VK_FORMAT_R8G8B8A8_UNORM && !TextureCompression::IsBlockCompressed(format)) return false;
+	if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1) return false;
+	if (header.supercompressionScheme != 0 || header.levelCount == 0) return false;
+	if (header.levelCount > TextureCompression::GetMipLevelCount(header.pixelWidth, header.pixelHeight)) return false;
+	if (HeaderSize + static_cast<uint64_t>(header.levelCount) * LevelIndexEntrySize > bytes.size()) return false;
+
+	TextureData texture{};
+	texture.format = format;
+	texture.width = header.pixelWidth;
+	texture.height = header.pixelHeight;
+	texture.levels.resize(header.levelCount);
+
+	for (uint32_t level = 0; level < header.levelCount; ++level)
+	{
+		LevelIndexEntry entry{};
+		std::memcpy(&entry, bytes.data() + HeaderSize + level * LevelIndexEntrySize, sizeof(entry));
+
+		const uint64_t levelSize = TextureCompression::GetLevelSize(format, std::max(1u, texture.width >> level), std::max(1u, texture.height >> level));
+		if (entry.byteLength != levelSize || entry.byteOffset > bytes.size() || bytes.size() - entry.byteOffset < entry.byteLength) return false;
+
+		texture.levels[level].assign(bytes.begin() + entry.byteOffset, bytes.begin() + entry.byteOffset + entry.byteLength);
+	}
+
+	_texture = std::move(texture);
+	return true;
+}
+
+void Ktx2::Save(const std::string& _path, const TextureData& _texture)
+{
+	const uint32_t levelCount = static_cast<uint32_t>(_texture.levels.size());
+	const std::vector<unsigned char> descriptor = BuildDataFormatDescriptor(_texture.format);
+
+	// Level data follows the descriptor, smallest level first, each aligned to its block size and to 4 bytes
+	const uint64_t alignment = std::max(4u, TextureCompression::GetBlockSize(_texture.format));
+	const uint32_t dfdByteOffset = HeaderSize + levelCount * LevelIndexEntrySize;
+	std::vector<LevelIndexEntry> levelIndex(levelCount);
+	uint64_t offset = dfdByteOffset + descriptor.size();
+
+	for (uint32_t level = levelCount; level-- > 0;)
+	{
+		offset = AlignUp(offset, alignment);
+		levelIndex[level].byteOffset = offset;
+		levelIndex[level].byteLength = _texture.levels[level].size();
+		levelIndex[level].uncompressedByteLength = _texture.levels[level].size();
+		offset += _texture.levels[level].size();
+	}
+
+	Header header{};
+	header.vkFormat = static_cast<uint32_t>(_texture.format);
+	header.typeSize = 1;
+	header.pixelWidth = _texture.width;
+	header.pixelHeight = _texture.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = dfdByteOffset;
+	header.dfdByteLength = static_cast<uint32_t>(descriptor.size());
+
+	std::vector<unsigned char> output;
+	output.reserve(static_cast<size_t>(offset));
+	output.insert(output.end(), Identifier, Identifier + sizeof(Identifier));
+	Append(output, header);
+	for (const LevelIndexEntry& entry : levelIndex) Append(output, entry);
+	output.insert(output.end(), descriptor.begin(), descriptor.end());
+
+	for (uint32_t level = levelCount; level-- > 0;)
+	{
+		output.resize(static_cast<size_t>(levelIndex[level].byteOffset), 0);
+		output.insert(output.end(), _texture.levels[level].begin(), _texture.levels[level].end());
+	}
+
+	std::ofstream file(_path, std::ios::binary);
+	if (!file.is_open()) throw std::runtime_error("TEXTURE ERROR: Failed to open " + _path + "\n");
+
+	file.write(reinterpret_cast<const char*>(output.data()), static_cast<std::streamsize>(output.size()));
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "TextureCompression.h"
+#include <string>
+
+// Reads and writes the subset of KTX2 the texture cooker produces: one 2D image with its mip levels, no array layers,
+// cube faces or supercompression, in any format TextureCompression knows about
+class Ktx2
+{
+public:
+	// False when the file is missing or isn't something this reader understands, callers fall back to the source image
+	static bool Load(const std::string& _path, TextureData& _texture);
+	static void Save(const std::string& _path, const TextureData& _texture);
+};
@@ -0,0 +1,110 @@
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(const uint64_t _size) :
+	m_Size(0),
+	m_UsedSize(0)
+{
+	Init(_size);
+}
+
+void RangeAllocator::Init(const uint64_t _size)
+{
+	m_Size = _size;
+	m_UsedSize = 0;
+	m_FreeRangesByOffset.clear();
+	m_FreeRangesBySize.clear();
+
+	if (_size > 0)
+	{
+		InsertFreeRange(0, _size);
+	}
+}
+
+bool RangeAllocator::Allocate(const uint64_t _size, const uint64_t _alignment, uint64_t& _offset)
+{
+	if (_size == 0) return false;
+
+	const uint64_t alignment = _alignment > 0 ? _alignment : 1;
+
+	// Smallest range that can hold the request once its start has been aligned
+	for (auto iter = m_FreeRangesBySize.lower_bound(_size); iter != m_FreeRangesBySize.end(); ++iter)
+	{
+		const uint64_t rangeOffset = iter->second;
+		const uint64_t rangeSize = iter->first;
+		const uint64_t alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+		const uint64_t padding = alignedOffset - rangeOffset;
+
+		if (padding + _size > rangeSize) continue;
+
+		EraseFreeRange(m_FreeRangesByOffset.find(rangeOffset));
+
+		// Return the alignment padding and the tail to the free list
+		if (padding > 0) InsertFreeRange(rangeOffset, padding);
+		if (padding + _size < rangeSize) InsertFreeRange(alignedOffset + _size, rangeSize - padding - _size);
+
+		m_UsedSize += _size;
+		_offset = alignedOffset;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::Free(const uint64_t _offset, const uint64_t _size)
+{
+	uint64_t offset = _offset;
+	uint64_t size = _size;
+
+	m_UsedSize -= _size;
+
+	// Merge with the following range
+	auto next = m_FreeRangesByOffset.find(offset + size);
+	if (next != m_FreeRangesByOffset.end())
+	{
+		size += next->second;
+		EraseFreeRange(next);
+	}
+
+	// Merge with the preceding range
+	auto previous = m_FreeRangesByOffset.lower_bound(offset);
+	if (previous != m_FreeRangesByOffset.begin())
+	{
+		--previous;
+
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			EraseFreeRange(previous);
+		}
+	}
+
+	InsertFreeRange(offset, size);
+}
+
+uint64_t RangeAllocator::GetLargestFreeRange() const
+{
+	return m_FreeRangesBySize.empty() ? 0 : m_FreeRangesBySize.rbegin()->first;
+}
+
+void RangeAllocator::InsertFreeRange(const uint64_t _offset, const uint64_t _size)
+{
+	m_FreeRangesByOffset[_offset] = _size;
+	m_FreeRangesBySize.emplace(_size, _offset);
+}
+
+void RangeAllocator::EraseFreeRange(const std::map<uint64_t, uint64_t>::iterator& _iter)
+{
+	auto range = m_FreeRangesBySize.equal_range(_iter->second);
+
+	for (auto iter = range.first; iter != range.second; ++iter)
+	{
+		if (iter->second == _iter->first)
+		{
+			m_FreeRangesBySize.erase(iter);
+			break;
+		}
+	}
+
+	m_FreeRangesByOffset.erase(_iter);
+}
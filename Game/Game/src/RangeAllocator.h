@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Best-fit free-list over a linear range of bytes (or elements), coalescing neighbours on free.
+// Used to carve resources out of large device memory blocks and shared buffers.
+class RangeAllocator
+{
+public:
+	RangeAllocator(const uint64_t _size = 0);
+
+	void Init(const uint64_t _size);
+	bool Allocate(const uint64_t _size, const uint64_t _alignment, uint64_t& _offset);
+	void Free(const uint64_t _offset, const uint64_t _size);
+	uint64_t GetSize() const { return m_Size; }
+	uint64_t GetUsedSize() const { return m_UsedSize; }
+	uint64_t GetFreeSize() const { return m_Size - m_UsedSize; }
+	uint64_t GetLargestFreeRange() const;
+	uint32_t GetFreeRangeCount() const { return static_cast<uint32_t>(m_FreeRangesByOffset.size()); }
+	bool IsEmpty() const { return m_UsedSize == 0; }
+
+private:
+	void InsertFreeRange(const uint64_t _offset, const uint64_t _size);
+	void EraseFreeRange(const std::map<uint64_t, uint64_t>::iterator& _iter);
+
+private:
+	uint64_t m_Size;
+	uint64_t m_UsedSize;
+	std::map<uint64_t, uint64_t> m_FreeRangesByOffset;		// Offset -> size, used to coalesce neighbours
+	std::multimap<uint64_t, uint64_t> m_FreeRangesBySize;	// Size -> offset, used for best-fit lookups
+};
@@ -0,0 +1,96 @@
+#include "Scene.h"
+#include "Vulkan/VulkanTexture.h"
+#include <stdexcept>
+
+Scene::Scene(Scene&& _other) noexcept :
+	m_Registry(std::move(_other.m_Registry)),
+	m_Transforms(std::move(_other.m_Transforms)),
+	m_TransformEntities(std::move(_other.m_TransformEntities))
+{
+	_other.Clear();
+}
+
+Scene& Scene::operator=(Scene&& _other) noexcept
+{
+	if (this != &_other)
+	{
+		Clear();
+		m_Registry = std::move(_other.m_Registry);
+		m_Transforms = std::move(_other.m_Transforms);
+		m_TransformEntities = std::move(_other.m_TransformEntities);
+		_other.Clear();
+	}
+
+	return *this;
+}
+
+Scene::~Scene()
+{
+	Clear();
+}
+
+void Scene::Clear()
+{
+	for (const MeshComponent& mesh : m_Registry.GetPool<MeshComponent>().GetComponents())
+	{
+		VulkanMeshRegistry::Release(mesh.meshId);
+	}
+
+	for (const MaterialComponent& material : m_Registry.GetPool<MaterialComponent>().GetComponents())
+	{
+		VulkanTexture::Release(material.texId);
+	}
+
+	m_Registry.Clear();
+	m_Transforms.Clear();
+	m_TransformEntities.clear();
+}
+
+Entity Scene::CreateEntity(const glm::vec3& _position, const glm::vec3& _rotation, const glm::vec3& _scale, const Entity _parent)
+{
+	if (_parent != InvalidEntity && !m_Registry.IsAlive(_parent))
+	{
+		throw std::runtime_error("SCENE ERROR: An entity's parent must be created before it\n");
+	}
+
+	const glm::quat rotation = glm::angleAxis(_rotation.x, glm::vec3(1.0f, 0.0f, 0.0f)) *
+							   glm::angleAxis(_rotation.y, glm::vec3(0.0f, 1.0f, 0.0f)) *
+							   glm::angleAxis(_rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+
+	const TransformId parentTransform = _parent != InvalidEntity ? GetTransform(_parent) : InvalidTransformId;
+	const TransformId transformId = m_Transforms.Create(_position, rotation, _scale, parentTransform);
+
+	const Entity entity = m_Registry.Create();
+	m_Registry.Add<TransformComponent>(entity, transformId);
+	m_TransformEntities.emplace_back(entity);
+	return entity;
+}
+
+Entity Scene::CreateRenderable(const VulkanPrimative::Primative _primative, const std::string& _textureName, const glm::vec3& _position, const glm::vec3& _rotation, const glm::vec3& _scale, const Entity _parent)
+{
+	// Entities built from the same primitive share one copy of it
+	return CreateRenderable(VulkanMeshRegistry::Acquire(_primative), _textureName, _position, _rotation, _scale, _parent);
+}
+
+Entity Scene::CreateRenderable(const MeshId _meshId, const std::string& _textureName, const glm::vec3& _position, const glm::vec3& _rotation, const glm::vec3& _scale, const Entity _parent)
+{
+	if (_meshId == InvalidMeshId)
+	{
+		throw std::runtime_error("SCENE ERROR: Renderable entities need a mesh, use CreateEntity for empty ones\n");
+	}
+
+	// Element 0 of the bindless table only stands in while a texture loads, it isn't a default for untextured entities
+	if (_textureName.empty())
+	{
+		VulkanMeshRegistry::Release(_meshId);
+		throw std::runtime_error("SCENE ERROR: Renderable entities need a texture\n");
+	}
+
+	const Entity entity = CreateEntity(_position, _rotation, _scale, _parent);
+	m_Registry.Add<MeshComponent>(entity, _meshId);
+
+	// Textures loaded from the same file are shared too, each entity holds one reference
+	VulkanTexture texture;
+	m_Registry.Add<MaterialComponent>(entity, texture.CreateTextureImage(_textureName));
+	return entity;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Ecs.h"
+#include "TransformSystem.h"
+#include "Vulkan/VulkanPrimative.h"
+#include "Vulkan/VulkanMeshRegistry.h"
+#include <string>
+
+// Every entity has one, the transform's data lives in the scene's TransformSystem
+struct TransformComponent
+{
+	TransformId transformId;
+};
+
+// The entity holds one reference on the mesh until it's cleared with the scene
+struct MeshComponent
+{
+	MeshId meshId;
+};
+
+// The entity holds one reference on the texture. texId is the texture's id, VulkanTexture::GetBoundSlot maps it to the
+// bindless table element it draws with, element 0 (the placeholder) until the texture is resident
+struct MaterialComponent
+{
+	uint32_t texId;
+};
+
+// Entities and the transforms they own. Renderable entities carry a mesh and a material on top of their transform.
+// A transform id doubles as the renderer's object index (instance, bounds and BVH slot), so entities live until the
+// scene is cleared rather than being destroyed one at a time
+class Scene
+{
+public:
+	Scene() = default;
+	Scene(const Scene&) = delete;
+	Scene(Scene&& _other) noexcept;
+	Scene& operator=(const Scene&) = delete;
+	Scene& operator=(Scene&& _other) noexcept;
+	~Scene();
+
+	// Releases every entity's mesh and texture, the buffers and images are destroyed once nothing uses them. The GPU must
+	// be done with the scene
+	void Clear();
+
+	// Rotation is Euler angles in radians, applied about x, then y, then z. A parent must be created before its children
+	Entity CreateEntity(const glm::vec3& _position, const glm::vec3& _rotation = glm::vec3(0.0f), const glm::vec3& _scale = glm::vec3(1.0f), const Entity _parent = InvalidEntity);
+	Entity CreateRenderable(const VulkanPrimative::Primative _primative, const std::string& _textureName, const glm::vec3& _position, const glm::vec3& _rotation = glm::vec3(0.0f), const glm::vec3& _scale = glm::vec3(1.0f), const Entity _parent = InvalidEntity);
+	// Takes over one reference on a mesh acquired from VulkanMeshRegistry, for geometry that isn't a primitive
+	Entity CreateRenderable(const MeshId _meshId, const std::string& _textureName, const glm::vec3& _position, const glm::vec3& _rotation = glm::vec3(0.0f), const glm::vec3& _scale = glm::vec3(1.0f), const Entity _parent = InvalidEntity);
+
+	EntityRegistry& GetRegistry() { return m_Registry; }
+	const EntityRegistry& GetRegistry() const { return m_Registry; }
+	TransformSystem& GetTransforms() { return m_Transforms; }
+	const TransformSystem& GetTransforms() const { return m_Transforms; }
+	TransformId GetTransform(const Entity _entity) const { return m_Registry.Get<TransformComponent>(_entity).transformId; }
+	Entity GetEntity(const TransformId _transformId) const { return m_TransformEntities[_transformId]; }
+	uint32_t GetObjectCount() const { return m_Transforms.GetCount(); }
+
+private:
+	EntityRegistry m_Registry;
+	TransformSystem m_Transforms;
+	std::vector<Entity> m_TransformEntities;		// Owner of each transform, for going from an object index back to its components
+};
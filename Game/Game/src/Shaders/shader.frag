@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 // Ins
 layout (location = 0) in vec3 vertex_color;
@@ -10,9 +11,9 @@ layout (location = 0) out vec4 fragment_color;
 
 // Sampler & textures
 layout (set = 1, binding = 0) uniform sampler textureSampler;
-layout (set = 2, binding = 0) uniform texture2D textures[2];
+layout (set = 2, binding = 0) uniform texture2D textures[];		// Bindless table, texId is the element the object's texture is bound to
 
 void main()
 {
-	fragment_color = texture(sampler2D(textures[texId], textureSampler), vertex_uv);
+	fragment_color = texture(sampler2D(textures[nonuniformEXT(texId)], textureSampler), vertex_uv);
 }
\ No newline at end of file
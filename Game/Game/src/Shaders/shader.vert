@@ -1,6 +1,6 @@
 #version 450
 
-// Ins
+// Ins, compact vertices arrive through the same inputs with the decode folded into the model matrix
 layout (location = 0) in vec3 vertex_position;
 layout (location = 1) in vec3 vertex_color;
 layout (location = 2) in vec2 vertex_uv;
@@ -17,17 +17,25 @@ layout (set = 0, binding = 0) uniform UBO
 	mat4 proj;
 } u_ViewProj;
 
-// Push constants
-layout (push_constant) uniform pushConstants
+// Per-instance data, firstInstance of each draw points at its group's slice
+struct ObjectData
 {
 	mat4 model;
 	int texId;
-} u_PushConstants;
+	uint meshId;
+};
+
+layout (std430, set = 0, binding = 1) readonly buffer Instances
+{
+	ObjectData objects[];
+} u_Instances;
 
 void main()
 {
-	gl_Position = u_ViewProj.proj * u_ViewProj.view * u_PushConstants.model * vec4(vertex_position, 1.0f);
+	ObjectData object = u_Instances.objects[gl_InstanceIndex];
+
+	gl_Position = u_ViewProj.proj * u_ViewProj.view * object.model * vec4(vertex_position, 1.0f);
 	vertex_outColor = vertex_color;
 	vertex_outUV = vertex_uv;
-	outTexId = u_PushConstants.texId;
+	outTexId = object.texId;
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
-C:/VulkanSDK/1.3.236.0/Bin/glslc.exe shader.vert -o vert.spv
-C:/VulkanSDK/1.3.236.0/Bin/glslc.exe shader.frag -o frag.spv
-C:/VulkanSDK/1.3.236.0/Bin/glslc.exe skybox.vert -o skyboxVert.spv
-C:/VulkanSDK/1.3.236.0/Bin/glslc.exe skybox.frag -o skyboxFrag.spv
+cd /d "%~dp0"
+if not defined VULKAN_SDK set VULKAN_SDK=C:/VulkanSDK/1.3.236.0
+"%VULKAN_SDK%/Bin/glslc.exe" shader.vert -o vert.spv
+"%VULKAN_SDK%/Bin/glslc.exe" shader.frag -o frag.spv
+"%VULKAN_SDK%/Bin/glslc.exe" skybox.vert -o skyboxVert.spv
+"%VULKAN_SDK%/Bin/glslc.exe" skybox.frag -o skyboxFrag.spv
+"%VULKAN_SDK%/Bin/glslc.exe" cull.comp -o cull.spv
+"%VULKAN_SDK%/Bin/glslc.exe" depth_reduce.comp -o depthReduce.spv
 pause
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "TextureCompression.h"
+#include "JobSystem.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+#define TexelSize 4		// RGBA8 source texels
+
+namespace
+{
+	// BC7 4-bit index interpolation weights, out of 64
+	const uint32_t Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Dominant direction of a block's colours by power iteration on their covariance, starting along the bounding box
+	// diagonal so blocks with a clear gradient converge in a few steps
+	template<typename Vector, typename Matrix>
+	Vector GetPrincipalAxis(const Vector* _points, const uint32_t _count, const Vector& _mean)
+	{
+		Matrix covariance(0.0f);
+		Vector minimum = _points[0];
+		Vector maximum = _points[0];
+
+		for (uint32_t i = 0; i < _count; ++i)
+		{
+			const Vector offset = _points[i] - _mean;
+			covariance += glm::outerProduct(offset, offset);
+			minimum = glm::min(minimum, _points[i]);
+			maximum = glm::max(maximum, _points[i]);
+		}
+
+		Vector axis = maximum - minimum;
+		if (glm::dot(axis, axis) < 1e-6f) return Vector(0.0f);
+
+		for (uint32_t iteration = 0; iteration < 8; ++iteration)
+		{
+			const Vector next = covariance * axis;
+			const float length = glm::length(next);
+			if (length < 1e-6f) break;
+
+			axis = next / length;
+		}
+
+		return glm::normalize(axis);
+	}
+
+	// Endpoints at the extremes of the block's projection onto its principal axis
+	template<typename Vector, typename Matrix>
+	void GetEndpoints(const Vector* _points, const uint32_t _count, Vector& _low, Vector& _high)
+	{
+		Vector mean(0.0f);
+		for (uint32_t i = 0; i < _count; ++i) mean += _points[i];
+		mean /= static_cast<float>(_count);
+
+		const Vector axis = GetPrincipalAxis<Vector, Matrix>(_points, _count, mean);
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+
+		for (uint32_t i = 0; i < _count; ++i)
+		{
+			const float projection = glm::dot(_points[i] - mean, axis);
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		_low = glm::clamp(mean + axis * minProjection, Vector(0.0f), Vector(255.0f));
+		_high = glm::clamp(mean + axis * maxProjection, Vector(0.0f), Vector(255.0f));
+	}
+
+	uint16_t PackRgb565(const glm::vec3& _color)
+	{
+		const uint32_t r = static_cast<uint32_t>(_color.r * 31.0f / 255.0f + 0.5f);
+		const uint32_t g = static_cast<uint32_t>(_color.g * 63.0f / 255.0f + 0.5f);
+		const uint32_t b = static_cast<uint32_t>(_color.b * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	glm::vec3 UnpackRgb565(const uint16_t _color)
+	{
+		const uint32_t r = (_color >> 11) & 31;
+		const uint32_t g = (_color >> 5) & 63;
+		const uint32_t b = _color & 31;
+		return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+	}
+
+	template<typename Vector>
+	uint32_t FindNearest(const Vector& _color, const Vector* _palette, const uint32_t _paletteSize)
+	{
+		uint32_t best = 0;
+		float bestDistance = FLT_MAX;
+
+		for (uint32_t i = 0; i < _paletteSize; ++i)
+		{
+			const Vector offset = _color - _palette[i];
+			const float distance = glm::dot(offset, offset);
+
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = i;
+			}
+		}
+
+		return best;
+	}
+
+	// Block bits are written from the lowest bit of the lowest byte up
+	class BitWriter
+	{
+	public:
+		BitWriter(unsigned char* _output) : m_pOutput(_output), m_Position(0) { std::memset(_output, 0, 16); }
+
+		void Write(const uint32_t _value, const uint32_t _bitCount)
+		{
+			for (uint32_t bit = 0; bit < _bitCount; ++bit, ++m_Position)
+			{
+				if ((_value >> bit) & 1) m_pOutput[m_Position / 8] |= static_cast<unsigned char>(1 << (m_Position % 8));
+			}
+		}
+
+	private:
+		unsigned char* m_pOutput;
+		uint32_t m_Position;
+	};
+}
+
+uint32_t TextureCompression::GetMipLevelCount(const uint32_t _width, const uint32_t _height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(_width, _height); size > 1; size /= 2) ++levels;
+	return levels;
+}
+
+bool TextureCompression::IsBlockCompressed(const VkFormat _format)
+{
+	return _format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || _format == VK_FORMAT_BC7_UNORM_BLOCK;
+}
+
+uint32_t TextureCompression::GetBlockSize(const VkFormat _format)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:	return 8;
+	case VK_FORMAT_BC7_UNORM_BLOCK:		return 16;
+	default:							return TexelSize;
+	}
+}
+
+uint64_t TextureCompression::GetLevelSize(const VkFormat _format, const uint32_t _width, const uint32_t _height)
+{
+	if (!IsBlockCompressed(_format)) return static_cast<uint64_t>(_width) * _height * TexelSize;
+
+	// Partial blocks at the edges are stored whole
+	return static_cast<uint64_t>((_width + 3) / 4) * ((_height + 3) / 4) * GetBlockSize(_format);
+}
+
+uint64_t TextureCompression::GetChainSize(const VkFormat _format, const uint32_t _width, const uint32_t _height, const uint32_t _mipLevels)
+{
+	uint64_t bytes = 0;
+
+	for (uint32_t level = 0; level < _mipLevels; ++level)
+	{
+		bytes += GetLevelSize(_format, std::max(1u, _width >> level), std::max(1u, _height >> level));
+	}
+
+	return bytes;
+}
+
+void TextureCompression::BuildMipChain(TextureData& _texture, const uint32_t _mipLevels)
+{
+	_texture.levels.resize(1);
+	_texture.levels.reserve(_mipLevels);
+
+	uint32_t sourceWidth = _texture.width;
+	uint32_t sourceHeight = _texture.height;
+
+	for (uint32_t level = 1; level < _mipLevels; ++level)
+	{
+		const uint32_t width = std::max(1u, sourceWidth / 2);
+		const uint32_t height = std::max(1u, sourceHeight / 2);
+		const unsigned char* pSource = _texture.levels[level - 1].data();
+		std::vector<unsigned char>& destination = _texture.levels.emplace_back(static_cast<size_t>(width) * height * TexelSize);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, sourceHeight - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, sourceWidth - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+				for (uint32_t c = 0; c < TexelSize; ++c)
+				{
+					const uint32_t sum = pSource[(y0 * sourceWidth + x0) * TexelSize + c] + pSource[(y0 * sourceWidth + x1) * TexelSize + c] +
+										 pSource[(y1 * sourceWidth + x0) * TexelSize + c] + pSource[(y1 * sourceWidth + x1) * TexelSize + c];
+					destination[(static_cast<size_t>(y) * width + x) * TexelSize + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+
+		sourceWidth = width;
+		sourceHeight = height;
+	}
+}
+
+std::vector<unsigned char> TextureCompression::CompressLevel(const unsigned char* _pixels, const uint32_t _width, const uint32_t _height, const VkFormat _format, JobSystem* _pJobSystem)
+{
+	if (!IsBlockCompressed(_format))
+	{
+		return std::vector<unsigned char>(_pixels, _pixels + GetLevelSize(_format, _width, _height));
+	}
+
+	const uint32_t blocksX = (_width + 3) / 4;
+	const uint32_t blocksY = (_height + 3) / 4;
+	const uint32_t blockSize = GetBlockSize(_format);
+	std::vector<unsigned char> output(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+	auto compressRow = [&](const uint32_t _blockY)
+	{
+		unsigned char block[16 * TexelSize];
+
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			// Texels past the edge repeat the last row or column
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint32_t sourceY = std::min(_blockY * 4 + y, _height - 1);
+
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint32_t sourceX = std::min(blockX * 4 + x, _width - 1);
+					std::memcpy(block + (y * 4 + x) * TexelSize, _pixels + (static_cast<size_t>(sourceY) * _width + sourceX) * TexelSize, TexelSize);
+				}
+			}
+
+			unsigned char* pOutput = output.data() + (static_cast<size_t>(_blockY) * blocksX + blockX) * blockSize;
+			if (_format == VK_FORMAT_BC1_RGB_UNORM_BLOCK) CompressBc1Block(block, pOutput);
+			else CompressBc7Block(block, pOutput);
+		}
+	};
+
+	if (_pJobSystem) _pJobSystem->ParallelFor(blocksY, compressRow);
+	else for (uint32_t blockY = 0; blockY < blocksY; ++blockY) compressRow(blockY);
+
+	return output;
+}
+
+bool TextureCompression::IsOpaque(const unsigned char* _pixels, const uint32_t _width, const uint32_t _height)
+{
+	const size_t texelCount = static_cast<size_t>(_width) * _height;
+
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		if (_pixels[i * TexelSize + 3] != 255) return false;
+	}
+
+	return true;
+}
+
+const char* TextureCompression::GetFormatName(const VkFormat _format)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:	return "bc1";
+	case VK_FORMAT_BC7_UNORM_BLOCK:		return "bc7";
+	case VK_FORMAT_R8G8B8A8_UNORM:		return "rgba8";
+	default:							return "unknown";
+	}
+}
+
+std::string TextureCompression::GetCookedFileName(const std::string& _sourceName, const VkFormat _format)
+{
+	const std::string stem = _sourceName.substr(0, _sourceName.find_last_of('.'));
+	return "cooked/" + stem + "." + GetFormatName(_format) + ".ktx2";
+}
+
+void TextureCompression::CompressBc1Block(const unsigned char* _block, unsigned char* _output)
+{
+	glm::vec3 colors[16];
+	for (uint32_t i = 0; i < 16; ++i) colors[i] = glm::vec3(_block[i * TexelSize], _block[i * TexelSize + 1], _block[i * TexelSize + 2]);
+
+	glm::vec3 low;
+	glm::vec3 high;
+	GetEndpoints<glm::vec3, glm::mat3>(colors, 16, low, high);
+
+	// The larger endpoint goes first, which selects the opaque four colour mode
+	uint16_t color0 = PackRgb565(high);
+	uint16_t color1 = PackRgb565(low);
+	if (color0 < color1) std::swap(color0, color1);
+
+	uint32_t indices = 0;
+
+	// Equal endpoints leave every index at 0
+	if (color0 != color1)
+	{
+		const glm::vec3 endpoint0 = UnpackRgb565(color0);
+		const glm::vec3 endpoint1 = UnpackRgb565(color1);
+		const glm::vec3 palette[4] = { endpoint0, endpoint1, (endpoint0 * 2.0f + endpoint1) / 3.0f, (endpoint0 + endpoint1 * 2.0f) / 3.0f };
+
+		for (uint32_t i = 0; i < 16; ++i) indices |= FindNearest(colors[i], palette, 4) << (i * 2);
+	}
+
+	std::memcpy(_output, &color0, sizeof(color0));
+	std::memcpy(_output + 2, &color1, sizeof(color1));
+	std::memcpy(_output + 4, &indices, sizeof(indices));
+}
+
+void TextureCompression::CompressBc7Block(const unsigned char* _block, unsigned char* _output)
+{
+	// Mode 6 only: one subset, RGBA endpoints of 7 bits plus a p-bit each and 4-bit indices
+	glm::vec4 colors[16];
+	for (uint32_t i = 0; i < 16; ++i) colors[i] = glm::vec4(_block[i * TexelSize], _block[i * TexelSize + 1], _block[i * TexelSize + 2], _block[i * TexelSize + 3]);
+
+	glm::vec4 endpoints[2];
+	GetEndpoints<glm::vec4, glm::mat4>(colors, 16, endpoints[0], endpoints[1]);
+
+	// Each endpoint's p-bit is shared by its four channels, keep whichever lands closer
+	uint32_t quantized[2][4] = {};
+	uint32_t pBits[2] = {};
+	glm::vec4 palette[16];
+
+	for (uint32_t e = 0; e < 2; ++e)
+	{
+		float bestError = FLT_MAX;
+
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t candidate[4];
+			float error = 0.0f;
+
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				candidate[c] = static_cast<uint32_t>(std::clamp((endpoints[e][c] - p) / 2.0f + 0.5f, 0.0f, 127.0f));
+				const float difference = static_cast<float>(candidate[c] * 2 + p) - endpoints[e][c];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBits[e] = p;
+				std::memcpy(quantized[e], candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const uint32_t endpoint0 = quantized[0][c] * 2 + pBits[0];
+			const uint32_t endpoint1 = quantized[1][c] * 2 + pBits[1];
+			palette[i][c] = static_cast<float>(((64 - Bc7Weights[i]) * endpoint0 + Bc7Weights[i] * endpoint1 + 32) >> 6);
+		}
+	}
+
+	uint32_t indices[16];
+	for (uint32_t i = 0; i < 16; ++i) indices[i] = FindNearest(colors[i], palette, 16);
+
+	// The first index is stored without its top bit, swapping the endpoints keeps it clear
+	if (indices[0] >= 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (uint32_t& index : indices) index = 15 - index;
+	}
+
+	BitWriter writer(_output);
+	writer.Write(1 << 6, 7);
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writer.Write(quantized[0][c], 7);
+		writer.Write(quantized[1][c], 7);
+	}
+
+	writer.Write(pBits[0], 1);
+	writer.Write(pBits[1], 1);
+	writer.Write(indices[0], 3);
+	for (uint32_t i = 1; i < 16; ++i) writer.Write(indices[i], 4);
+}
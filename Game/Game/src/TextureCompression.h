@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class JobSystem;
+
+// An image and its mip levels, largest first. Levels are tightly packed rows of texels or of 4x4 blocks
+struct TextureData
+{
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<std::vector<unsigned char>> levels;
+};
+
+// CPU side texture processing shared by the texture cooker and the loader: mip chains of RGBA8 images and block
+// compression of each level. Formats are identified by their VkFormat, the same value KTX2 files store
+class TextureCompression
+{
+public:
+	static uint32_t GetMipLevelCount(const uint32_t _width, const uint32_t _height);
+	static bool IsBlockCompressed(const VkFormat _format);
+	static uint32_t GetBlockSize(const VkFormat _format);		// Bytes per 4x4 block, or per texel for uncompressed formats
+	static uint64_t GetLevelSize(const VkFormat _format, const uint32_t _width, const uint32_t _height);
+	static uint64_t GetChainSize(const VkFormat _format, const uint32_t _width, const uint32_t _height, const uint32_t _mipLevels);
+
+	// Fills in the levels below the top of an RGBA8 texture. 2x2 box filter, odd edges repeat their last texel.
+	// Filters the stored values like a linear blit does
+	static void BuildMipChain(TextureData& _texture, const uint32_t _mipLevels);
+
+	// Supports VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK and VK_FORMAT_R8G8B8A8_UNORM (a copy). Rows of
+	// blocks are spread over the job system when one is given
+	static std::vector<unsigned char> CompressLevel(const unsigned char* _pixels, const uint32_t _width, const uint32_t _height, const VkFormat _format, JobSystem* _pJobSystem = nullptr);
+	static bool IsOpaque(const unsigned char* _pixels, const uint32_t _width, const uint32_t _height);
+
+	// Cooked files sit next to their source as cooked/<name>.<format>.ktx2, relative to the texture directory
+	static const char* GetFormatName(const VkFormat _format);
+	static std::string GetCookedFileName(const std::string& _sourceName, const VkFormat _format);
+
+private:
+	static void CompressBc1Block(const unsigned char* _block, unsigned char* _output);
+	static void CompressBc7Block(const unsigned char* _block, unsigned char* _output);
+};
@@ -0,0 +1,172 @@
+#include "TextureCooker.h"
+#include "TextureCompression.h"
+#include "Ktx2.h"
+#include "JobSystem.h"
+#include "Utilities.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	const char* SourceExtensions[] = { ".jpg", ".jpeg", ".png", ".tga", ".bmp" };
+
+	VkFormat ParseFormat(const std::string& _name)
+	{
+		for (const VkFormat format : { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_R8G8B8A8_UNORM })
+		{
+			if (_name == TextureCompression::GetFormatName(format)) return format;
+		}
+
+		throw std::runtime_error("TEXTURE ERROR: Unknown texture format " + _name + ", expected bc7, bc1 or rgba8\n");
+	}
+}
+
+TextureCooker::TextureCooker(const TextureCookerSettings& _settings) :
+	m_Settings(_settings)
+{
+	if (m_Settings.threadCount == 0) m_Settings.threadCount = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool TextureCooker::IsRequested(int _argc, char* _argv[])
+{
+	for (int i = 1; i < _argc; ++i)
+	{
+		if (std::string(_argv[i]) == "--cook-textures") return true;
+	}
+
+	return false;
+}
+
+TextureCookerSettings TextureCooker::ParseArguments(int _argc, char* _argv[])
+{
+	TextureCookerSettings settings{};
+
+	for (int i = 1; i < _argc; ++i)
+	{
+		const std::string argument = _argv[i];
+		const bool hasValue = i + 1 < _argc;
+
+		if (argument == "--cook-textures") continue;
+		else if (argument == "--input" && hasValue) settings.inputFiles.emplace_back(_argv[++i]);
+		else if (argument == "--input-dir" && hasValue) settings.inputDirectory = _argv[++i];
+		else if (argument == "--threads" && hasValue) settings.threadCount = static_cast<uint32_t>(std::stoul(_argv[++i]));
+		else if (argument == "--formats" && hasValue)
+		{
+			// Comma separated, replaces the default list
+			settings.formats.clear();
+			std::stringstream names(_argv[++i]);
+
+			for (std::string name; std::getline(names, name, ',');)
+			{
+				if (!name.empty()) settings.formats.emplace_back(ParseFormat(name));
+			}
+		}
+		else throw std::runtime_error("TEXTURE ERROR: Unknown or incomplete argument " + argument + "\n");
+	}
+
+	return settings;
+}
+
+void TextureCooker::Run()
+{
+	std::vector<std::string> fileNames = m_Settings.inputFiles;
+
+	if (fileNames.empty())
+	{
+		if (!std::filesystem::is_directory(m_Settings.inputDirectory))
+		{
+			throw std::runtime_error("TEXTURE ERROR: " + m_Settings.inputDirectory + " isn't a directory\n");
+		}
+
+		for (const auto& entry : std::filesystem::directory_iterator(m_Settings.inputDirectory))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char _c) { return static_cast<char>(std::tolower(_c)); });
+
+			if (entry.is_regular_file() && std::find(std::begin(SourceExtensions), std::end(SourceExtensions), extension) != std::end(SourceExtensions))
+			{
+				fileNames.emplace_back(entry.path().filename().string());
+			}
+		}
+
+		std::sort(fileNames.begin(), fileNames.end());
+	}
+
+	std::filesystem::create_directories(std::filesystem::path(m_Settings.inputDirectory) / "cooked");
+
+	// Files are cooked one at a time, the blocks of each level are spread over the workers and this thread
+	JobSystem jobSystem(m_Settings.threadCount - 1);
+
+	for (const std::string& fileName : fileNames)
+	{
+		Cook(fileName, jobSystem);
+	}
+
+	std::cout << "Texture cooker: cooked " << fileNames.size() << " textures into " << (std::filesystem::path(m_Settings.inputDirectory) / "cooked").string() << '\n';
+}
+
+void TextureCooker::Cook(const std::string& _fileName, JobSystem& _jobSystem)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	const std::string sourcePath = (std::filesystem::path(m_Settings.inputDirectory) / _fileName).string();
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* pixels = Utilities::LoadImageFile(sourcePath, &width, &height, &channels);
+	if (!pixels) throw std::runtime_error("TEXTURE ERROR: Failed to load texture file " + sourcePath + "\n");
+
+	TextureData source{};
+	source.width = static_cast<uint32_t>(width);
+	source.height = static_cast<uint32_t>(height);
+	source.levels.emplace_back(pixels, pixels + TextureCompression::GetLevelSize(VK_FORMAT_R8G8B8A8_UNORM, source.width, source.height));
+	Utilities::FreeImage(pixels);
+
+	TextureCompression::BuildMipChain(source, TextureCompression::GetMipLevelCount(source.width, source.height));
+
+	// BC1's opaque mode drops alpha, so it's only offered for sources without any
+	const bool opaque = TextureCompression::IsOpaque(source.levels[0].data(), source.width, source.height);
+	const uint64_t sourceBytes = TextureCompression::GetChainSize(VK_FORMAT_R8G8B8A8_UNORM, source.width, source.height, static_cast<uint32_t>(source.levels.size()));
+	std::cout << _fileName << " (" << source.width << "x" << source.height << ", " << source.levels.size() << " levels)\n";
+
+	for (const VkFormat format : m_Settings.formats)
+	{
+		if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK && !opaque)
+		{
+			std::cout << "\tbc1: skipped, the source has alpha\n";
+			continue;
+		}
+
+		const auto formatStart = std::chrono::high_resolution_clock::now();
+
+		TextureData cooked{};
+		cooked.format = format;
+		cooked.width = source.width;
+		cooked.height = source.height;
+
+		for (uint32_t level = 0; level < source.levels.size(); ++level)
+		{
+			const uint32_t levelWidth = std::max(1u, source.width >> level);
+			const uint32_t levelHeight = std::max(1u, source.height >> level);
+			cooked.levels.emplace_back(TextureCompression::CompressLevel(source.levels[level].data(), levelWidth, levelHeight, format, &_jobSystem));
+		}
+
+		const std::string cookedPath = (std::filesystem::path(m_Settings.inputDirectory) / TextureCompression::GetCookedFileName(_fileName, format)).string();
+		Ktx2::Save(cookedPath, cooked);
+
+		const uint64_t cookedBytes = TextureCompression::GetChainSize(format, cooked.width, cooked.height, static_cast<uint32_t>(cooked.levels.size()));
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - formatStart).count();
+		std::cout << '\t' << TextureCompression::GetFormatName(format) << ": " << cookedBytes << " bytes";
+		if (TextureCompression::IsBlockCompressed(format)) std::cout << " (" << static_cast<double>(sourceBytes) / cookedBytes << "x smaller than RGBA8)";
+		std::cout << " in " << milliseconds << " ms\n";
+	}
+
+	const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "\tdone in " << milliseconds << " ms\n";
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class JobSystem;
+
+struct TextureCookerSettings
+{
+	std::string inputDirectory = "res/textures";	// Sources are read from here, cooked files go to its cooked folder
+	std::vector<std::string> inputFiles;			// Relative to the input directory, empty cooks every image in it
+	std::vector<VkFormat> formats = { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_R8G8B8A8_UNORM };
+	uint32_t threadCount = 0;						// 0 uses every hardware thread
+};
+
+// Offline conversion of source images into KTX2 files with full mip chains, one file per format so the loader can
+// pick the best one the device samples. Runs without a window or device
+class TextureCooker
+{
+public:
+	TextureCooker(const TextureCookerSettings& _settings);
+
+	void Run();
+	static bool IsRequested(int _argc, char* _argv[]);
+	static TextureCookerSettings ParseArguments(int _argc, char* _argv[]);
+
+private:
+	void Cook(const std::string& _fileName, JobSystem& _jobSystem);
+
+private:
+	TextureCookerSettings m_Settings;
+};
@@ -0,0 +1,236 @@
+#include "TransformSystem.h"
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define TransformBatchWidth 4
+
+namespace
+{
+	uint32_t LowestSetBit(const uint64_t _bits)
+	{
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward64(&index, _bits);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(_bits));
+#endif
+	}
+
+	// Column by column, each result column is the parent's columns weighted by the child's column
+	void MultiplyMatrices(const glm::mat4& _parent, const glm::mat4& _child, glm::mat4& _result)
+	{
+		const __m128 parent0 = _mm_loadu_ps(&_parent[0][0]);
+		const __m128 parent1 = _mm_loadu_ps(&_parent[1][0]);
+		const __m128 parent2 = _mm_loadu_ps(&_parent[2][0]);
+		const __m128 parent3 = _mm_loadu_ps(&_parent[3][0]);
+
+		for (int column = 0; column < 4; ++column)
+		{
+			const __m128 weighted = _mm_add_ps(_mm_add_ps(_mm_mul_ps(parent0, _mm_set1_ps(_child[column][0])), _mm_mul_ps(parent1, _mm_set1_ps(_child[column][1]))),
+											   _mm_add_ps(_mm_mul_ps(parent2, _mm_set1_ps(_child[column][2])), _mm_mul_ps(parent3, _mm_set1_ps(_child[column][3]))));
+			_mm_storeu_ps(&_result[column][0], weighted);
+		}
+	}
+}
+
+void TransformSystem::Clear()
+{
+	m_Count = 0;
+	m_PositionX.clear();
+	m_PositionY.clear();
+	m_PositionZ.clear();
+	m_RotationX.clear();
+	m_RotationY.clear();
+	m_RotationZ.clear();
+	m_RotationW.clear();
+	m_ScaleX.clear();
+	m_ScaleY.clear();
+	m_ScaleZ.clear();
+	m_WorldMatrices.clear();
+	m_Parents.clear();
+	m_FirstChildren.clear();
+	m_NextSiblings.clear();
+	m_DirtyBits.clear();
+}
+
+TransformId TransformSystem::Create(const glm::vec3& _position, const glm::quat& _rotation, const glm::vec3& _scale, const TransformId _parent)
+{
+	if (_parent != InvalidTransformId && _parent >= m_Count)
+	{
+		throw std::runtime_error("TRANSFORM ERROR: A transform's parent must be created before it\n");
+	}
+
+	// Grow a whole batch at a time, padding is an identity transform nobody reads
+	if (m_Count == m_PositionX.size())
+	{
+		const size_t paddedCount = m_Count + TransformBatchWidth;
+		m_PositionX.resize(paddedCount, 0.0f);
+		m_PositionY.resize(paddedCount, 0.0f);
+		m_PositionZ.resize(paddedCount, 0.0f);
+		m_RotationX.resize(paddedCount, 0.0f);
+		m_RotationY.resize(paddedCount, 0.0f);
+		m_RotationZ.resize(paddedCount, 0.0f);
+		m_RotationW.resize(paddedCount, 1.0f);
+		m_ScaleX.resize(paddedCount, 1.0f);
+		m_ScaleY.resize(paddedCount, 1.0f);
+		m_ScaleZ.resize(paddedCount, 1.0f);
+		m_WorldMatrices.resize(paddedCount, glm::mat4(1.0f));
+	}
+
+	const TransformId id = m_Count++;
+	m_Parents.emplace_back(_parent);
+	m_FirstChildren.emplace_back(InvalidTransformId);
+	m_NextSiblings.emplace_back(InvalidTransformId);
+	m_DirtyBits.resize((m_Count + 63) / 64, 0);
+
+	if (_parent != InvalidTransformId)
+	{
+		m_NextSiblings[id] = m_FirstChildren[_parent];
+		m_FirstChildren[_parent] = id;
+	}
+
+	SetPosition(id, _position);
+	SetRotation(id, _rotation);
+	SetScale(id, _scale);
+	return id;
+}
+
+void TransformSystem::SetPosition(const TransformId _id, const glm::vec3& _position)
+{
+	m_PositionX[_id] = _position.x;
+	m_PositionY[_id] = _position.y;
+	m_PositionZ[_id] = _position.z;
+	MarkDirty(_id);
+}
+
+void TransformSystem::SetRotation(const TransformId _id, const glm::quat& _rotation)
+{
+	m_RotationX[_id] = _rotation.x;
+	m_RotationY[_id] = _rotation.y;
+	m_RotationZ[_id] = _rotation.z;
+	m_RotationW[_id] = _rotation.w;
+	MarkDirty(_id);
+}
+
+void TransformSystem::SetScale(const TransformId _id, const glm::vec3& _scale)
+{
+	m_ScaleX[_id] = _scale.x;
+	m_ScaleY[_id] = _scale.y;
+	m_ScaleZ[_id] = _scale.z;
+	MarkDirty(_id);
+}
+
+void TransformSystem::Update(std::vector<TransformId>& _updated)
+{
+	for (uint32_t word = 0; word < m_DirtyBits.size(); ++word)
+	{
+		uint64_t bits = m_DirtyBits[word];
+		m_DirtyBits[word] = 0;
+
+		while (bits)
+		{
+			// The whole batch around the first flagged transform is rebuilt, clean ones come out unchanged
+			const uint32_t batchBit = LowestSetBit(bits) & ~(TransformBatchWidth - 1);
+			const uint32_t first = word * 64 + batchBit;
+			ComposeBatch(first);
+
+			// In index order, so a parent in the same batch is final before its children use it
+			for (TransformId id = first; id < first + TransformBatchWidth && id < m_Count; ++id)
+			{
+				const TransformId parent = m_Parents[id];
+				if (parent != InvalidTransformId) MultiplyMatrices(m_WorldMatrices[parent], m_WorldMatrices[id], m_WorldMatrices[id]);
+
+				if (!(bits & (1ull << (id % 64)))) continue;
+
+				_updated.emplace_back(id);
+
+				// Children always come later, those in this word join the current pass
+				for (TransformId child = m_FirstChildren[id]; child != InvalidTransformId; child = m_NextSiblings[child])
+				{
+					if (child / 64 == word) bits |= 1ull << (child % 64);
+					else MarkDirty(child);
+				}
+			}
+
+			bits &= ~(((1ull << TransformBatchWidth) - 1) << batchBit);
+		}
+	}
+}
+
+void TransformSystem::ComposeBatch(const uint32_t _first)
+{
+	// Translation * rotation * scale written out per element, the rotation columns come straight from the quaternion
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 x = _mm_loadu_ps(&m_RotationX[_first]);
+	const __m128 y = _mm_loadu_ps(&m_RotationY[_first]);
+	const __m128 z = _mm_loadu_ps(&m_RotationZ[_first]);
+	const __m128 w = _mm_loadu_ps(&m_RotationW[_first]);
+	const __m128 x2 = _mm_add_ps(x, x);
+	const __m128 y2 = _mm_add_ps(y, y);
+	const __m128 z2 = _mm_add_ps(z, z);
+
+	const __m128 xx = _mm_mul_ps(x, x2);
+	const __m128 yy = _mm_mul_ps(y, y2);
+	const __m128 zz = _mm_mul_ps(z, z2);
+	const __m128 xy = _mm_mul_ps(x, y2);
+	const __m128 xz = _mm_mul_ps(x, z2);
+	const __m128 yz = _mm_mul_ps(y, z2);
+	const __m128 wx = _mm_mul_ps(w, x2);
+	const __m128 wy = _mm_mul_ps(w, y2);
+	const __m128 wz = _mm_mul_ps(w, z2);
+
+	const __m128 scaleX = _mm_loadu_ps(&m_ScaleX[_first]);
+	const __m128 scaleY = _mm_loadu_ps(&m_ScaleY[_first]);
+	const __m128 scaleZ = _mm_loadu_ps(&m_ScaleZ[_first]);
+
+	// One register per matrix element across the batch
+	__m128 column0X = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scaleX);
+	__m128 column0Y = _mm_mul_ps(_mm_add_ps(xy, wz), scaleX);
+	__m128 column0Z = _mm_mul_ps(_mm_sub_ps(xz, wy), scaleX);
+	__m128 column0W = _mm_setzero_ps();
+
+	__m128 column1X = _mm_mul_ps(_mm_sub_ps(xy, wz), scaleY);
+	__m128 column1Y = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scaleY);
+	__m128 column1Z = _mm_mul_ps(_mm_add_ps(yz, wx), scaleY);
+	__m128 column1W = _mm_setzero_ps();
+
+	__m128 column2X = _mm_mul_ps(_mm_add_ps(xz, wy), scaleZ);
+	__m128 column2Y = _mm_mul_ps(_mm_sub_ps(yz, wx), scaleZ);
+	__m128 column2Z = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scaleZ);
+	__m128 column2W = _mm_setzero_ps();
+
+	__m128 column3X = _mm_loadu_ps(&m_PositionX[_first]);
+	__m128 column3Y = _mm_loadu_ps(&m_PositionY[_first]);
+	__m128 column3Z = _mm_loadu_ps(&m_PositionZ[_first]);
+	__m128 column3W = one;
+
+	// Transposing turns each element-per-register group into one matrix column per register
+	_MM_TRANSPOSE4_PS(column0X, column0Y, column0Z, column0W);
+	_MM_TRANSPOSE4_PS(column1X, column1Y, column1Z, column1W);
+	_MM_TRANSPOSE4_PS(column2X, column2Y, column2Z, column2W);
+	_MM_TRANSPOSE4_PS(column3X, column3Y, column3Z, column3W);
+
+	const __m128 columns[4][TransformBatchWidth] =
+	{
+		{ column0X, column0Y, column0Z, column0W },
+		{ column1X, column1Y, column1Z, column1W },
+		{ column2X, column2Y, column2Z, column2W },
+		{ column3X, column3Y, column3Z, column3W }
+	};
+
+	for (uint32_t lane = 0; lane < TransformBatchWidth; ++lane)
+	{
+		glm::mat4& world = m_WorldMatrices[_first + lane];
+
+		for (int column = 0; column < 4; ++column)
+		{
+			_mm_storeu_ps(&world[column][0], columns[column][lane]);
+		}
+	}
+}
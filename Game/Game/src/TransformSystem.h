@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <cstdint>
+
+typedef uint32_t TransformId;
+static constexpr TransformId InvalidTransformId = UINT32_MAX;
+
+// Local transforms in structure-of-arrays form with a world matrix per transform.
+// Setters only flag the transform, Update rebuilds the world matrices of flagged transforms (and everything below them)
+// four at a time with SSE. Parents must be created before their children, so one pass in index order sees every
+// parent's world matrix before its children need it.
+class TransformSystem
+{
+public:
+	void Clear();
+	TransformId Create(const glm::vec3& _position, const glm::quat& _rotation, const glm::vec3& _scale, const TransformId _parent = InvalidTransformId);
+
+	void SetPosition(const TransformId _id, const glm::vec3& _position);
+	void SetRotation(const TransformId _id, const glm::quat& _rotation);
+	void SetScale(const TransformId _id, const glm::vec3& _scale);
+
+	// Appends every transform whose world matrix changed, in ascending order
+	void Update(std::vector<TransformId>& _updated);
+
+	glm::vec3 GetPosition(const TransformId _id) const { return glm::vec3(m_PositionX[_id], m_PositionY[_id], m_PositionZ[_id]); }
+	glm::quat GetRotation(const TransformId _id) const { return glm::quat(m_RotationW[_id], m_RotationX[_id], m_RotationY[_id], m_RotationZ[_id]); }
+	glm::vec3 GetScale(const TransformId _id) const { return glm::vec3(m_ScaleX[_id], m_ScaleY[_id], m_ScaleZ[_id]); }
+	TransformId GetParent(const TransformId _id) const { return m_Parents[_id]; }
+	const glm::mat4& GetWorldMatrix(const TransformId _id) const { return m_WorldMatrices[_id]; }
+	uint32_t GetCount() const { return m_Count; }
+
+private:
+	void MarkDirty(const TransformId _id) { m_DirtyBits[_id / 64] |= 1ull << (_id % 64); }
+	void ComposeBatch(const uint32_t _first);
+
+private:
+	uint32_t m_Count = 0;
+
+	// Padded to a whole batch so the last one can be loaded and stored without a scalar tail
+	std::vector<float> m_PositionX;
+	std::vector<float> m_PositionY;
+	std::vector<float> m_PositionZ;
+	std::vector<float> m_RotationX;
+	std::vector<float> m_RotationY;
+	std::vector<float> m_RotationZ;
+	std::vector<float> m_RotationW;
+	std::vector<float> m_ScaleX;
+	std::vector<float> m_ScaleY;
+	std::vector<float> m_ScaleZ;
+	std::vector<glm::mat4> m_WorldMatrices;
+
+	std::vector<TransformId> m_Parents;
+	std::vector<TransformId> m_FirstChildren;		// Children are linked through m_NextSiblings so flags can be pushed down the hierarchy
+	std::vector<TransformId> m_NextSiblings;
+	std::vector<uint64_t> m_DirtyBits;
+};
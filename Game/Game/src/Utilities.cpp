@@ -2,6 +2,15 @@
 #include "Vendors/stb_image.h"
 #include <fstream>
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
 std::vector<char> Utilities::ReadBinaryFile(const std::string& _fileName)
 {
 	std::ifstream inputFile(_fileName, std::ios::binary | std::ios::ate);
@@ -21,15 +30,43 @@ std::vector<char> Utilities::ReadBinaryFile(const std::string& _fileName)
 	return fileBuffer;
 }
 
+std::string Utilities::GetTexturePath(const std::string& _fileName)
+{
+	return "res/textures/" + _fileName;
+}
+
 unsigned char* Utilities::LoadTextureFile(const std::string& _fileName, int* _width, int* _height, int* _desiredChannels)
+{
+	return LoadImageFile(GetTexturePath(_fileName), _width, _height, _desiredChannels);
+}
+
+unsigned char* Utilities::LoadImageFile(const std::string& _path, int* _width, int* _height, int* _desiredChannels)
 {
 	int nChannels = 0;
 	*_desiredChannels = STBI_rgb_alpha;
 
-	return stbi_load(("res/textures/" + _fileName).c_str(), _width, _height, &nChannels, *_desiredChannels);
+	return stbi_load(_path.c_str(), _width, _height, &nChannels, *_desiredChannels);
 }
 
 void Utilities::FreeImage(unsigned char* _imageData)
 {
 	stbi_image_free(_imageData);
 }
+
+uint64_t Utilities::GetResidentMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+
+	return static_cast<uint64_t>(counters.WorkingSetSize);
+#else
+	// Second field of statm is the resident set in pages
+	std::ifstream statm("/proc/self/statm");
+	uint64_t totalPages = 0;
+	uint64_t residentPages = 0;
+	if (!(statm >> totalPages >> residentPages)) return 0;
+
+	return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
@@ -2,11 +2,15 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 
 class Utilities
 {
 public:
 	static std::vector<char> ReadBinaryFile(const std::string& _fileName);
+	static std::string GetTexturePath(const std::string& _fileName);		// Texture names are relative to res/textures
 	static unsigned char* LoadTextureFile(const std::string& _fileName, int* _width, int* _height, int* _desiredChannels);
+	static unsigned char* LoadImageFile(const std::string& _path, int* _width, int* _height, int* _desiredChannels);		// Path as given, not relative to res/textures
 	static void FreeImage(unsigned char* _imageData);
+	static uint64_t GetResidentMemory();		// Bytes of this process currently resident in physical memory, 0 if unknown
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 
 struct Vertex
 {
@@ -16,4 +17,19 @@ public:
 	glm::vec3 position;
 	glm::vec3 color;
 	glm::vec2 uv;
-};
\ No newline at end of file
+};
+
+// Layout of the vertices in the geometry pages, meshes are always built as Vertex and encoded on upload
+enum class VertexFormat
+{
+	Full,		// Vertex as is, 32 bytes
+	Compact		// CompactVertex, 16 bytes
+};
+
+// Position as unorm16 relative to the mesh's bounds, decoded through the model matrix, colour as unorm8 and uv as half floats
+struct CompactVertex
+{
+	uint16_t position[4];		// w is padding, three component 16-bit formats are rarely supported for vertex fetch
+	uint32_t color;
+	uint32_t uv;
+};
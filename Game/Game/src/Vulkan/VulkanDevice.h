@@ -7,12 +7,18 @@ struct QueueFamilyIndices
 {
 	int32_t graphicsFamily = -1;
 	int32_t presentationFamily = -1;
+	int32_t transferFamily = -1;			// Transfer-only family used for uploads, -1 if the device has none
 	VkCommandPool* commandPool = nullptr;
 
 	VkBool32 IsValid()
 	{
 		return graphicsFamily >= 0 && presentationFamily >= 0;
 	}
+
+	VkBool32 HasDedicatedTransfer() const
+	{
+		return transferFamily >= 0 && transferFamily != graphicsFamily;
+	}
 };
 
 struct MainDevice
@@ -24,7 +30,11 @@ struct MainDevice
 		physicalDeviceFeatures{},
 		queueFamilyIndices{},
 		graphicsQueue(VK_NULL_HANDLE),
-		presentationQueue(VK_NULL_HANDLE)
+		presentationQueue(VK_NULL_HANDLE),
+		transferQueue(VK_NULL_HANDLE),
+		drawIndirectCount(VK_FALSE),
+		memoryBudget(VK_FALSE),
+		maxBindlessTextures(0)
 	{
 		requiredDeviceExtensions.reserve(1);
 		requiredDeviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
@@ -37,5 +47,9 @@ struct MainDevice
 	QueueFamilyIndices queueFamilyIndices;
 	VkQueue graphicsQueue;
 	VkQueue presentationQueue;
+	VkQueue transferQueue;
+	VkBool32 drawIndirectCount;			// vkCmdDrawIndexedIndirectCount is enabled (Vulkan 1.2 feature)
+	VkBool32 memoryBudget;				// VK_EXT_memory_budget is enabled, heap budgets and usage can be queried
+	uint32_t maxBindlessTextures;		// Size of the update-after-bind texture table, from the device's descriptor indexing limits
 	std::vector<const char*> requiredDeviceExtensions;
 };
\ No newline at end of file
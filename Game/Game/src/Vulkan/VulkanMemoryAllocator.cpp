@@ -0,0 +1,226 @@
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDevice.h"
+#include "VulkanInit.h"
+#include <stdexcept>
+
+VulkanMemoryAllocator::VulkanMemoryAllocator() :
+	m_MainDevice(nullptr),
+	m_MemoryProperties{},
+	m_BufferImageGranularity(1),
+	m_Blocks{},
+	m_Stats{}
+{}
+
+void VulkanMemoryAllocator::Init(const MainDevice* _mainDevice)
+{
+	m_MainDevice = _mainDevice;
+	vkGetPhysicalDeviceMemoryProperties(m_MainDevice->physicalDevice, &m_MemoryProperties);
+	m_BufferImageGranularity = m_MainDevice->physicalDeviceProperties.limits.bufferImageGranularity;
+	m_Blocks.resize(m_MemoryProperties.memoryTypeCount);
+}
+
+void VulkanMemoryAllocator::CleanUp()
+{
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < m_Blocks.size(); ++memoryTypeIndex)
+	{
+		for (auto& block : m_Blocks[memoryTypeIndex])
+		{
+			if (block.memory != VK_NULL_HANDLE)
+			{
+				FreeDeviceMemory(block.memory, block.ranges.GetSize());
+			}
+		}
+
+		m_Blocks[memoryTypeIndex].clear();
+	}
+
+	m_Stats.blockCount = 0;
+}
+
+MemoryAllocation VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& _memoryRequirements, const uint32_t _memoryTypeIndex, const bool _linear)
+{
+	MemoryAllocation allocation{};
+	allocation.size = _memoryRequirements.size;
+	allocation.memoryTypeIndex = _memoryTypeIndex;
+
+	const VkDeviceSize blockSize = GetBlockSize(_memoryTypeIndex);
+
+	// Large resources get their own allocation rather than pinning most of a block
+	if (_memoryRequirements.size > blockSize / 2)
+	{
+		allocation.memory = AllocateDeviceMemory(_memoryRequirements.size, _memoryTypeIndex, &allocation.pMapped);
+		allocation.blockIndex = DedicatedBlock;
+		m_Stats.resourceCount++;
+		m_Stats.bytesInUse += allocation.size;
+		return allocation;
+	}
+
+	// Linear and optimal resources only share a block when bufferImageGranularity can't make them alias a page
+	const bool separateTiling = m_BufferImageGranularity > 1;
+	std::vector<MemoryBlock>& blocks = m_Blocks[_memoryTypeIndex];
+	uint32_t freeSlot = DedicatedBlock;
+
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		MemoryBlock& block = blocks[i];
+
+		if (block.memory == VK_NULL_HANDLE)
+		{
+			if (freeSlot == DedicatedBlock) freeSlot = i;
+			continue;
+		}
+
+		if (separateTiling && block.linear != _linear) continue;
+
+		uint64_t offset = 0;
+		if (block.ranges.Allocate(_memoryRequirements.size, _memoryRequirements.alignment, offset))
+		{
+			allocation.memory = block.memory;
+			allocation.offset = offset;
+			allocation.pMapped = block.pMapped ? static_cast<uint8_t*>(block.pMapped) + offset : nullptr;
+			allocation.blockIndex = i;
+			m_Stats.resourceCount++;
+			m_Stats.bytesInUse += allocation.size;
+			return allocation;
+		}
+	}
+
+	// No block had room, open a new one
+	if (freeSlot == DedicatedBlock)
+	{
+		freeSlot = static_cast<uint32_t>(blocks.size());
+		blocks.emplace_back();
+	}
+
+	MemoryBlock& block = blocks[freeSlot];
+	block.memory = AllocateDeviceMemory(blockSize, _memoryTypeIndex, &block.pMapped);
+	block.linear = _linear;
+	block.ranges.Init(blockSize);
+	m_Stats.blockCount++;
+
+	uint64_t offset = 0;
+	block.ranges.Allocate(_memoryRequirements.size, _memoryRequirements.alignment, offset);
+
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.pMapped = block.pMapped ? static_cast<uint8_t*>(block.pMapped) + offset : nullptr;
+	allocation.blockIndex = freeSlot;
+	m_Stats.resourceCount++;
+	m_Stats.bytesInUse += allocation.size;
+	return allocation;
+}
+
+void VulkanMemoryAllocator::Free(const MemoryAllocation& _allocation)
+{
+	if (_allocation.memory == VK_NULL_HANDLE) return;
+
+	m_Stats.resourceCount--;
+	m_Stats.bytesInUse -= _allocation.size;
+
+	if (_allocation.blockIndex == DedicatedBlock)
+	{
+		FreeDeviceMemory(_allocation.memory, _allocation.size);
+		return;
+	}
+
+	std::vector<MemoryBlock>& blocks = m_Blocks[_allocation.memoryTypeIndex];
+	MemoryBlock& block = blocks[_allocation.blockIndex];
+	block.ranges.Free(_allocation.offset, _allocation.size);
+
+	if (!block.ranges.IsEmpty()) return;
+
+	// Keep one empty block per memory type around so a free/allocate pair doesn't hit the driver
+	uint32_t liveBlocks = 0;
+	for (const auto& other : blocks)
+	{
+		if (other.memory != VK_NULL_HANDLE) liveBlocks++;
+	}
+
+	if (liveBlocks > 1)
+	{
+		FreeDeviceMemory(block.memory, block.ranges.GetSize());
+		block.memory = VK_NULL_HANDLE;
+		block.pMapped = nullptr;
+		block.ranges.Init(0);
+		m_Stats.blockCount--;
+	}
+}
+
+MemoryStats VulkanMemoryAllocator::GetStats() const
+{
+	MemoryStats stats = m_Stats;
+	stats.freeRangeCount = 0;
+	stats.largestFreeRange = 0;
+
+	VkDeviceSize freeBytes = 0;
+
+	for (const auto& blocks : m_Blocks)
+	{
+		for (const auto& block : blocks)
+		{
+			if (block.memory == VK_NULL_HANDLE) continue;
+
+			stats.freeRangeCount += block.ranges.GetFreeRangeCount();
+			freeBytes += block.ranges.GetFreeSize();
+
+			if (block.ranges.GetLargestFreeRange() > stats.largestFreeRange)
+			{
+				stats.largestFreeRange = block.ranges.GetLargestFreeRange();
+			}
+		}
+	}
+
+	stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(freeBytes) : 0.0f;
+	return stats;
+}
+
+VkDeviceMemory VulkanMemoryAllocator::AllocateDeviceMemory(const VkDeviceSize _size, const uint32_t _memoryTypeIndex, void** _ppMapped)
+{
+	VkMemoryAllocateInfo memoryAllocation = Vki::AllocateMemoryInfo(_size, _memoryTypeIndex);
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkResult re = vkAllocateMemory(m_MainDevice->device, &memoryAllocation, nullptr, &memory);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate device memory\n");
+
+	// Host visible memory stays mapped for its whole lifetime
+	*_ppMapped = nullptr;
+	if (IsHostVisible(_memoryTypeIndex))
+	{
+		re = vkMapMemory(m_MainDevice->device, memory, 0, VK_WHOLE_SIZE, 0, _ppMapped);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to map device memory\n");
+	}
+
+	m_Stats.allocationCount++;
+	m_Stats.totalAllocations++;
+	m_Stats.bytesAllocated += _size;
+
+	return memory;
+}
+
+void VulkanMemoryAllocator::FreeDeviceMemory(const VkDeviceMemory& _memory, const VkDeviceSize _size)
+{
+	// Freeing memory implicitly unmaps it
+	vkFreeMemory(m_MainDevice->device, _memory, nullptr);
+
+	m_Stats.allocationCount--;
+	m_Stats.bytesAllocated -= _size;
+}
+
+VkDeviceSize VulkanMemoryAllocator::GetBlockSize(const uint32_t _memoryTypeIndex) const
+{
+	const uint32_t heapIndex = m_MemoryProperties.memoryTypes[_memoryTypeIndex].heapIndex;
+	const VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[heapIndex].size;
+
+	// Small heaps (e.g. the 256 MiB BAR heap) would be exhausted by a handful of default sized blocks
+	if (heapSize <= 1024ull * 1024 * 1024)
+	{
+		return heapSize / 8;
+	}
+
+	return DefaultBlockSize;
+}
+
+bool VulkanMemoryAllocator::IsHostVisible(const uint32_t _memoryTypeIndex) const
+{
+	return (m_MemoryProperties.memoryTypes[_memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
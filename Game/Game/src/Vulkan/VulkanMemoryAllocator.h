@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "../RangeAllocator.h"
+
+struct MainDevice;
+
+struct MemoryAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;		// Device memory block the allocation lives in
+	VkDeviceSize offset = 0;					// Offset of the allocation inside the block
+	VkDeviceSize size = 0;						// Size requested by the resource
+	void* pMapped = nullptr;					// Host pointer to the allocation (host visible memory only)
+	uint32_t memoryTypeIndex = 0;				// Memory type the block was allocated from
+	uint32_t blockIndex = 0;					// Index of the block within its memory type (DedicatedBlock if not sub-allocated)
+};
+
+struct MemoryStats
+{
+	uint32_t allocationCount;		// Device memory allocations currently alive (blocks + dedicated)
+	uint32_t totalAllocations;		// Device memory allocations made since initialization
+	uint32_t resourceCount;			// Buffers and images currently bound to memory
+	uint32_t blockCount;			// Sub-allocated blocks currently alive
+	uint32_t freeRangeCount;		// Free ranges across all blocks
+	VkDeviceSize bytesAllocated;	// Bytes of device memory currently allocated
+	VkDeviceSize bytesInUse;		// Bytes handed out to resources
+	VkDeviceSize largestFreeRange;	// Largest free range in any block
+	float fragmentation;			// 1 - largestFreeRange / free bytes, 0 when all free space is contiguous
+};
+
+class VulkanMemoryAllocator
+{
+public:
+	static const uint32_t DedicatedBlock = UINT32_MAX;
+
+	VulkanMemoryAllocator();
+
+	void Init(const MainDevice* _mainDevice);
+	void CleanUp();
+	MemoryAllocation Allocate(const VkMemoryRequirements& _memoryRequirements, const uint32_t _memoryTypeIndex, const bool _linear);
+	void Free(const MemoryAllocation& _allocation);
+	MemoryStats GetStats() const;
+
+private:
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* pMapped = nullptr;
+		bool linear = true;
+		RangeAllocator ranges;
+	};
+
+	VkDeviceMemory AllocateDeviceMemory(const VkDeviceSize _size, const uint32_t _memoryTypeIndex, void** _ppMapped);
+	void FreeDeviceMemory(const VkDeviceMemory& _memory, const VkDeviceSize _size);
+	VkDeviceSize GetBlockSize(const uint32_t _memoryTypeIndex) const;
+	bool IsHostVisible(const uint32_t _memoryTypeIndex) const;
+
+private:
+	static const VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+
+	const MainDevice* m_MainDevice;
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+	VkDeviceSize m_BufferImageGranularity;
+	std::vector<std::vector<MemoryBlock>> m_Blocks;		// Blocks per memory type, empty slots are reused
+	MemoryStats m_Stats;
+};
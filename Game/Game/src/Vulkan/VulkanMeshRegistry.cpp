@@ -0,0 +1,344 @@
+#include "VulkanMeshRegistry.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+#define MeshPageVertexCount (1ull << 20)	// 32 MiB of vertices per page
+#define MeshPageIndexCount (3ull << 20)		// 12 MiB of 32-bit indices per page
+
+namespace
+{
+	VkDeviceSize GetIndexSize(const VkIndexType _indexType)
+	{
+		return _indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+}
+
+std::vector<Mesh> VulkanMeshRegistry::s_Meshes{};
+std::vector<MeshId> VulkanMeshRegistry::s_FreeMeshIds{};
+std::map<std::string, MeshId> VulkanMeshRegistry::s_MeshDatabase{};
+std::vector<VulkanMeshRegistry::GeometryPage> VulkanMeshRegistry::s_Pages{};
+bool VulkanMeshRegistry::s_KeepCpuData = false;
+VertexFormat VulkanMeshRegistry::s_VertexFormat = VertexFormat::Full;
+uint64_t VulkanMeshRegistry::s_ReleasedCpuBytes = 0;
+
+MeshId VulkanMeshRegistry::Acquire(const VulkanPrimative::Primative _primative)
+{
+	if (_primative == VulkanPrimative::Primative::Empty) return InvalidMeshId;
+
+	const std::string key = "primative:" + std::to_string(static_cast<int>(_primative));
+
+	// Only generate the geometry the first time the primitive is requested
+	auto it = s_MeshDatabase.find(key);
+	if (it != s_MeshDatabase.end())
+	{
+		AddReference(it->second);
+		return it->second;
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	VulkanPrimative::MakePrimative(_primative, vertices, indices);
+
+	return Acquire(key, std::move(vertices), std::move(indices));
+}
+
+MeshId VulkanMeshRegistry::Acquire(const std::string& _key, std::vector<Vertex>&& _vertices, std::vector<uint32_t>&& _indices)
+{
+	auto it = s_MeshDatabase.find(_key);
+	if (it != s_MeshDatabase.end())
+	{
+		AddReference(it->second);
+		return it->second;
+	}
+
+	MeshId meshId = static_cast<MeshId>(s_Meshes.size());
+
+	if (!s_FreeMeshIds.empty())
+	{
+		meshId = s_FreeMeshIds.back();
+		s_FreeMeshIds.pop_back();
+	}
+	else
+	{
+		s_Meshes.emplace_back();
+	}
+
+	Mesh& mesh = s_Meshes[meshId];
+	mesh.vertices = std::move(_vertices);
+	mesh.indices = std::move(_indices);
+	mesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	mesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	mesh.refCount = 1;
+	mesh.key = _key;
+	ComputeBounds(mesh);
+	AllocateGeometry(mesh);
+
+	// The upload copied the geometry into staging memory, drawing only needs the counts and bounds from here on
+	if (!s_KeepCpuData) ReleaseCpuData(mesh);
+
+	s_MeshDatabase.insert(std::pair(_key, meshId));
+	return meshId;
+}
+
+void VulkanMeshRegistry::AddReference(const MeshId _meshId)
+{
+	if (_meshId == InvalidMeshId) return;
+
+	++s_Meshes[_meshId].refCount;
+}
+
+void VulkanMeshRegistry::Release(const MeshId _meshId)
+{
+	if (_meshId == InvalidMeshId) return;
+
+	// Ignored rather than thrown, the same as for textures, since scenes release from noexcept code
+	Mesh& mesh = s_Meshes[_meshId];
+	if (mesh.refCount == 0 || --mesh.refCount > 0) return;
+
+	FreeGeometry(mesh);
+	s_MeshDatabase.erase(mesh.key);
+	mesh = Mesh();
+	s_FreeMeshIds.emplace_back(_meshId);
+}
+
+void VulkanMeshRegistry::BindPage(const VkCommandBuffer& _commandBuffer, const uint32_t _pageIndex)
+{
+	const GeometryPage& page = s_Pages[_pageIndex];
+
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &page.vertexBuffer.buffer, offsets);
+	vkCmdBindIndexBuffer(_commandBuffer, page.indexBuffer.buffer, 0, page.indexType);
+}
+
+void VulkanMeshRegistry::Draw(const VkCommandBuffer& _commandBuffer, const MeshId _meshId, const uint32_t _instanceCount, const uint32_t _firstInstance)
+{
+	// The mesh's page must already be bound
+	const Mesh& mesh = s_Meshes[_meshId];
+	vkCmdDrawIndexed(_commandBuffer, mesh.indexCount, _instanceCount, mesh.firstIndex, static_cast<int32_t>(mesh.vertexOffset), _firstInstance);
+}
+
+void VulkanMeshRegistry::SetVertexFormat(const VertexFormat _format)
+{
+	// Pages hold every mesh in the same layout
+	if (_format != s_VertexFormat && !s_MeshDatabase.empty())
+	{
+		throw std::runtime_error("ERROR: The vertex format can't change while meshes are registered\n");
+	}
+
+	s_VertexFormat = _format;
+}
+
+uint32_t VulkanMeshRegistry::GetVertexStride()
+{
+	return s_VertexFormat == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+glm::mat4 VulkanMeshRegistry::GetModelMatrix(const Mesh& _mesh, const glm::mat4& _world)
+{
+	// _world * translate(offset) * scale(scale), written out
+	const float scale = _mesh.positionDecode.w;
+	glm::mat4 model = _world;
+	model[3] = _world * glm::vec4(glm::vec3(_mesh.positionDecode), 1.0f);
+	model[0] *= scale;
+	model[1] *= scale;
+	model[2] *= scale;
+	return model;
+}
+
+glm::vec4 VulkanMeshRegistry::GetStoredBoundingSphere(const Mesh& _mesh)
+{
+	const float inverseScale = 1.0f / _mesh.positionDecode.w;
+	return glm::vec4((glm::vec3(_mesh.boundingSphere) - glm::vec3(_mesh.positionDecode)) * inverseScale, _mesh.boundingSphere.w * inverseScale);
+}
+
+MeshMemoryStats VulkanMeshRegistry::GetMemoryStats()
+{
+	MeshMemoryStats stats{};
+	stats.releasedCpuBytes = s_ReleasedCpuBytes;
+
+	for (const auto& mesh : s_Meshes)
+	{
+		stats.cpuBytes += sizeof(Vertex) * mesh.vertices.capacity() + sizeof(uint32_t) * mesh.indices.capacity();
+	}
+
+	return stats;
+}
+
+void VulkanMeshRegistry::CleanUp()
+{
+	// Pages own every mesh's geometry, so meshes still referenced at shutdown are released with them
+	for (auto& page : s_Pages)
+	{
+		VulkanUtilities::DestroyBuffer(page.vertexBuffer.buffer, page.vertexBuffer.bufferMemory);
+		VulkanUtilities::DestroyBuffer(page.indexBuffer.buffer, page.indexBuffer.bufferMemory);
+	}
+
+	s_Pages.clear();
+	s_Meshes.clear();
+	s_FreeMeshIds.clear();
+	s_MeshDatabase.clear();
+	s_ReleasedCpuBytes = 0;
+}
+
+void VulkanMeshRegistry::ComputeBounds(Mesh& _mesh)
+{
+	if (_mesh.vertices.empty()) return;
+
+	// Sphere around the box centre, looser than a minimal sphere but cheap and stable
+	Aabb bounds;
+
+	for (const auto& vertex : _mesh.vertices)
+	{
+		bounds.Expand(vertex.position);
+	}
+
+	const glm::vec3 centre = bounds.GetCentre();
+	float radius = 0.0f;
+
+	for (const auto& vertex : _mesh.vertices)
+	{
+		radius = std::max(radius, glm::length(vertex.position - centre));
+	}
+
+	_mesh.localBounds = bounds;
+	_mesh.boundingSphere = glm::vec4(centre, radius);
+
+	// One scale for every axis keeps the decode a uniform scale, so culling can scale the bounding sphere by the model matrix
+	if (s_VertexFormat == VertexFormat::Compact)
+	{
+		const glm::vec3 extent = bounds.max - bounds.min;
+		const float scale = std::max(std::max(extent.x, extent.y), extent.z);
+		_mesh.positionDecode = glm::vec4(bounds.min, scale > 0.0f ? scale : 1.0f);
+	}
+}
+
+void VulkanMeshRegistry::AllocateGeometry(Mesh& _mesh)
+{
+	const uint64_t vertexCount = _mesh.vertexCount;
+	const uint64_t indexCount = _mesh.indexCount;
+	uint64_t vertexOffset = 0;
+	uint64_t indexOffset = 0;
+
+	// Indices are relative to vertexOffset, so below 65536 vertices every one fits in 16 bits
+	const VkIndexType indexType = vertexCount <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	// First page of the right index type with room for both ranges, a new page is added when all are full
+	uint32_t pageIndex = 0;
+
+	for (; pageIndex < s_Pages.size(); ++pageIndex)
+	{
+		GeometryPage& page = s_Pages[pageIndex];
+		if (page.indexType != indexType) continue;
+		if (!page.vertexRanges.Allocate(vertexCount, 1, vertexOffset)) continue;
+		if (page.indexRanges.Allocate(indexCount, 1, indexOffset)) break;
+
+		page.vertexRanges.Free(vertexOffset, vertexCount);
+	}
+
+	if (pageIndex == s_Pages.size())
+	{
+		// Meshes larger than a page get a page of their own
+		CreatePage(std::max<uint64_t>(vertexCount, MeshPageVertexCount), std::max<uint64_t>(indexCount, MeshPageIndexCount), indexType);
+		s_Pages[pageIndex].vertexRanges.Allocate(vertexCount, 1, vertexOffset);
+		s_Pages[pageIndex].indexRanges.Allocate(indexCount, 1, indexOffset);
+	}
+
+	_mesh.pageIndex = pageIndex;
+	_mesh.vertexOffset = static_cast<uint32_t>(vertexOffset);
+	_mesh.firstIndex = static_cast<uint32_t>(indexOffset);
+
+	// Staged through the shared ring and copied by the next upload batch
+	const GeometryPage& page = s_Pages[pageIndex];
+	UploadVertices(_mesh, page.vertexBuffer.buffer);
+	UploadIndices(_mesh, page.indexBuffer.buffer, indexType);
+}
+
+void VulkanMeshRegistry::UploadVertices(const Mesh& _mesh, const VkBuffer& _buffer)
+{
+	const VkDeviceSize stride = GetVertexStride();
+
+	if (s_VertexFormat == VertexFormat::Full)
+	{
+		VulkanUtilities::UploadToBuffer(_mesh.vertices.data(), stride * _mesh.vertexCount, _buffer, stride * _mesh.vertexOffset);
+		return;
+	}
+
+	const glm::vec3 offset(_mesh.positionDecode);
+	const float inverseScale = 1.0f / _mesh.positionDecode.w;
+
+	std::vector<CompactVertex> compactVertices(_mesh.vertexCount);
+
+	for (uint32_t i = 0; i < _mesh.vertexCount; ++i)
+	{
+		const Vertex& vertex = _mesh.vertices[i];
+		const glm::vec3 position = glm::clamp((vertex.position - offset) * inverseScale, 0.0f, 1.0f);
+
+		CompactVertex& compact = compactVertices[i];
+		compact.position[0] = static_cast<uint16_t>(position.x * UINT16_MAX + 0.5f);
+		compact.position[1] = static_cast<uint16_t>(position.y * UINT16_MAX + 0.5f);
+		compact.position[2] = static_cast<uint16_t>(position.z * UINT16_MAX + 0.5f);
+		compact.position[3] = 0;
+		compact.color = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+		compact.uv = glm::packHalf2x16(vertex.uv);
+	}
+
+	VulkanUtilities::UploadToBuffer(compactVertices.data(), stride * _mesh.vertexCount, _buffer, stride * _mesh.vertexOffset);
+}
+
+void VulkanMeshRegistry::UploadIndices(const Mesh& _mesh, const VkBuffer& _buffer, const VkIndexType _indexType)
+{
+	const VkDeviceSize indexSize = GetIndexSize(_indexType);
+
+	if (_indexType == VK_INDEX_TYPE_UINT32)
+	{
+		VulkanUtilities::UploadToBuffer(_mesh.indices.data(), indexSize * _mesh.indexCount, _buffer, indexSize * _mesh.firstIndex);
+		return;
+	}
+
+	std::vector<uint16_t> shortIndices(_mesh.indexCount);
+	std::transform(_mesh.indices.begin(), _mesh.indices.end(), shortIndices.begin(), [](const uint32_t _index) { return static_cast<uint16_t>(_index); });
+	VulkanUtilities::UploadToBuffer(shortIndices.data(), indexSize * _mesh.indexCount, _buffer, indexSize * _mesh.firstIndex);
+}
+
+void VulkanMeshRegistry::FreeGeometry(const Mesh& _mesh)
+{
+	GeometryPage& page = s_Pages[_mesh.pageIndex];
+	page.vertexRanges.Free(_mesh.vertexOffset, _mesh.vertexCount);
+	page.indexRanges.Free(_mesh.firstIndex, _mesh.indexCount);
+}
+
+void VulkanMeshRegistry::ReleaseCpuData(Mesh& _mesh)
+{
+	s_ReleasedCpuBytes += sizeof(Vertex) * _mesh.vertices.capacity() + sizeof(uint32_t) * _mesh.indices.capacity();
+
+	// Swapped out rather than cleared so the allocations are actually returned
+	std::vector<Vertex>().swap(_mesh.vertices);
+	std::vector<uint32_t>().swap(_mesh.indices);
+}
+
+void VulkanMeshRegistry::CreatePage(const uint64_t _vertexCount, const uint64_t _indexCount, const VkIndexType _indexType)
+{
+	GeometryPage page{};
+	page.vertexRanges.Init(_vertexCount);
+	page.indexRanges.Init(_indexCount);
+	page.indexType = _indexType;
+
+	BufferInfo vertexBufferInfo{};
+	vertexBufferInfo.pBuffer = &page.vertexBuffer.buffer;
+	vertexBufferInfo.pBufferMemory = &page.vertexBuffer.bufferMemory;
+	vertexBufferInfo.bufferSize = GetVertexStride() * _vertexCount;
+	vertexBufferInfo.bufferUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	vertexBufferInfo.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	VulkanUtilities::CreateBuffer(vertexBufferInfo);
+
+	BufferInfo indexBufferInfo{};
+	indexBufferInfo.pBuffer = &page.indexBuffer.buffer;
+	indexBufferInfo.pBufferMemory = &page.indexBuffer.bufferMemory;
+	indexBufferInfo.bufferSize = GetIndexSize(_indexType) * _indexCount;
+	indexBufferInfo.bufferUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	indexBufferInfo.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	VulkanUtilities::CreateBuffer(indexBufferInfo);
+
+	s_Pages.emplace_back(page);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "VulkanUtilities.h"
+#include "VulkanPrimative.h"
+#include "../RangeAllocator.h"
+#include "../Bounds.h"
+#include <string>
+#include <map>
+
+typedef uint32_t MeshId;
+static constexpr MeshId InvalidMeshId = UINT32_MAX;
+
+// Matches the std430 layout of the mesh table in cull.comp
+struct GpuMesh
+{
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t pageIndex;
+	glm::vec4 boundingSphere;
+	uint32_t commandBase;			// First indirect command of the mesh's page
+	uint32_t padding[3];
+};
+
+// Geometry still held on the host, the rest only lives in the pages once its upload is staged
+struct MeshMemoryStats
+{
+	uint64_t cpuBytes = 0;				// Vertex and index data currently kept on the CPU
+	uint64_t releasedCpuBytes = 0;		// Dropped after upload since the registry was last cleaned up
+};
+
+struct Mesh
+{
+	uint32_t pageIndex = 0;				// Geometry page the mesh was suballocated from
+	uint32_t vertexOffset = 0;			// First vertex in the page's vertex buffer, passed as vertexOffset when drawing
+	uint32_t firstIndex = 0;			// First index in the page's index buffer
+	glm::vec4 boundingSphere{ 0.0f };	// Local space centre (xyz) and radius (w)
+	glm::vec4 positionDecode{ 0.0f, 0.0f, 0.0f, 1.0f };	// Stored positions map to offset (xyz) + scale (w) * position, identity for full vertices
+	Aabb localBounds;					// Local space box, transformed into world bounds by each object using the mesh
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	std::vector<Vertex> vertices;		// CPU copy, empty once uploaded unless the registry keeps CPU data
+	std::vector<uint32_t> indices;
+	uint32_t refCount = 0;				// Scene objects currently using the mesh, its ranges are freed when it reaches 0
+	std::string key;					// Primitive or asset id the mesh was registered under
+};
+
+// Shares GPU geometry between every object created from the same primitive or asset.
+// All meshes are suballocated from a few large vertex and index buffers (pages), so a pass binds geometry once per page
+// and draws with firstIndex/vertexOffset. Meshes are reference counted, the last Release frees the mesh's ranges
+// so callers must make sure the GPU is done with them.
+// Vertices are encoded into the registry's vertex format on upload. Meshes whose indices fit in 16 bits go into
+// pages with 16-bit index buffers, the rest into 32-bit ones, so each page binds with a single index type.
+class VulkanMeshRegistry
+{
+public:
+	static MeshId Acquire(const VulkanPrimative::Primative _primative);
+	static MeshId Acquire(const std::string& _key, std::vector<Vertex>&& _vertices, std::vector<uint32_t>&& _indices);
+	static void AddReference(const MeshId _meshId);
+	// Never throws, scenes release from noexcept moves and their destructor. Extra releases are ignored
+	static void Release(const MeshId _meshId);
+	static void BindPage(const VkCommandBuffer& _commandBuffer, const uint32_t _pageIndex);
+	static void Draw(const VkCommandBuffer& _commandBuffer, const MeshId _meshId, const uint32_t _instanceCount, const uint32_t _firstInstance);
+	static const Mesh& GetMesh(const MeshId _meshId) { return s_Meshes[_meshId]; }
+	static uint32_t GetMeshCount() { return static_cast<uint32_t>(s_MeshDatabase.size()); }
+	static uint32_t GetMeshSlotCount() { return static_cast<uint32_t>(s_Meshes.size()); }
+	static uint32_t GetPageCount() { return static_cast<uint32_t>(s_Pages.size()); }
+	static void SetKeepCpuData(const bool _keep) { s_KeepCpuData = _keep; }	// Applies to meshes acquired afterwards
+	static void SetVertexFormat(const VertexFormat _format);
+	static VertexFormat GetVertexFormat() { return s_VertexFormat; }
+	static uint32_t GetVertexStride();
+	// Folds the mesh's position decode into an object's world matrix, this is the model matrix its instances are drawn with
+	static glm::mat4 GetModelMatrix(const Mesh& _mesh, const glm::mat4& _world);
+	static glm::vec4 GetStoredBoundingSphere(const Mesh& _mesh);		// boundingSphere in the space of the stored positions
+	static MeshMemoryStats GetMemoryStats();
+	static void CleanUp();
+
+private:
+	struct GeometryPage
+	{
+		UniformBuffer vertexBuffer;
+		UniformBuffer indexBuffer;
+		RangeAllocator vertexRanges;	// In vertices
+		RangeAllocator indexRanges;		// In indices
+		VkIndexType indexType;
+	};
+
+	static void ComputeBounds(Mesh& _mesh);
+	static void AllocateGeometry(Mesh& _mesh);
+	static void FreeGeometry(const Mesh& _mesh);
+	static void ReleaseCpuData(Mesh& _mesh);
+	static void UploadVertices(const Mesh& _mesh, const VkBuffer& _buffer);
+	static void UploadIndices(const Mesh& _mesh, const VkBuffer& _buffer, const VkIndexType _indexType);
+	static void CreatePage(const uint64_t _vertexCount, const uint64_t _indexCount, const VkIndexType _indexType);
+
+private:
+	static std::vector<Mesh> s_Meshes;
+	static std::vector<MeshId> s_FreeMeshIds;				// Slots of released meshes, reused before growing s_Meshes
+	static std::map<std::string, MeshId> s_MeshDatabase;
+	static std::vector<GeometryPage> s_Pages;
+	static bool s_KeepCpuData;
+	static VertexFormat s_VertexFormat;
+	static uint64_t s_ReleasedCpuBytes;
+};
@@ -11,6 +11,7 @@ VulkanPipelineBuilder::VulkanPipelineBuilder() :
 	multisampleStateCreateInfo{},
 	colorBlendStateCreateInfo{},
 	depthStencilStateCreateInfo{},
+	dynamicStates{},
 	layout(VK_NULL_HANDLE)
 {}
 
@@ -18,13 +19,18 @@ VkPipeline VulkanPipelineBuilder::Build(const VkRenderPass& _renderPass, const V
 {
 	VkPipeline newPipeline = VK_NULL_HANDLE;
 
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
 	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = Vki::GraphicsPipelineCreateInfo();
 	graphicsPipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	graphicsPipelineCreateInfo.pStages = shaderStages.data();
 	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
 	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
 	graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	graphicsPipelineCreateInfo.pDynamicState = nullptr;
+	graphicsPipelineCreateInfo.pDynamicState = dynamicStates.empty() ? nullptr : &dynamicStateCreateInfo;
 	graphicsPipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
 	graphicsPipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
 	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
@@ -19,5 +19,6 @@ public:
 	VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo;
 	VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo;
 	VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo;
+	std::vector<VkDynamicState> dynamicStates;
 	VkPipelineLayout layout;
 };
@@ -2,17 +2,24 @@
 #include "VulkanInit.h"
 #include "../Window.h"
 #include "VulkanDebug.h"
+#include "VulkanTexture.h"
 #include "../Utilities.h"
 #include <glfw3.h>
 #include <array>
 #include <algorithm>
 #include <stdexcept>
+#include <chrono>
+#include <thread>
 
 #define MaxFrameDraws 3
 #define MaxObjects 25
+#define DepthPyramidMaxLevels 16
+#define MaxBindlessTextures 65536
+#define StreamingInterval 4				// Frames between texture streaming updates
 
-VulkanRenderer::VulkanRenderer(Window* _window) :
+VulkanRenderer::VulkanRenderer(Window* _window, const RendererSettings& _settings) :
 	m_Window(_window),
+	m_Settings(_settings),
 	m_VkInstance(VK_NULL_HANDLE),
 	m_MainDevice{},
 	m_DebugMessenger(VK_NULL_HANDLE),
@@ -20,34 +27,109 @@ VulkanRenderer::VulkanRenderer(Window* _window) :
 	m_Swapchain{},
 	m_GraphicsPipeline(VK_NULL_HANDLE),
 	m_PipelineLayout(VK_NULL_HANDLE),
-	m_CurrentFrameIndex(0)
+	m_TextureDescriptorPool(VK_NULL_HANDLE),
+	m_TimestampQueryPool(VK_NULL_HANDLE),
+	m_CurrentFrameIndex(0),
+	m_LastImageIndex(0),
+	m_SubmittedFrameCount(0),
+	m_SwapchainOutOfDate(false),
+	m_Stats{},
+	m_InstanceBuffer{},
+	m_InstanceStride(0),
+	m_pInstanceData(nullptr),
+	m_InstanceCapacity(0),
+	m_CullDescriptorSetLayout(VK_NULL_HANDLE),
+	m_CullPipelineLayout(VK_NULL_HANDLE),
+	m_CullPipeline(VK_NULL_HANDLE),
+	m_MeshTableBuffer{},
+	m_DrawCommandBuffer{},
+	m_DrawCountBuffer{},
+	m_MeshTableCapacity(0),
+	m_CullPageCount(0),
+	m_DrawCommandStride(0),
+	m_DrawCountStride(0),
+	m_DrawCommandPhaseStride(0),
+	m_DrawCountPhaseStride(0),
+	m_SceneBvhStale(true),
+	m_EarlyRenderPass(VK_NULL_HANDLE),
+	m_LateRenderPass(VK_NULL_HANDLE),
+	m_DepthPyramid{},
+	m_DepthPyramidExtent{},
+	m_DepthPyramidLevelCount(0),
+	m_DepthPyramidValid(false),
+	m_DepthPyramidSampler(VK_NULL_HANDLE),
+	m_DepthReduceDescriptorSetLayout(VK_NULL_HANDLE),
+	m_DepthReducePipelineLayout(VK_NULL_HANDLE),
+	m_DepthReducePipeline(VK_NULL_HANDLE),
+	m_OcclusionStateBuffer{},
+	m_CullStatsBuffer{},
+	m_pCullStats(nullptr)
 {
+	// Offscreen rendering never presents, so the swapchain extension is not needed
+	if (m_Settings.headless) m_MainDevice.requiredDeviceExtensions.clear();
+
 	CreateInstance();
 	if (enableValidationLayers) CreateDebugMessenger();
-	CreateSurface();
+	if (!m_Settings.headless) CreateSurface();
 	SelectPhysicalDevice();
 	CreateLogicalDevice();
 
-	VulkanUtilities::Initialize(&m_MainDevice);
-	m_Camera.Init();
+	// Culled draws carry the object index in firstInstance, without these features the CPU draw groups are used instead
+	if (!m_MainDevice.physicalDeviceFeatures.multiDrawIndirect || !m_MainDevice.physicalDeviceFeatures.drawIndirectFirstInstance)
+	{
+		m_Settings.gpuCulling = false;
+	}
 
-	CreateSwapchain();
+	// The depth pyramid is only tested by the culling compute pass
+	if (!m_Settings.gpuCulling) m_Settings.occlusionCulling = false;
+
+	VulkanUtilities::Initialize(&m_MainDevice);
+	VulkanMeshRegistry::SetKeepCpuData(m_Settings.keepMeshData);
+	VulkanMeshRegistry::SetVertexFormat(m_Settings.vertexFormat);
+
+	// The render thread uploads what the workers decode, with no spare hardware thread the decodes run inline
+	if (m_Settings.textureDecodeThreadCount == 0) m_Settings.textureDecodeThreadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	m_TextureJobSystem = std::make_unique<JobSystem>(m_Settings.textureDecodeThreadCount);
+	VulkanTexture::SetJobSystem(m_TextureJobSystem.get());
+	VulkanTexture::SetGenerateMipmaps(m_Settings.textureMipmaps);
+	VulkanTexture::SetUseCookedTextures(m_Settings.cookedTextures);
+	VulkanTexture::SetStreaming(m_Settings.textureStreaming && m_Settings.textureMipmaps, m_Settings.textureBudget);
+	VulkanTexture::SetDestroyAfterFrames([this](std::function<void()>&& _destroy) { DestroyAfterFrames(std::move(_destroy)); });
+	m_Camera.Init(MaxFrameDraws);
+
+	if (m_Settings.headless) CreateOffscreenImages();
+	else CreateSwapchain();
 	CreateDepthBufferImage();
 	CreateRenderPass();
 	CreateFramebuffers();
 	CreateCommandPool();
 	CreateCommandBuffers();
+	CreateSecondaryCommandBuffers();
 	CreateSynchronization();
 	CreateTextureSampler();
 	CreateDescriptorPool();
 	CreateDescriptorLayout();
 	AllocateDescriptorSets();
 	CreateGraphicsPipeline();
+	CreateCullPipeline();
+	CreateDepthReducePipeline();
+	CreateDepthPyramid();
+	CreateTimestampQueries();
+	SetupCamera();
+
+	// Headless renderers start empty and are given a scene through SetScene
+	if (!m_Settings.headless) SetupScene();
+	ResetObjectBounds();
+
+	CreateInstanceBuffer(std::max<uint32_t>(MaxObjects, m_Scene.GetObjectCount()));
+	UpdateCullBuffers();
 
-	SetupScene();
+	// Scene uploads were batched while the objects were created, submit them together and wait once. Textures are
+	// still decoding, frames draw the placeholder until Draw picks them up
+	VulkanUtilities::WaitForUpload(VulkanUtilities::FlushUploads());
 
+	// Command buffers are recorded every frame in Draw
 	WriteDescriptors();
-	RecordCommands();
 }
 
 VulkanRenderer::~VulkanRenderer()
@@ -55,12 +137,21 @@ VulkanRenderer::~VulkanRenderer()
 	// Wait until no actions being run on device before destroying
 	vkDeviceWaitIdle(m_MainDevice.device);
 
+	ProcessDeletionQueue(true);
+
 	vkDestroySampler(m_MainDevice.device, m_Sampler, nullptr);
 
+	if (m_TimestampQueryPool)
+	{
+		vkDestroyQueryPool(m_MainDevice.device, m_TimestampQueryPool, nullptr);
+	}
+
 	VulkanUtilities::DestroyImageView(m_DepthImage.imageView);
 	VulkanUtilities::DestroyImage(m_DepthImage.image, m_DepthImage.imageMemory);
+	DestroyDepthPyramid();
 
 	vkDestroyDescriptorPool(m_MainDevice.device, m_DescriptorPool, nullptr);
+	vkDestroyDescriptorPool(m_MainDevice.device, m_TextureDescriptorPool, nullptr);
 
 	// Destroy descriptor set layouts
 	for (const auto& descriptorSetLayout : m_DescriptorSetLayout)
@@ -68,11 +159,14 @@ VulkanRenderer::~VulkanRenderer()
 		vkDestroyDescriptorSetLayout(m_MainDevice.device, descriptorSetLayout, nullptr);
 	}
 
-	for (auto& gameObject : m_GameObjects)
-	{
-		gameObject.Cleanup();
-	}
+	// Entities release their textures, VulkanTexture::CleanUp waits for decodes still running and destroys anything
+	// still referenced elsewhere
+	m_Scene.Clear();
 
+	VulkanTexture::CleanUp();
+	VulkanMeshRegistry::CleanUp();
+	VulkanUtilities::DestroyBuffer(m_InstanceBuffer.buffer, m_InstanceBuffer.bufferMemory);
+	DestroyCullBuffers();
 	m_Camera.CleanUp();
 
 	for (uint8_t i = 0; i < MaxFrameDraws; ++i)
@@ -84,6 +178,19 @@ VulkanRenderer::~VulkanRenderer()
 	
 	vkDestroyCommandPool(m_MainDevice.device, m_GraphicsCommandPool, nullptr);
 
+	for (const auto& frameCommandPool : m_FrameCommandPools)
+	{
+		vkDestroyCommandPool(m_MainDevice.device, frameCommandPool, nullptr);
+	}
+
+	for (const auto& slicePools : m_SecondaryCommandPools)
+	{
+		for (const auto& slicePool : slicePools)
+		{
+			vkDestroyCommandPool(m_MainDevice.device, slicePool, nullptr);
+		}
+	}
+
 	for (const auto& framebuffer : m_Framebuffers)
 	{
 		vkDestroyFramebuffer(m_MainDevice.device, framebuffer, nullptr);
@@ -93,12 +200,44 @@ VulkanRenderer::~VulkanRenderer()
 
 	vkDestroyRenderPass(m_MainDevice.device, m_RenderPass, nullptr);
 
+	if (m_EarlyRenderPass)
+	{
+		vkDestroyRenderPass(m_MainDevice.device, m_EarlyRenderPass, nullptr);
+		vkDestroyRenderPass(m_MainDevice.device, m_LateRenderPass, nullptr);
+	}
+
 	vkDestroyPipeline(m_MainDevice.device, m_GraphicsPipeline, nullptr);
 	vkDestroyPipelineLayout(m_MainDevice.device, m_PipelineLayout, nullptr);
 
-	m_Swapchain.CleanUp(m_MainDevice.device);
+	if (m_CullPipeline)
+	{
+		vkDestroyPipeline(m_MainDevice.device, m_CullPipeline, nullptr);
+		vkDestroyPipelineLayout(m_MainDevice.device, m_CullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_MainDevice.device, m_CullDescriptorSetLayout, nullptr);
+	}
+
+	if (m_DepthReducePipeline)
+	{
+		vkDestroyPipeline(m_MainDevice.device, m_DepthReducePipeline, nullptr);
+		vkDestroyPipelineLayout(m_MainDevice.device, m_DepthReducePipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_MainDevice.device, m_DepthReduceDescriptorSetLayout, nullptr);
+	}
+
+	if (m_DepthPyramidSampler) vkDestroySampler(m_MainDevice.device, m_DepthPyramidSampler, nullptr);
+
+	for (const auto& offscreenImage : m_OffscreenImages)
+	{
+		VulkanUtilities::DestroyImageView(offscreenImage.imageView);
+		VulkanUtilities::DestroyImage(offscreenImage.image, offscreenImage.imageMemory);
+	}
+
+	if (!m_Settings.headless)
+	{
+		m_Swapchain.CleanUp(m_MainDevice.device);
+		vkDestroySurfaceKHR(m_VkInstance, m_Surface, nullptr);
+	}
 
-	vkDestroySurfaceKHR(m_VkInstance, m_Surface, nullptr);
+	VulkanUtilities::CleanUp();
 	vkDestroyDevice(m_MainDevice.device, nullptr);
 
 	if (enableValidationLayers)
@@ -112,14 +251,57 @@ VulkanRenderer::~VulkanRenderer()
 void VulkanRenderer::Draw()
 {
 	vkWaitForFences(m_MainDevice.device, 1, &m_RenderCompleteFence[m_CurrentFrameIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	vkResetFences(m_MainDevice.device, 1, &m_RenderCompleteFence[m_CurrentFrameIndex]);
+
+	ProcessDeletionQueue();
+	UpdateGpuTimings();
+	UpdateCullStats();
+
+	// Objects whose texture just became resident stop drawing the placeholder once their instance data is rewritten
+	if (VulkanTexture::Update() > 0)
+	{
+		std::fill(m_ObjectDirtyFrames.begin(), m_ObjectDirtyFrames.end(), static_cast<uint8_t>((1 << MaxFrameDraws) - 1));
+	}
 
 	// -- Get Next Image --
 	// Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
-	uint32_t imageIndex = 0;
-	VkResult re = vkAcquireNextImageKHR(m_MainDevice.device, m_Swapchain.swapchainHandle, std::numeric_limits<uint64_t>::max(), m_WaitForImageSph[m_CurrentFrameIndex], VK_NULL_HANDLE, &imageIndex);
+	// Offscreen images are owned per frame, so the frame index doubles as the image index
+	uint32_t imageIndex = m_CurrentFrameIndex;
+	VkResult re = VK_SUCCESS;
+
+	if (!m_Settings.headless)
+	{
+		// Skip the frame while minimised, the swapchain cannot be created with a zero extent
+		if ((m_SwapchainOutOfDate || m_Window->WasResized()) && !RecreateSwapchain()) return;
+
+		re = vkAcquireNextImageKHR(m_MainDevice.device, m_Swapchain.swapchainHandle, std::numeric_limits<uint64_t>::max(), m_WaitForImageSph[m_CurrentFrameIndex], VK_NULL_HANDLE, &imageIndex);
+
+		// Nothing was acquired, so the semaphore is unsignalled and the frame can simply be retried after recreation
+		if (re == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			RecreateSwapchain();
+			return;
+		}
+
+		// Suboptimal images are still presentable, recreate after presenting this one
+		if (re == VK_SUBOPTIMAL_KHR) m_SwapchainOutOfDate = true;
+		else if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to acquire swapchain image\n");
+	}
+
+	// Only reset once an image is acquired, an early return must leave the fence signalled for the next wait
+	vkResetFences(m_MainDevice.device, 1, &m_RenderCompleteFence[m_CurrentFrameIndex]);
+
+	VulkanUtilities::EndStagingFrame();
+	m_Stats.uploadBytes = VulkanUtilities::GetStagingStats().bytesLastFrame;
 
 	UpdateUniformBuffers();
+	UpdateTextureStreaming();
+
+	// The frame's fence has signalled, so its pool can be reset and the command buffer recorded from the live scene
+	const auto recordStart = std::chrono::high_resolution_clock::now();
+	vkResetCommandPool(m_MainDevice.device, m_FrameCommandPools[m_CurrentFrameIndex], 0);
+	RecordCommands(m_CurrentFrameIndex, imageIndex);
+	const auto recordEnd = std::chrono::high_resolution_clock::now();
+	m_Stats.cpuRecordTime = std::chrono::duration<double, std::milli>(recordEnd - recordStart).count();
 
 	// -- Submit Command Buffer To Render --
 	VkPipelineStageFlags waitStages[] =
@@ -133,9 +315,16 @@ void VulkanRenderer::Draw()
 	submitInfo.pWaitSemaphores = &m_WaitForImageSph[m_CurrentFrameIndex];			// List of semaphores to wait on
 	submitInfo.pWaitDstStageMask = waitStages;										// Stages to check semaphores at
 	submitInfo.commandBufferCount = 1;												// Number of command buffers to submit
-	submitInfo.pCommandBuffers = &m_CommandBuffers[imageIndex];						// Command buffer to submit
+	submitInfo.pCommandBuffers = &m_CommandBuffers[m_CurrentFrameIndex];			// Command buffer to submit
 	submitInfo.signalSemaphoreCount = 1;											// Number of semaphores to signal
 	submitInfo.pSignalSemaphores = &m_WaitForRenderingSph[m_CurrentFrameIndex];		// Semaphores to signal when command buffer finishes
+
+	if (m_Settings.headless)
+	{
+		// Nothing to acquire or present, the fence alone tracks completion
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.signalSemaphoreCount = 0;
+	}
 	
 	re = vkQueueSubmit(m_MainDevice.graphicsQueue, 1, &submitInfo, m_RenderCompleteFence[m_CurrentFrameIndex]);
 
@@ -144,6 +333,16 @@ void VulkanRenderer::Draw()
 		throw std::runtime_error("VULKAN ERROR: Failed to submit command buffer to queue\n");
 	}
 
+	m_LastImageIndex = imageIndex;
+	m_FrameHasTimestamps[m_CurrentFrameIndex] = true;
+	++m_SubmittedFrameCount;
+
+	if (m_Settings.headless)
+	{
+		m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % MaxFrameDraws;
+		return;
+	}
+
 	// -- Present Rendered Image To Screen --
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -155,21 +354,112 @@ void VulkanRenderer::Draw()
 
 	re = vkQueuePresentKHR(m_MainDevice.graphicsQueue, &presentInfo);
 
-	if (re != VK_SUCCESS)
+	if (re == VK_ERROR_OUT_OF_DATE_KHR || re == VK_SUBOPTIMAL_KHR)
 	{
-		throw std::runtime_error("VULKAN ERROR: Failed to submit command buffer to queue\n");
+		// Recreated at the start of the next frame
+		m_SwapchainOutOfDate = true;
+	}
+	else if (re != VK_SUCCESS)
+	{
+		throw std::runtime_error("VULKAN ERROR: Failed to present swapchain image\n");
 	}
 
 	m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % MaxFrameDraws;
 }
 
+void VulkanRenderer::ReadFrame(std::vector<uint8_t>& _pixels)
+{
+	if (!m_Settings.headless)
+	{
+		throw std::runtime_error("VULKAN ERROR: Frame read back is only supported in headless mode\n");
+	}
+
+	// Wait for the frame that last rendered into the image to finish
+	const uint32_t lastFrameIndex = (m_CurrentFrameIndex + MaxFrameDraws - 1) % MaxFrameDraws;
+	vkWaitForFences(m_MainDevice.device, 1, &m_RenderCompleteFence[lastFrameIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	const VkExtent2D extent = GetRenderExtent();
+	const VkDeviceSize imageSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+	UniformBuffer readbackBuffer{};
+
+	BufferInfo readbackBufferInfo{};
+	readbackBufferInfo.pBuffer = &readbackBuffer.buffer;
+	readbackBufferInfo.pBufferMemory = &readbackBuffer.bufferMemory;
+	readbackBufferInfo.bufferSize = imageSize;
+	readbackBufferInfo.bufferUsage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	readbackBufferInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VulkanUtilities::CreateBuffer(readbackBufferInfo);
+
+	// Render pass leaves offscreen images in TRANSFER_SRC_OPTIMAL
+	VulkanUtilities::CopyImageToBuffer(m_OffscreenImages[m_LastImageIndex].image, readbackBuffer.buffer, extent);
+
+	void* pData = nullptr;
+	VulkanUtilities::MapMemory(readbackBuffer.bufferMemory, &pData);
+	_pixels.resize(static_cast<size_t>(imageSize));
+	memcpy(_pixels.data(), pData, static_cast<size_t>(imageSize));
+
+	VulkanUtilities::DestroyBuffer(readbackBuffer.buffer, readbackBuffer.bufferMemory);
+}
+
+void VulkanRenderer::SetScene(Scene&& _scene)
+{
+	// Previously recorded command buffers may still reference the old objects
+	vkDeviceWaitIdle(m_MainDevice.device);
+
+	m_Scene = std::move(_scene);
+	m_SceneBvhStale = true;
+	ResetObjectBounds();
+
+	// The device is idle, so the instance buffer can be replaced before the descriptors are rewritten
+	if (m_Scene.GetObjectCount() > m_InstanceCapacity)
+	{
+		VulkanUtilities::DestroyBuffer(m_InstanceBuffer.buffer, m_InstanceBuffer.bufferMemory);
+		CreateInstanceBuffer(m_Scene.GetObjectCount());
+	}
+
+	UpdateCullBuffers();
+
+	// The new objects' buffers are only valid once their upload batch has finished, and the scene is handed over with
+	// its textures resident rather than drawing placeholders, so the first frames match the rest
+	VulkanUtilities::WaitForUpload(VulkanUtilities::FlushUploads());
+	VulkanTexture::WaitForLoads();
+
+	WriteDescriptors();
+}
+
+VkExtent2D VulkanRenderer::GetRenderExtent() const
+{
+	if (m_Settings.headless)
+	{
+		return { m_Settings.width, m_Settings.height };
+	}
+
+	return m_Swapchain.GetSwapchainImageExtent();
+}
+
+VkFormat VulkanRenderer::GetColorFormat() const
+{
+	if (m_Settings.headless)
+	{
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	return m_Swapchain.GetSwapchainSurfaceFormat().format;
+}
+
 void VulkanRenderer::CreateInstance()
 {
 	VkApplicationInfo appInfo = Vki::AppInfo("Voyager Deep", VK_MAKE_VERSION(1, 0, 0), "Banshee", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_3);
 
-	// Get required vulkan instance extensions from glfw
+	// Get required vulkan instance extensions from glfw (a headless renderer has no surface to create)
 	uint32_t requiredInstanceExtensionCount = 0;
-	const char** glfwRequiredExtensions = glfwGetRequiredInstanceExtensions(&requiredInstanceExtensionCount);
+	const char** glfwRequiredExtensions = nullptr;
+
+	if (!m_Settings.headless)
+	{
+		glfwRequiredExtensions = glfwGetRequiredInstanceExtensions(&requiredInstanceExtensionCount);
+	}
 
 	std::vector<const char*> requiredExtensions;
 	requiredExtensions.reserve(requiredInstanceExtensionCount);
@@ -267,6 +557,7 @@ void VulkanRenderer::CreateLogicalDevice()
 {
 	m_MainDevice.queueFamilyIndices = GetQueueFamilyIndices(m_MainDevice.physicalDevice);
 	std::vector<int> uniqueQueueFamilies = { m_MainDevice.queueFamilyIndices.graphicsFamily, m_MainDevice.queueFamilyIndices.presentationFamily };
+	if (m_MainDevice.queueFamilyIndices.HasDedicatedTransfer()) uniqueQueueFamilies.emplace_back(m_MainDevice.queueFamilyIndices.transferFamily);
 
 	// Remove duplicate indices from vector
 	std::sort(uniqueQueueFamilies.begin(), uniqueQueueFamilies.end());
@@ -281,10 +572,77 @@ void VulkanRenderer::CreateLogicalDevice()
 		queueCreateInfos.emplace_back(deviceQueueCreateInfo);
 	}
 
+	vkGetPhysicalDeviceProperties(m_MainDevice.physicalDevice, &m_MainDevice.physicalDeviceProperties);
+	vkGetPhysicalDeviceFeatures(m_MainDevice.physicalDevice, &m_MainDevice.physicalDeviceFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 
-	VkDeviceCreateInfo deviceCreateInfo = Vki::DeviceCreateInfo(deviceFeatures, queueCreateInfos, m_MainDevice.requiredDeviceExtensions);
+	// Cooked BC textures are only picked when the device can sample them, see VulkanTexture::SetDescriptorTable
+	deviceFeatures.textureCompressionBC = m_MainDevice.physicalDeviceFeatures.textureCompressionBC;
+
+	// Indirect draws written by the GPU culling pass, enabled when available
+	deviceFeatures.multiDrawIndirect = m_MainDevice.physicalDeviceFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = m_MainDevice.physicalDeviceFeatures.drawIndirectFirstInstance;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	// CheckDeviceSuitability only accepts Vulkan 1.2 devices, so the 1.2 feature chain is always there to query and enable
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 supportedFeatures{};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &supportedVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(m_MainDevice.physicalDevice, &supportedFeatures);
+
+	vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+	m_MainDevice.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+
+	// Descriptor indexing for the bindless texture table, CheckDeviceSuitability only accepts devices that support it
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	vulkan12Features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+	VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+	vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 deviceProperties{};
+	deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties.pNext = &vulkan12Properties;
+	vkGetPhysicalDeviceProperties2(m_MainDevice.physicalDevice, &deviceProperties);
+
+	// The whole table is visible to the fragment stage, so the per-stage limits apply as well as the per-set one. The
+	// fragment stage's sampler and the vertex stage's buffers sit outside the table
+	m_MainDevice.maxBindlessTextures = std::min({ vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+												  vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+												  vulkan12Properties.maxPerStageUpdateAfterBindResources - 1,
+												  static_cast<uint32_t>(MaxBindlessTextures) });
+
+	// Heap budgets let texture streaming shrink when other allocations or applications need the memory, without the
+	// extension it falls back to heap sizes and its own allocations
+	std::vector<const char*> deviceExtensions = m_MainDevice.requiredDeviceExtensions;
+	uint32_t deviceExtensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(m_MainDevice.physicalDevice, nullptr, &deviceExtensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableDeviceExtensions(deviceExtensionCount);
+	vkEnumerateDeviceExtensionProperties(m_MainDevice.physicalDevice, nullptr, &deviceExtensionCount, availableDeviceExtensions.data());
+
+	for (const auto& availableDeviceExtension : availableDeviceExtensions)
+	{
+		if (std::strcmp(availableDeviceExtension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+		{
+			deviceExtensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			m_MainDevice.memoryBudget = VK_TRUE;
+			break;
+		}
+	}
+
+	VkDeviceCreateInfo deviceCreateInfo = Vki::DeviceCreateInfo(deviceFeatures, queueCreateInfos, deviceExtensions);
+	deviceCreateInfo.pNext = &vulkan12Features;
 	
 	VkResult re = vkCreateDevice(m_MainDevice.physicalDevice, &deviceCreateInfo, nullptr, &m_MainDevice.device);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create logical device\n");
@@ -292,8 +650,10 @@ void VulkanRenderer::CreateLogicalDevice()
 	vkGetDeviceQueue(m_MainDevice.device, m_MainDevice.queueFamilyIndices.graphicsFamily, 0, &m_MainDevice.graphicsQueue);
 	vkGetDeviceQueue(m_MainDevice.device, m_MainDevice.queueFamilyIndices.presentationFamily, 0, &m_MainDevice.presentationQueue);
 
-	vkGetPhysicalDeviceProperties(m_MainDevice.physicalDevice, &m_MainDevice.physicalDeviceProperties);
-	vkGetPhysicalDeviceFeatures(m_MainDevice.physicalDevice, &m_MainDevice.physicalDeviceFeatures);
+	if (m_MainDevice.queueFamilyIndices.HasDedicatedTransfer())
+	{
+		vkGetDeviceQueue(m_MainDevice.device, m_MainDevice.queueFamilyIndices.transferFamily, 0, &m_MainDevice.transferQueue);
+	}
 }
 
 VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat>& _formats, const VkImageTiling _tiling, const VkFormatFeatureFlags _featureFlags)
@@ -319,7 +679,211 @@ VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat>& _for
 
 void VulkanRenderer::UpdateUniformBuffers()
 {
-	m_Camera.Update();
+	m_Camera.Update(m_CurrentFrameIndex);
+	UpdateTransforms();
+
+	if (m_Settings.gpuCulling) UpdateObjectBuffer(m_CurrentFrameIndex);
+	else BuildDrawGroups(m_CurrentFrameIndex);
+}
+
+void VulkanRenderer::UpdateObjectBuffer(const uint32_t _frameIndex)
+{
+	const uint32_t objectCount = m_Scene.GetObjectCount();
+
+	if (objectCount > m_InstanceCapacity)
+	{
+		throw std::runtime_error("VULKAN ERROR: Scene has more objects than the instance buffer holds, objects must be added through SetScene\n");
+	}
+
+	// Objects keep their index as instance, so only those that moved since this frame's slice was last written are copied
+	const uint8_t allFrames = (1 << MaxFrameDraws) - 1;
+	const uint8_t frameBit = 1 << _frameIndex;
+
+	if (m_ObjectDirtyFrames.size() != objectCount) m_ObjectDirtyFrames.assign(objectCount, allFrames);
+
+	ObjectData* pInstances = reinterpret_cast<ObjectData*>(m_pInstanceData + m_InstanceStride * _frameIndex);
+	const TransformSystem& transforms = m_Scene.GetTransforms();
+
+	// Entities without a mesh keep the InvalidMeshId UpdateCullBuffers wrote for them
+	m_Scene.GetRegistry().Each<TransformComponent, MeshComponent, MaterialComponent>([&](const Entity, const TransformComponent& _transform, const MeshComponent& _mesh, const MaterialComponent& _material)
+	{
+		const TransformId i = _transform.transformId;
+		if (!(m_ObjectDirtyFrames[i] & frameBit)) return;
+
+		// Straight into the mapped slice
+		ObjectData& objectData = pInstances[i];
+		objectData.model = VulkanMeshRegistry::GetModelMatrix(VulkanMeshRegistry::GetMesh(_mesh.meshId), transforms.GetWorldMatrix(i));
+		objectData.texId = VulkanTexture::GetBoundSlot(_material.texId);
+		objectData.meshId = _mesh.meshId;
+		m_ObjectDirtyFrames[i] &= ~frameBit;
+	});
+}
+
+void VulkanRenderer::UpdateTransforms()
+{
+	// Only transforms set since the last frame, and everything below them, are rebuilt
+	TransformSystem& transforms = m_Scene.GetTransforms();
+	m_UpdatedTransforms.clear();
+	transforms.Update(m_UpdatedTransforms);
+
+	const EntityRegistry& registry = m_Scene.GetRegistry();
+	const uint8_t allFrames = (1 << MaxFrameDraws) - 1;
+	const bool tracksFrames = m_ObjectDirtyFrames.size() == m_Scene.GetObjectCount();
+
+	for (const TransformId id : m_UpdatedTransforms)
+	{
+		const MeshComponent* pMesh = registry.TryGet<MeshComponent>(m_Scene.GetEntity(id));
+		m_ObjectBounds[id] = pMesh ? VulkanMeshRegistry::GetMesh(pMesh->meshId).localBounds.Transform(transforms.GetWorldMatrix(id)) : Aabb();
+
+		if (!m_SceneBvhStale) m_SceneBvh.Update(id, m_ObjectBounds[id]);
+		if (tracksFrames) m_ObjectDirtyFrames[id] = allFrames;
+	}
+
+	// The GPU path doesn't draw through it, but it keeps picking and proximity queries current
+	UpdateSceneBvh();
+}
+
+void VulkanRenderer::UpdateSceneBvh()
+{
+	if (m_SceneBvhStale)
+	{
+		m_SceneBvh.Build(m_ObjectBounds);
+		m_SceneBvhStale = false;
+		return;
+	}
+
+	m_SceneBvh.Refit();
+	if (m_SceneBvh.NeedsRebuild()) m_SceneBvh.Rebuild();
+}
+
+void VulkanRenderer::UpdateTextureStreaming()
+{
+	if (!VulkanTexture::IsStreaming() || m_SubmittedFrameCount % StreamingInterval != 0) return;
+
+	// A world space length at distance d covers length * pixelsPerUnit / d pixels. proj[1][1] is 1 / tan(fov / 2)
+	const float pixelsPerUnit = 0.5f * static_cast<float>(GetRenderExtent().height) * std::abs(m_Camera.GetCameraTransform().proj[1][1]);
+	const glm::vec3& cameraPosition = m_Camera.GetPosition();
+	const EntityRegistry& registry = m_Scene.GetRegistry();
+
+	m_StreamingObjects.clear();
+	m_SceneBvh.QueryFrustum(m_Camera.GetFrustumPlanes(), m_StreamingObjects);
+
+	// UVs are taken to repeat once across an object's largest extent, measured from its nearest point so the camera
+	// inside an object asks for the finest level
+	for (const uint32_t objectIndex : m_StreamingObjects)
+	{
+		const MaterialComponent* pMaterial = registry.TryGet<MaterialComponent>(m_Scene.GetEntity(objectIndex));
+		if (!pMaterial) continue;
+
+		const Aabb& bounds = m_ObjectBounds[objectIndex];
+		const glm::vec3 extent = bounds.max - bounds.min;
+		const float size = std::max({ extent.x, extent.y, extent.z });
+		const float distance = std::max(glm::length(glm::clamp(cameraPosition, bounds.min, bounds.max) - cameraPosition), 0.1f);
+
+		VulkanTexture::RequestFootprint(pMaterial->texId, size * pixelsPerUnit / distance);
+	}
+
+	VulkanTexture::UpdateStreaming();
+}
+
+void VulkanRenderer::BuildDrawGroups(const uint32_t _frameIndex)
+{
+	if (m_Scene.GetObjectCount() > m_InstanceCapacity)
+	{
+		throw std::runtime_error("VULKAN ERROR: Scene has more objects than the instance buffer holds, objects must be added through SetScene\n");
+	}
+
+	EntityRegistry& registry = m_Scene.GetRegistry();
+
+	// Gather every drawable entity as a culling candidate
+	m_CullCandidates.clear();
+	registry.Each<TransformComponent, MeshComponent>([this](const Entity, const TransformComponent& _transform, const MeshComponent& _mesh)
+	{
+		m_CullCandidates.emplace_back(_mesh.meshId, _transform.transformId);
+	});
+
+	m_DrawOrder.clear();
+
+	if (m_Settings.frustumCulling && m_Settings.bvhCulling)
+	{
+		m_VisibleCandidates.clear();
+		m_SceneBvh.QueryFrustum(m_Camera.GetFrustumPlanes(), m_VisibleCandidates);
+
+		// The tree only holds objects with bounds, which are exactly the ones with a mesh
+		for (const uint32_t objectIndex : m_VisibleCandidates) m_DrawOrder.emplace_back(registry.Get<MeshComponent>(m_Scene.GetEntity(objectIndex)).meshId, objectIndex);
+	}
+	else if (m_Settings.frustumCulling)
+	{
+		m_FrustumCuller.Reset();
+
+		for (const auto& candidate : m_CullCandidates) m_FrustumCuller.Add(m_ObjectBounds[candidate.second]);
+
+		m_VisibleCandidates.clear();
+		m_FrustumCuller.Cull(m_Camera.GetFrustumPlanes(), m_VisibleCandidates);
+
+		for (const uint32_t candidate : m_VisibleCandidates) m_DrawOrder.emplace_back(m_CullCandidates[candidate]);
+	}
+	else
+	{
+		m_DrawOrder = m_CullCandidates;
+	}
+
+	m_Stats.visibleObjects = static_cast<uint32_t>(m_DrawOrder.size());
+	m_Stats.culledObjects = static_cast<uint32_t>(m_CullCandidates.size() - m_DrawOrder.size());
+
+	// Sort by page then mesh so each mesh's instances are contiguous and page binds stay minimal
+	std::sort(m_DrawOrder.begin(), m_DrawOrder.end(), [](const auto& _a, const auto& _b)
+	{
+		const uint32_t pageA = VulkanMeshRegistry::GetMesh(_a.first).pageIndex;
+		const uint32_t pageB = VulkanMeshRegistry::GetMesh(_b.first).pageIndex;
+		return pageA != pageB ? pageA < pageB : _a < _b;
+	});
+
+	ObjectData* pInstances = reinterpret_cast<ObjectData*>(m_pInstanceData + m_InstanceStride * _frameIndex);
+	const TransformSystem& transforms = m_Scene.GetTransforms();
+	m_DrawGroups.clear();
+
+	for (uint32_t instance = 0; instance < m_DrawOrder.size(); ++instance)
+	{
+		const uint32_t objectIndex = m_DrawOrder[instance].second;
+		const MeshId meshId = m_DrawOrder[instance].first;
+
+		ObjectData& objectData = pInstances[instance];
+		objectData.model = VulkanMeshRegistry::GetModelMatrix(VulkanMeshRegistry::GetMesh(meshId), transforms.GetWorldMatrix(objectIndex));
+		objectData.texId = VulkanTexture::GetBoundSlot(registry.Get<MaterialComponent>(m_Scene.GetEntity(objectIndex)).texId);
+		objectData.meshId = meshId;
+
+		if (!m_DrawGroups.empty() && m_DrawGroups.back().meshId == meshId) ++m_DrawGroups.back().instanceCount;
+		else m_DrawGroups.push_back({ meshId, instance, 1 });
+	}
+}
+
+void VulkanRenderer::UpdateGpuTimings()
+{
+	// Called once the frame's fence has signalled, so the timestamps of its last submission are complete
+	if (!m_TimestampQueryPool || !m_FrameHasTimestamps[m_CurrentFrameIndex]) return;
+
+	uint64_t timestamps[2] = {};
+	VkResult re = vkGetQueryPoolResults(m_MainDevice.device, m_TimestampQueryPool, m_CurrentFrameIndex * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	// Skip the sample if the results aren't available yet
+	if (re != VK_SUCCESS) return;
+
+	const double timestampPeriod = static_cast<double>(m_MainDevice.physicalDeviceProperties.limits.timestampPeriod);
+	m_Stats.gpuFrameTime = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0;
+	m_Stats.gpuTimeValid = true;
+}
+
+void VulkanRenderer::UpdateCullStats()
+{
+	// Called once the frame's fence has signalled, the counters are those of its last submission
+	if (!m_pCullStats) return;
+
+	const CullStats& cullStats = m_pCullStats[m_CurrentFrameIndex];
+	m_Stats.visibleObjects = cullStats.visibleObjects;
+	m_Stats.culledObjects = cullStats.frustumCulledObjects;
+	m_Stats.occludedObjects = cullStats.occludedObjects;
+	m_Stats.occludedTriangles = cullStats.occludedTriangles;
 }
 
 VkBool32 VulkanRenderer::CheckDeviceSuitability(const VkPhysicalDevice& _physicalDevice, uint32_t& _score)
@@ -329,9 +893,12 @@ VkBool32 VulkanRenderer::CheckDeviceSuitability(const VkPhysicalDevice& _physica
 	QueueFamilyIndices queueFamilyIndices = GetQueueFamilyIndices(_physicalDevice);
 	if (!queueFamilyIndices.IsValid()) return false;
 
-	SwapchainInfo swapchainInfo{};
-	VulkanUtilities::GetSwapchainInfo(_physicalDevice, m_Surface, swapchainInfo);
-	if (swapchainInfo.surfaceFormats.empty() || swapchainInfo.surfacePresentModes.empty()) return false;
+	if (!m_Settings.headless)
+	{
+		SwapchainInfo swapchainInfo{};
+		VulkanUtilities::GetSwapchainInfo(_physicalDevice, m_Surface, swapchainInfo);
+		if (swapchainInfo.surfaceFormats.empty() || swapchainInfo.surfacePresentModes.empty()) return false;
+	}
 
 	VkPhysicalDeviceProperties deviceProperties;
 	VkPhysicalDeviceFeatures deviceFeatures;
@@ -339,6 +906,24 @@ VkBool32 VulkanRenderer::CheckDeviceSuitability(const VkPhysicalDevice& _physica
 	vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
 	vkGetPhysicalDeviceFeatures(_physicalDevice, &deviceFeatures);
 
+	// Textures are bound through one update-after-bind descriptor table, which needs Vulkan 1.2 descriptor indexing
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_2) return false;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(_physicalDevice, &features);
+
+	if (!vulkan12Features.runtimeDescriptorArray || !vulkan12Features.descriptorBindingPartiallyBound ||
+		!vulkan12Features.descriptorBindingSampledImageUpdateAfterBind || !vulkan12Features.descriptorBindingUpdateUnusedWhilePending ||
+		!vulkan12Features.descriptorBindingVariableDescriptorCount || !vulkan12Features.shaderSampledImageArrayNonUniformIndexing)
+	{
+		return false;
+	}
+
 	if (deviceFeatures.samplerAnisotropy)
 	{
 		_score += 1000;
@@ -403,7 +988,16 @@ QueueFamilyIndices VulkanRenderer::GetQueueFamilyIndices(const VkPhysicalDevice&
 		}
 
 		VkBool32 presentationSupport = VK_FALSE;
-		vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, static_cast<uint32_t>(index), m_Surface, &presentationSupport);
+
+		if (m_Settings.headless)
+		{
+			// Nothing is presented, so the graphics queue stands in for the presentation queue
+			presentationSupport = queueFamilyIndices.graphicsFamily == index;
+		}
+		else
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, static_cast<uint32_t>(index), m_Surface, &presentationSupport);
+		}
 		
 		if (queueFamily.queueCount > 0 && presentationSupport)
 		{
@@ -418,6 +1012,22 @@ QueueFamilyIndices VulkanRenderer::GetQueueFamilyIndices(const VkPhysicalDevice&
 		++index;
 	}
 
+	// A transfer-only family usually maps to the copy engine, texture copies need it to accept any extent
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		const VkQueueFamilyProperties& queueFamily = availableQueueFamilies[i];
+		const VkExtent3D& granularity = queueFamily.minImageTransferGranularity;
+
+		if (queueFamily.queueCount > 0 &&
+			(queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+			!(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+			granularity.width == 1 && granularity.height == 1 && granularity.depth == 1)
+		{
+			queueFamilyIndices.transferFamily = static_cast<int32_t>(i);
+			break;
+		}
+	}
+
 	return queueFamilyIndices;
 }
 
@@ -431,12 +1041,12 @@ void VulkanRenderer::CreateSurface()
 	}
 }
 
-void VulkanRenderer::CreateSwapchain()
+void VulkanRenderer::CreateSwapchain(const VkSwapchainKHR _oldSwapchain)
 {
 	int width, height = 0;
 	glfwGetFramebufferSize(m_Window->GetWindow(), &width, &height);
 
-	VkSwapchainCreateInfoKHR swapchainCreateInfo = m_Swapchain.Init(m_MainDevice.physicalDevice, m_MainDevice.device, m_Surface, std::make_pair(m_MainDevice.queueFamilyIndices.graphicsFamily, m_MainDevice.queueFamilyIndices.presentationFamily), width, height);
+	VkSwapchainCreateInfoKHR swapchainCreateInfo = m_Swapchain.Init(m_MainDevice.physicalDevice, m_MainDevice.device, m_Surface, std::make_pair(m_MainDevice.queueFamilyIndices.graphicsFamily, m_MainDevice.queueFamilyIndices.presentationFamily), width, height, _oldSwapchain);
 
 	VkResult re = vkCreateSwapchainKHR(m_MainDevice.device, &swapchainCreateInfo, nullptr, &m_Swapchain.swapchainHandle);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create swapchain\n");
@@ -444,6 +1054,86 @@ void VulkanRenderer::CreateSwapchain()
 	m_Swapchain.CreateSwapchainImageViews(m_MainDevice.device);
 }
 
+bool VulkanRenderer::RecreateSwapchain()
+{
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window->GetWindow(), &width, &height);
+	if (width == 0 || height == 0) return false;
+
+	// Frames still in flight may reference the old images, views, depth buffer and framebuffers,
+	// so they are retired instead of waiting for the device to go idle
+	VulkanSwapchain oldSwapchain = m_Swapchain;
+	CustomImage oldDepthImage = m_DepthImage;
+	std::vector<VkFramebuffer> oldFramebuffers = m_Framebuffers;
+	CustomImage oldDepthPyramid = m_DepthPyramid;
+	std::vector<VkImageView> oldPyramidLevelViews = m_DepthPyramidLevelViews;
+
+	m_Swapchain = VulkanSwapchain();
+	CreateSwapchain(oldSwapchain.swapchainHandle);
+
+	// The render pass and pipeline are kept, they only depend on the surface format
+	if (m_Swapchain.GetSwapchainSurfaceFormat().format != oldSwapchain.GetSwapchainSurfaceFormat().format)
+	{
+		throw std::runtime_error("VULKAN ERROR: Swapchain surface format changed during recreation\n");
+	}
+
+	CreateDepthBufferImage();
+	CreateFramebuffers();
+	SetupCameraProjection();
+
+	// Culling and reduction descriptors reference the depth buffer and pyramid directly. Each frame's sets are
+	// repointed when it is next recorded, the old pyramid is retired with the rest
+	if (m_Settings.gpuCulling)
+	{
+		m_DepthPyramid = {};
+		m_DepthPyramidLevelViews.clear();
+		CreateDepthPyramid();
+	}
+
+	const VkDevice device = m_MainDevice.device;
+	DestroyAfterFrames([device, oldSwapchain, oldDepthImage, oldFramebuffers, oldDepthPyramid, oldPyramidLevelViews]() mutable
+	{
+		for (const auto& framebuffer : oldFramebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+
+		for (const auto& levelView : oldPyramidLevelViews)
+		{
+			VulkanUtilities::DestroyImageView(levelView);
+		}
+
+		if (oldDepthPyramid.image)
+		{
+			VulkanUtilities::DestroyImageView(oldDepthPyramid.imageView);
+			VulkanUtilities::DestroyImage(oldDepthPyramid.image, oldDepthPyramid.imageMemory);
+		}
+
+		VulkanUtilities::DestroyImageView(oldDepthImage.imageView);
+		VulkanUtilities::DestroyImage(oldDepthImage.image, oldDepthImage.imageMemory);
+		oldSwapchain.CleanUp(device);
+	});
+
+	m_Window->SetResized(false);
+	m_SwapchainOutOfDate = false;
+
+	return true;
+}
+
+void VulkanRenderer::CreateOffscreenImages()
+{
+	m_OffscreenImages.resize(MaxFrameDraws);
+
+	for (auto& offscreenImage : m_OffscreenImages)
+	{
+		offscreenImage = VulkanUtilities::CreateImage(GetRenderExtent(), GetColorFormat(), VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VkImageViewCreateInfo imageViewCreateInfo = Vki::ImageViewCreateInfo(offscreenImage.image, offscreenImage.imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		VkResult re = vkCreateImageView(m_MainDevice.device, &imageViewCreateInfo, nullptr, &offscreenImage.imageView);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create an image view\n");
+	}
+}
+
 void VulkanRenderer::CreateGraphicsPipeline()
 {
 	// -- Shader Creation --
@@ -458,23 +1148,34 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
 
 	// -- Vertex Input --
-	VkVertexInputBindingDescription bindingDescription = Vki::VertexInputBindingDescription(0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX);
+	VkVertexInputBindingDescription bindingDescription = Vki::VertexInputBindingDescription(0, VulkanMeshRegistry::GetVertexStride(), VK_VERTEX_INPUT_RATE_VERTEX);
 
 	std::vector<VkVertexInputAttributeDescription> vertexAttributesDescriptions{};
 	vertexAttributesDescriptions.resize(3);
 
-	vertexAttributesDescriptions[0] = Vki::VertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position));
-	vertexAttributesDescriptions[1] = Vki::VertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color));
-	vertexAttributesDescriptions[2] = Vki::VertexInputAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv));
-
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = Vki::VertexInputStateCreateInfo(1, bindingDescription, vertexAttributesDescriptions);
-
+	// The shader reads floats either way, compact attributes are converted by the vertex fetch
+	if (m_Settings.vertexFormat == VertexFormat::Compact)
+	{
+		vertexAttributesDescriptions[0] = Vki::VertexInputAttributeDescription(0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position));
+		vertexAttributesDescriptions[1] = Vki::VertexInputAttributeDescription(0, 1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, color));
+		vertexAttributesDescriptions[2] = Vki::VertexInputAttributeDescription(0, 2, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv));
+	}
+	else
+	{
+		vertexAttributesDescriptions[0] = Vki::VertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position));
+		vertexAttributesDescriptions[1] = Vki::VertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color));
+		vertexAttributesDescriptions[2] = Vki::VertexInputAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv));
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = Vki::VertexInputStateCreateInfo(1, bindingDescription, vertexAttributesDescriptions);
+
 	// -- Input Assembly --
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = Vki::InputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
 
 	// -- Viewport & Scissor --
-	VkViewport viewport = Vki::ViewportInfo(m_Swapchain.GetSwapchainImageExtent());
-	VkRect2D scissor = Vki::ScissorInfo(m_Swapchain.GetSwapchainImageExtent());
+	// Set dynamically while recording, these only provide the counts
+	VkViewport viewport = Vki::ViewportInfo(GetRenderExtent());
+	VkRect2D scissor = Vki::ScissorInfo(GetRenderExtent());
 	VkPipelineViewportStateCreateInfo viewportCreateInfo = Vki::ViewportStateCreateInfo(1, viewport, 1, scissor);
 
 	// -- Rasterizer --
@@ -495,11 +1196,8 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo = Vki::ColorBlendStateCreateInfo(VK_FALSE, 1, colorBlendState);
 
 	// -- Pipeline layout --
-	VkPushConstantRange vertexPushConstants = Vki::PushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectData));
-	
+	// Per-object data is read from the instance buffer, so no push constants are needed
 	VkPipelineLayoutCreateInfo layoutCreateInfo = Vki::LayoutCreateInfo();
-	layoutCreateInfo.pushConstantRangeCount = 1;
-	layoutCreateInfo.pPushConstantRanges = &vertexPushConstants;
 	layoutCreateInfo.setLayoutCount = static_cast<uint32_t>(m_DescriptorSetLayout.size());
 	layoutCreateInfo.pSetLayouts = m_DescriptorSetLayout.data();
 
@@ -518,6 +1216,7 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	m_PipelineBuilder.multisampleStateCreateInfo = multisampleCreateInfo;
 	m_PipelineBuilder.colorBlendStateCreateInfo = colorBlendCreateInfo;
 	m_PipelineBuilder.depthStencilStateCreateInfo = depthStencilCreateInfo;
+	m_PipelineBuilder.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 	m_PipelineBuilder.layout = m_PipelineLayout;
 
 	m_GraphicsPipeline = m_PipelineBuilder.Build(m_RenderPass, m_MainDevice.device);
@@ -527,30 +1226,48 @@ void VulkanRenderer::CreateGraphicsPipeline()
 }
 
 void VulkanRenderer::CreateRenderPass()
+{
+	m_RenderPass = BuildRenderPass(true, true);
+
+	// Occlusion culling draws the frame in two passes with the depth pyramid built in between
+	if (m_Settings.occlusionCulling)
+	{
+		m_EarlyRenderPass = BuildRenderPass(true, false);
+		m_LateRenderPass = BuildRenderPass(false, true);
+	}
+}
+
+VkRenderPass VulkanRenderer::BuildRenderPass(const bool _firstPass, const bool _lastPass)
 {
 	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = m_Swapchain.GetSwapchainSurfaceFormat().format;	// Format to use for attachment
+	colorAttachment.format = GetColorFormat();									// Format to use for attachment
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;							// Number of sample to write for multisampling
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;						// Describes what to do with the attachment before rendering
+	colorAttachment.loadOp = _firstPass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;	// Describes what to do with the attachment before rendering
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;						// Describes what to do with the attachment after rendering
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;			// Describes what to do with stencil before rending
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;			// Describes what to do with stencil after rendering
 
+	// Depth is only kept when a later pass (and the depth pyramid) needs it
 	VkAttachmentDescription depthStencilAttachment{};
 	depthStencilAttachment.format = m_DepthImage.imageFormat;
 	depthStencilAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthStencilAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthStencilAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthStencilAttachment.loadOp = _firstPass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthStencilAttachment.storeOp = _lastPass ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 	depthStencilAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthStencilAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
 	// Framebuffer data will be stored as an image, but images can be given different data layouts
 	// to give optimal use for certain operations
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Image data layout before render pass starts
+	colorAttachment.initialLayout = _firstPass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;	// Image data layout before render pass starts
 	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;		// Image data layout after render pass finishes (to change to)
 
-	depthStencilAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthStencilAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	// Offscreen images are copied out rather than presented
+	if (m_Settings.headless) colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	if (!_lastPass) colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// Between the passes depth is read by the pyramid reduction
+	depthStencilAttachment.initialLayout = _firstPass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthStencilAttachment.finalLayout = _lastPass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
 	// Attachment reference uses an attachment index that refers to index in the attachment list passed to renderPassCreateInfo
 	VkAttachmentReference colorAttachmentRef{};
@@ -592,6 +1309,29 @@ void VulkanRenderer::CreateRenderPass()
 	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 	subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
 
+	if (m_Settings.headless)
+	{
+		subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		subpassDependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	}
+
+	if (m_Settings.occlusionCulling)
+	{
+		// Depth writes wait for the pyramid reduction that last read the depth buffer
+		subpassDependencies[0].srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		subpassDependencies[0].dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		subpassDependencies[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	}
+
+	if (!_lastPass)
+	{
+		// The late pass keeps drawing into the colour attachment and the reduction reads depth
+		subpassDependencies[1].srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		subpassDependencies[1].srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		subpassDependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+	}
+
 	std::array<VkAttachmentDescription, 2> attachments{ colorAttachment, depthStencilAttachment };
 
 	VkRenderPassCreateInfo renderPassCreateInfo = Vki::RenderPassCreateInfo();
@@ -602,16 +1342,29 @@ void VulkanRenderer::CreateRenderPass()
 	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
 	renderPassCreateInfo.pDependencies = subpassDependencies.data();
 
-	VkResult re = vkCreateRenderPass(m_MainDevice.device, &renderPassCreateInfo, nullptr, &m_RenderPass);
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkResult re = vkCreateRenderPass(m_MainDevice.device, &renderPassCreateInfo, nullptr, &renderPass);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create render pass\n");
+
+	return renderPass;
 }
 
 void VulkanRenderer::CreateDepthBufferImage()
 {
 	std::vector<VkFormat> desiredFormats { VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT };
-	VkFormat depthImageFormat = ChooseSupportedFormat(desiredFormats, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	// The depth pyramid's first level is reduced from the depth buffer
+	if (m_Settings.occlusionCulling)
+	{
+		depthFeatures |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		depthUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+	}
 
-	m_DepthImage = VulkanUtilities::CreateImage(m_Swapchain.GetSwapchainImageExtent(), depthImageFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VkFormat depthImageFormat = ChooseSupportedFormat(desiredFormats, VK_IMAGE_TILING_OPTIMAL, depthFeatures);
+
+	m_DepthImage = VulkanUtilities::CreateImage(GetRenderExtent(), depthImageFormat, depthUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	VkImageViewCreateInfo imageViewCreateInfo = Vki::ImageViewCreateInfo(m_DepthImage.image, depthImageFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 	VkResult re = vkCreateImageView(m_MainDevice.device, &imageViewCreateInfo, nullptr, &m_DepthImage.imageView);
@@ -620,20 +1373,29 @@ void VulkanRenderer::CreateDepthBufferImage()
 
 void VulkanRenderer::CreateFramebuffers()
 {
-	std::vector<SwapchainImage> swapchainImages = m_Swapchain.GetSwapchainImages();
+	std::vector<VkImageView> colorImageViews;
+
+	if (m_Settings.headless)
+	{
+		for (const auto& offscreenImage : m_OffscreenImages) colorImageViews.emplace_back(offscreenImage.imageView);
+	}
+	else
+	{
+		for (const auto& swapchainImage : m_Swapchain.GetSwapchainImages()) colorImageViews.emplace_back(swapchainImage.imageView);
+	}
 
-	m_Framebuffers.resize(swapchainImages.size());
+	m_Framebuffers.resize(colorImageViews.size());
 
-	// Create a framebuffer for each image in swapchain
-	for (uint16_t i = 0; i < swapchainImages.size(); ++i)
+	// Create a framebuffer for each image in swapchain (or offscreen image)
+	for (uint16_t i = 0; i < colorImageViews.size(); ++i)
 	{
 		std::array<VkImageView, 2> attachments =
 		{
-			swapchainImages[i].imageView,
+			colorImageViews[i],
 			m_DepthImage.imageView
 		};
 
-		VkFramebufferCreateInfo framebufferCreateInfo = Vki::FramebufferCreateInfo(m_Swapchain.GetSwapchainImageExtent());
+		VkFramebufferCreateInfo framebufferCreateInfo = Vki::FramebufferCreateInfo(GetRenderExtent());
 		framebufferCreateInfo.renderPass = m_RenderPass;										// RenderPass layout the Framebuffer will be used with
 		framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 		framebufferCreateInfo.pAttachments = attachments.data();								// List of attachments (1:1 with RenderPass)
@@ -645,27 +1407,75 @@ void VulkanRenderer::CreateFramebuffers()
 
 void VulkanRenderer::CreateCommandPool()
 {
+	// Used for one-off work outside the frame loop (e.g. frame read back)
 	VkCommandPoolCreateInfo commandPoolInfo = Vki::CommandPoolCreateInfo(m_MainDevice.queueFamilyIndices.graphicsFamily);
 
 	VkResult re = vkCreateCommandPool(m_MainDevice.device, &commandPoolInfo, nullptr, &m_GraphicsCommandPool);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create command pool\n");
 
 	m_MainDevice.queueFamilyIndices.commandPool = &m_GraphicsCommandPool;
+
+	// One transient pool per frame in flight, reset as a whole before the frame is recorded
+	m_FrameCommandPools.resize(MaxFrameDraws);
+
+	VkCommandPoolCreateInfo framePoolInfo = Vki::CommandPoolCreateInfo(m_MainDevice.queueFamilyIndices.graphicsFamily);
+	framePoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for (auto& frameCommandPool : m_FrameCommandPools)
+	{
+		re = vkCreateCommandPool(m_MainDevice.device, &framePoolInfo, nullptr, &frameCommandPool);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create frame command pool\n");
+	}
 }
 
 void VulkanRenderer::CreateCommandBuffers()
 {
-	const uint32_t bufferCount = static_cast<uint32_t>(m_Framebuffers.size());
-	m_CommandBuffers.resize(bufferCount);
+	m_CommandBuffers.resize(MaxFrameDraws);
+
+	for (uint32_t i = 0; i < MaxFrameDraws; ++i)
+	{
+		VkCommandBufferAllocateInfo bufferAllocateInfo = Vki::AllocateCommandBuffer(m_FrameCommandPools[i], 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+		VkResult re = vkAllocateCommandBuffers(m_MainDevice.device, &bufferAllocateInfo, &m_CommandBuffers[i]);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate command buffers\n");
+	}
+}
+
+void VulkanRenderer::CreateSecondaryCommandBuffers()
+{
+	if (m_Settings.recordThreadCount <= 1) return;
+
+	// The calling thread records a slice as well, so one fewer worker than slices
+	m_JobSystem = std::make_unique<JobSystem>(m_Settings.recordThreadCount - 1);
 
-	VkCommandBufferAllocateInfo bufferAllocateInfo = Vki::AllocateCommandBuffer(m_GraphicsCommandPool, bufferCount, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	m_SecondaryCommandPools.resize(MaxFrameDraws);
+	m_SecondaryCommandBuffers.resize(MaxFrameDraws);
 
-	VkResult re = vkAllocateCommandBuffers(m_MainDevice.device, &bufferAllocateInfo, m_CommandBuffers.data());
-	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate command buffers\n");
+	VkCommandPoolCreateInfo slicePoolInfo = Vki::CommandPoolCreateInfo(m_MainDevice.queueFamilyIndices.graphicsFamily);
+	slicePoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	// Command pools are externally synchronized, so every slice gets its own per frame
+	for (uint32_t frame = 0; frame < MaxFrameDraws; ++frame)
+	{
+		m_SecondaryCommandPools[frame].resize(m_Settings.recordThreadCount);
+		m_SecondaryCommandBuffers[frame].resize(m_Settings.recordThreadCount);
+
+		for (uint32_t slice = 0; slice < m_Settings.recordThreadCount; ++slice)
+		{
+			VkResult re = vkCreateCommandPool(m_MainDevice.device, &slicePoolInfo, nullptr, &m_SecondaryCommandPools[frame][slice]);
+			if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create secondary command pool\n");
+
+			VkCommandBufferAllocateInfo bufferAllocateInfo = Vki::AllocateCommandBuffer(m_SecondaryCommandPools[frame][slice], 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+			re = vkAllocateCommandBuffers(m_MainDevice.device, &bufferAllocateInfo, &m_SecondaryCommandBuffers[frame][slice]);
+			if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate secondary command buffer\n");
+		}
+	}
 }
 
 void VulkanRenderer::CreateSynchronization()
 {
+	m_FrameHasTimestamps.resize(MaxFrameDraws, false);
 	m_WaitForImageSph.resize(MaxFrameDraws);
 	m_WaitForRenderingSph.resize(MaxFrameDraws);
 	m_RenderCompleteFence.resize(MaxFrameDraws);
@@ -700,24 +1510,44 @@ void VulkanRenderer::CreateDescriptorPool()
 {
 	std::vector<VkDescriptorPoolSize> poolSizes = 
 	{
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 + 2 * MaxFrameDraws},
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 + 3 * MaxFrameDraws},
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * MaxFrameDraws},
 		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1},
-		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2},
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (1 + DepthPyramidMaxLevels) * MaxFrameDraws},
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DepthPyramidMaxLevels * MaxFrameDraws},
 	};
 
-	VkDescriptorPoolCreateInfo poolCreateInfo = Vki::DescriptorPoolCreateInfo(poolSizes, 3);
+	// Each frame in flight has its own culling set and one reduction set per depth pyramid level
+	VkDescriptorPoolCreateInfo poolCreateInfo = Vki::DescriptorPoolCreateInfo(poolSizes, 2 + (1 + DepthPyramidMaxLevels) * MaxFrameDraws);
 
 	auto re = vkCreateDescriptorPool(m_MainDevice.device, &poolCreateInfo, nullptr, &m_DescriptorPool);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description pool\n");
+
+	// The texture table is update-after-bind, which needs a pool of its own created with the matching flag
+	std::vector<VkDescriptorPoolSize> texturePoolSizes =
+	{
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_MainDevice.maxBindlessTextures},
+	};
+
+	VkDescriptorPoolCreateInfo texturePoolCreateInfo = Vki::DescriptorPoolCreateInfo(texturePoolSizes, 1);
+	texturePoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+
+	re = vkCreateDescriptorPool(m_MainDevice.device, &texturePoolCreateInfo, nullptr, &m_TextureDescriptorPool);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description pool\n");
 }
 
 void VulkanRenderer::CreateDescriptorLayout()
 {
 	m_DescriptorSetLayout.resize(3);
 
-	// Configure Uniform Buffer descriptor set layout
-	VkDescriptorSetLayoutBinding uboLayoutBinding = Vki::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
-	VkDescriptorSetLayoutCreateInfo uboSetLayoutCreateInfo = Vki::DescriptorSetLayoutCreateInfo(uboLayoutBinding, 1);
+	// Configure Uniform Buffer and instance buffer descriptor set layout (dynamic, the offsets select the frame's slices)
+	std::array<VkDescriptorSetLayoutBinding, 2> frameLayoutBindings =
+	{
+		Vki::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 1)
+	};
+	VkDescriptorSetLayoutCreateInfo uboSetLayoutCreateInfo = Vki::DescriptorSetLayoutCreateInfo(frameLayoutBindings[0], static_cast<uint32_t>(frameLayoutBindings.size()));
 
 	auto re = vkCreateDescriptorSetLayout(m_MainDevice.device, &uboSetLayoutCreateInfo, nullptr, &m_DescriptorSetLayout[0]);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description set layout\n");
@@ -729,12 +1559,58 @@ void VulkanRenderer::CreateDescriptorLayout()
 	re = vkCreateDescriptorSetLayout(m_MainDevice.device, &samplerSetLayoutCreateInfo, nullptr, &m_DescriptorSetLayout[1]);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description set layout\n");
 
-	// Configure Texture descriptor set layout
-	VkDescriptorSetLayoutBinding textureLayoutBinding = Vki::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
+	// Configure Texture descriptor set layout, a bindless table indexed by texture id. Slots are written as textures load,
+	// unwritten ones are never indexed and the set stays bound while they change
+	VkDescriptorSetLayoutBinding textureLayoutBinding = Vki::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT, m_MainDevice.maxBindlessTextures);
+
+	const VkDescriptorBindingFlags textureBindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+														 VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo textureBindingFlagsInfo{};
+	textureBindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	textureBindingFlagsInfo.bindingCount = 1;
+	textureBindingFlagsInfo.pBindingFlags = &textureBindingFlags;
+
 	VkDescriptorSetLayoutCreateInfo textureSetLayoutCreateInfo = Vki::DescriptorSetLayoutCreateInfo(textureLayoutBinding, 1);
+	textureSetLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	textureSetLayoutCreateInfo.pNext = &textureBindingFlagsInfo;
 
 	re = vkCreateDescriptorSetLayout(m_MainDevice.device, &textureSetLayoutCreateInfo, nullptr, &m_DescriptorSetLayout[2]);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description set layout\n");
+
+	if (!m_Settings.gpuCulling) return;
+
+	// Configure culling descriptor set layout (objects, mesh table, indirect commands and per-page counts,
+	// then occlusion state, stats, this and last frame's camera and the depth pyramid)
+	std::array<VkDescriptorSetLayoutBinding, 9> cullLayoutBindings =
+	{
+		Vki::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+	};
+	VkDescriptorSetLayoutCreateInfo cullSetLayoutCreateInfo = Vki::DescriptorSetLayoutCreateInfo(cullLayoutBindings[0], static_cast<uint32_t>(cullLayoutBindings.size()));
+
+	re = vkCreateDescriptorSetLayout(m_MainDevice.device, &cullSetLayoutCreateInfo, nullptr, &m_CullDescriptorSetLayout);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description set layout\n");
+
+	if (!m_Settings.occlusionCulling) return;
+
+	// Configure depth reduction descriptor set layout (source level and destination level)
+	std::array<VkDescriptorSetLayoutBinding, 2> reduceLayoutBindings =
+	{
+		Vki::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		Vki::DescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+	};
+	VkDescriptorSetLayoutCreateInfo reduceSetLayoutCreateInfo = Vki::DescriptorSetLayoutCreateInfo(reduceLayoutBindings[0], static_cast<uint32_t>(reduceLayoutBindings.size()));
+
+	re = vkCreateDescriptorSetLayout(m_MainDevice.device, &reduceSetLayoutCreateInfo, nullptr, &m_DepthReduceDescriptorSetLayout);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create description set layout\n");
 }
 
 void VulkanRenderer::AllocateDescriptorSets()
@@ -749,9 +1625,44 @@ void VulkanRenderer::AllocateDescriptorSets()
 	re = vkAllocateDescriptorSets(m_MainDevice.device, &samplerDescriptorSetAllocInfo, &m_GlobalDescriptorSet[1]);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate description set\n");
 
-	VkDescriptorSetAllocateInfo textureDescriptorSetAllocInfo = Vki::AllocateDescriptorSet(1, m_DescriptorPool, m_DescriptorSetLayout[2]);
+	// The texture table is allocated at the layout's full size, VulkanTexture fills its slots from here on
+	VkDescriptorSetVariableDescriptorCountAllocateInfo textureCountAllocInfo{};
+	textureCountAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	textureCountAllocInfo.descriptorSetCount = 1;
+	textureCountAllocInfo.pDescriptorCounts = &m_MainDevice.maxBindlessTextures;
+
+	VkDescriptorSetAllocateInfo textureDescriptorSetAllocInfo = Vki::AllocateDescriptorSet(1, m_TextureDescriptorPool, m_DescriptorSetLayout[2]);
+	textureDescriptorSetAllocInfo.pNext = &textureCountAllocInfo;
 	re = vkAllocateDescriptorSets(m_MainDevice.device, &textureDescriptorSetAllocInfo, &m_GlobalDescriptorSet[2]);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate description set\n");
+
+	VulkanTexture::SetDescriptorTable(m_GlobalDescriptorSet[2], m_MainDevice.maxBindlessTextures);
+
+	if (!m_Settings.gpuCulling) return;
+
+	// The pyramid is replaced on resize while earlier frames may still be reading the old one, so every frame
+	// in flight gets its own sets and each is repointed once its fence has signalled
+	m_CullDescriptorSets.resize(MaxFrameDraws);
+	m_DepthPyramidDescriptorsStale.assign(MaxFrameDraws, true);
+
+	for (auto& cullDescriptorSet : m_CullDescriptorSets)
+	{
+		VkDescriptorSetAllocateInfo cullDescriptorSetAllocInfo = Vki::AllocateDescriptorSet(1, m_DescriptorPool, m_CullDescriptorSetLayout);
+		re = vkAllocateDescriptorSets(m_MainDevice.device, &cullDescriptorSetAllocInfo, &cullDescriptorSet);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate description set\n");
+	}
+
+	if (!m_Settings.occlusionCulling) return;
+
+	// Enough for the largest pyramid, resizes rewrite the sets rather than reallocate them
+	m_DepthReduceDescriptorSets.resize(MaxFrameDraws * DepthPyramidMaxLevels);
+
+	for (auto& reduceDescriptorSet : m_DepthReduceDescriptorSets)
+	{
+		VkDescriptorSetAllocateInfo reduceDescriptorSetAllocInfo = Vki::AllocateDescriptorSet(1, m_DescriptorPool, m_DepthReduceDescriptorSetLayout);
+		re = vkAllocateDescriptorSets(m_MainDevice.device, &reduceDescriptorSetAllocInfo, &reduceDescriptorSet);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate description set\n");
+	}
 }
 
 void VulkanRenderer::WriteDescriptors()
@@ -763,21 +1674,16 @@ void VulkanRenderer::WriteDescriptors()
 	descriptorBufferInfo.offset = 0;
 	descriptorBufferInfo.range = sizeof(CameraTransform);
 
+	VkDescriptorBufferInfo instanceBufferInfo{};
+	instanceBufferInfo.buffer = m_InstanceBuffer.buffer;
+	instanceBufferInfo.offset = 0;
+	instanceBufferInfo.range = sizeof(ObjectData) * m_InstanceCapacity;
+
 	VkDescriptorImageInfo samplerInfo{};
 	samplerInfo.sampler = m_Sampler;
 
-	std::vector<VkDescriptorImageInfo> texturesInfo{};
-	texturesInfo.resize(VulkanTexture::GetTextureDatabase().size());
-
-	for (uint8_t i = 0; i < texturesInfo.size(); ++i)
-	{
-		texturesInfo[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		texturesInfo[i].imageView = m_GameObjects[i].GetTextureData().imageView;
-		texturesInfo[i].sampler = nullptr;
-	}
-
 	descriptorWriter[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWriter[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorWriter[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	descriptorWriter[0].dstSet = m_GlobalDescriptorSet[0];
 	descriptorWriter[0].dstBinding = 0;
 	descriptorWriter[0].dstArrayElement = 0;
@@ -785,22 +1691,125 @@ void VulkanRenderer::WriteDescriptors()
 	descriptorWriter[0].pBufferInfo = &descriptorBufferInfo;
 
 	descriptorWriter[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWriter[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-	descriptorWriter[1].dstSet = m_GlobalDescriptorSet[1];
-	descriptorWriter[1].dstBinding = 0;
+	descriptorWriter[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	descriptorWriter[1].dstSet = m_GlobalDescriptorSet[0];
+	descriptorWriter[1].dstBinding = 1;
 	descriptorWriter[1].dstArrayElement = 0;
 	descriptorWriter[1].descriptorCount = 1;
-	descriptorWriter[1].pImageInfo = &samplerInfo;
+	descriptorWriter[1].pBufferInfo = &instanceBufferInfo;
 
 	descriptorWriter[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWriter[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-	descriptorWriter[2].dstSet = m_GlobalDescriptorSet[2];
+	descriptorWriter[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	descriptorWriter[2].dstSet = m_GlobalDescriptorSet[1];
 	descriptorWriter[2].dstBinding = 0;
 	descriptorWriter[2].dstArrayElement = 0;
-	descriptorWriter[2].descriptorCount = static_cast<uint32_t>(texturesInfo.size());
-	descriptorWriter[2].pImageInfo = texturesInfo.data();
+	descriptorWriter[2].descriptorCount = 1;
+	descriptorWriter[2].pImageInfo = &samplerInfo;
+
+	// The texture table isn't written here, VulkanTexture writes each slot as its texture loads
+	vkUpdateDescriptorSets(m_MainDevice.device, static_cast<uint32_t>(descriptorWriter.size()), descriptorWriter.data(), 0, nullptr);
+
+	if (!m_Settings.gpuCulling) return;
+
+	// Dynamic bindings cover one frame's slice (one phase's for commands and counts), the offsets are selected when the culling pass is recorded
+	std::array<VkDescriptorBufferInfo, 8> cullBufferInfos{};
+	cullBufferInfos[0] = { m_InstanceBuffer.buffer, 0, sizeof(ObjectData) * m_InstanceCapacity };
+	cullBufferInfos[1] = { m_MeshTableBuffer.buffer, 0, sizeof(GpuMesh) * m_MeshTableCapacity };
+	cullBufferInfos[2] = { m_DrawCommandBuffer.buffer, 0, sizeof(VkDrawIndexedIndirectCommand) * m_InstanceCapacity * m_CullPageCount };
+	cullBufferInfos[3] = { m_DrawCountBuffer.buffer, 0, sizeof(uint32_t) * m_CullPageCount };
+	cullBufferInfos[4] = { m_OcclusionStateBuffer.buffer, 0, sizeof(uint32_t) * m_InstanceCapacity };
+	cullBufferInfos[5] = { m_CullStatsBuffer.buffer, 0, sizeof(CullStats) * MaxFrameDraws };
+	cullBufferInfos[6] = { m_Camera.GetUniformBuffer().buffer, 0, sizeof(CameraTransform) };
+	cullBufferInfos[7] = { m_Camera.GetUniformBuffer().buffer, 0, sizeof(CameraTransform) };
+
+	const std::array<VkDescriptorType, 8> cullDescriptorTypes =
+	{
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+	};
+
+	// Callers have waited for the device, so every frame's set can be written, the pyramid included
+	std::vector<VkWriteDescriptorSet> cullDescriptorWriter(cullBufferInfos.size() * MaxFrameDraws);
+
+	for (uint32_t i = 0; i < cullDescriptorWriter.size(); ++i)
+	{
+		const uint32_t binding = static_cast<uint32_t>(i % cullBufferInfos.size());
+
+		cullDescriptorWriter[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		cullDescriptorWriter[i].descriptorType = cullDescriptorTypes[binding];
+		cullDescriptorWriter[i].dstSet = m_CullDescriptorSets[i / cullBufferInfos.size()];
+		cullDescriptorWriter[i].dstBinding = binding;
+		cullDescriptorWriter[i].dstArrayElement = 0;
+		cullDescriptorWriter[i].descriptorCount = 1;
+		cullDescriptorWriter[i].pBufferInfo = &cullBufferInfos[binding];
+	}
+
+	vkUpdateDescriptorSets(m_MainDevice.device, static_cast<uint32_t>(cullDescriptorWriter.size()), cullDescriptorWriter.data(), 0, nullptr);
+
+	for (uint32_t frame = 0; frame < MaxFrameDraws; ++frame)
+	{
+		WriteDepthPyramidDescriptors(frame);
+	}
+}
+
+void VulkanRenderer::WriteDepthPyramidDescriptors(const uint32_t _frameIndex)
+{
+	// The pyramid stays in the general layout, the reduction writes it and culling samples it
+	VkDescriptorImageInfo depthPyramidInfo{};
+	depthPyramidInfo.sampler = m_DepthPyramidSampler;
+	depthPyramidInfo.imageView = m_DepthPyramid.imageView;
+	depthPyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	// Each level reads the one above it, the first reads the depth buffer the early pass left read only
+	const uint32_t reduceLevelCount = m_Settings.occlusionCulling ? m_DepthPyramidLevelCount : 0;
+	std::vector<VkDescriptorImageInfo> sourceInfos(reduceLevelCount);
+	std::vector<VkDescriptorImageInfo> destinationInfos(reduceLevelCount);
+	std::vector<VkWriteDescriptorSet> descriptorWriter(1 + reduceLevelCount * 2);
+
+	VkWriteDescriptorSet& pyramidWrite = descriptorWriter[0];
+	pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidWrite.dstSet = m_CullDescriptorSets[_frameIndex];
+	pyramidWrite.dstBinding = 8;
+	pyramidWrite.descriptorCount = 1;
+	pyramidWrite.pImageInfo = &depthPyramidInfo;
+
+	for (uint32_t level = 0; level < reduceLevelCount; ++level)
+	{
+		const VkDescriptorSet reduceDescriptorSet = m_DepthReduceDescriptorSets[_frameIndex * DepthPyramidMaxLevels + level];
+
+		sourceInfos[level].sampler = m_DepthPyramidSampler;
+		sourceInfos[level].imageView = level == 0 ? m_DepthImage.imageView : m_DepthPyramidLevelViews[level - 1];
+		sourceInfos[level].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		destinationInfos[level].imageView = m_DepthPyramidLevelViews[level];
+		destinationInfos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet& sourceWrite = descriptorWriter[1 + level * 2];
+		sourceWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		sourceWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		sourceWrite.dstSet = reduceDescriptorSet;
+		sourceWrite.dstBinding = 0;
+		sourceWrite.descriptorCount = 1;
+		sourceWrite.pImageInfo = &sourceInfos[level];
+
+		VkWriteDescriptorSet& destinationWrite = descriptorWriter[2 + level * 2];
+		destinationWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		destinationWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		destinationWrite.dstSet = reduceDescriptorSet;
+		destinationWrite.dstBinding = 1;
+		destinationWrite.descriptorCount = 1;
+		destinationWrite.pImageInfo = &destinationInfos[level];
+	}
 
 	vkUpdateDescriptorSets(m_MainDevice.device, static_cast<uint32_t>(descriptorWriter.size()), descriptorWriter.data(), 0, nullptr);
+	m_DepthPyramidDescriptorsStale[_frameIndex] = false;
 }
 
 void VulkanRenderer::CreateTextureSampler()
@@ -819,10 +1828,308 @@ void VulkanRenderer::CreateTextureSampler()
 		samplerCreateInfo = Vki::SamplerCreateInfo(VK_FALSE);
 	}
 
+	// Every level of a texture's chain is used, however many it has
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+
 	VkResult re = vkCreateSampler(m_MainDevice.device, &samplerCreateInfo, nullptr, &m_Sampler);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create sampler\n");
 }
 
+void VulkanRenderer::CreateTimestampQueries()
+{
+	// GPU frame timings are optional, skip them on devices that can't timestamp graphics work
+	if (!m_MainDevice.physicalDeviceProperties.limits.timestampComputeAndGraphics) return;
+
+	// A begin and end timestamp for every command buffer
+	VkQueryPoolCreateInfo queryPoolCreateInfo{};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = static_cast<uint32_t>(m_CommandBuffers.size()) * 2;
+
+	VkResult re = vkCreateQueryPool(m_MainDevice.device, &queryPoolCreateInfo, nullptr, &m_TimestampQueryPool);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create timestamp query pool\n");
+}
+
+void VulkanRenderer::CreateCullPipeline()
+{
+	if (!m_Settings.gpuCulling) return;
+
+	const auto computeShaderCode = Utilities::ReadBinaryFile("src/Shaders/cull.spv");
+	VkShaderModule computeShaderModule = VulkanUtilities::CreateShaderModule(computeShaderCode);
+
+	VkPushConstantRange cullPushConstants = Vki::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants));
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = Vki::LayoutCreateInfo();
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &cullPushConstants;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &m_CullDescriptorSetLayout;
+
+	VkResult re = vkCreatePipelineLayout(m_MainDevice.device, &layoutCreateInfo, nullptr, &m_CullPipelineLayout);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create pipeline layout\n");
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo{};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.stage = Vki::ShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, computeShaderModule);
+	computePipelineCreateInfo.layout = m_CullPipelineLayout;
+
+	re = vkCreateComputePipelines(m_MainDevice.device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &m_CullPipeline);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create culling pipeline\n");
+
+	vkDestroyShaderModule(m_MainDevice.device, computeShaderModule, nullptr);
+}
+
+void VulkanRenderer::UpdateCullBuffers()
+{
+	if (!m_Settings.gpuCulling) return;
+
+	// Only called while the device is idle, so buffers can be replaced before the descriptors are rewritten
+	const uint32_t meshSlotCount = std::max(1u, VulkanMeshRegistry::GetMeshSlotCount());
+	const uint32_t pageCount = std::max(1u, VulkanMeshRegistry::GetPageCount());
+	const bool needsMeshTable = meshSlotCount > m_MeshTableCapacity;
+	const bool needsDrawBuffers = pageCount != m_CullPageCount || sizeof(VkDrawIndexedIndirectCommand) * m_InstanceCapacity * pageCount > m_DrawCommandPhaseStride;
+	const VkDeviceSize phaseCount = m_Settings.occlusionCulling ? 2 : 1;
+
+	if (needsMeshTable)
+	{
+		VulkanUtilities::DestroyBuffer(m_MeshTableBuffer.buffer, m_MeshTableBuffer.bufferMemory);
+		m_MeshTableCapacity = meshSlotCount;
+
+		BufferInfo meshTableInfo{};
+		meshTableInfo.pBuffer = &m_MeshTableBuffer.buffer;
+		meshTableInfo.pBufferMemory = &m_MeshTableBuffer.bufferMemory;
+		meshTableInfo.bufferSize = sizeof(GpuMesh) * m_MeshTableCapacity;
+		meshTableInfo.bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		meshTableInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		VulkanUtilities::CreateBuffer(meshTableInfo);
+	}
+
+	if (needsDrawBuffers)
+	{
+		VulkanUtilities::DestroyBuffer(m_DrawCommandBuffer.buffer, m_DrawCommandBuffer.bufferMemory);
+		VulkanUtilities::DestroyBuffer(m_DrawCountBuffer.buffer, m_DrawCountBuffer.bufferMemory);
+		m_CullPageCount = pageCount;
+
+		// Every page gets room for the whole scene so the compute pass never has to know how objects spread over pages.
+		// One slice per frame in flight, the culling pass rewrites its frame's slice every frame. Occlusion culling
+		// splits each slice in two so the late phase's draws don't overwrite the early phase's
+		m_DrawCommandPhaseStride = VulkanUtilities::PadStorageBufferSize(sizeof(VkDrawIndexedIndirectCommand) * m_InstanceCapacity * m_CullPageCount);
+		m_DrawCountPhaseStride = VulkanUtilities::PadStorageBufferSize(sizeof(uint32_t) * m_CullPageCount);
+		m_DrawCommandStride = m_DrawCommandPhaseStride * phaseCount;
+		m_DrawCountStride = m_DrawCountPhaseStride * phaseCount;
+
+		BufferInfo drawCommandInfo{};
+		drawCommandInfo.pBuffer = &m_DrawCommandBuffer.buffer;
+		drawCommandInfo.pBufferMemory = &m_DrawCommandBuffer.bufferMemory;
+		drawCommandInfo.bufferSize = m_DrawCommandStride * MaxFrameDraws;
+		drawCommandInfo.bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		drawCommandInfo.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		VulkanUtilities::CreateBuffer(drawCommandInfo);
+
+		BufferInfo drawCountInfo{};
+		drawCountInfo.pBuffer = &m_DrawCountBuffer.buffer;
+		drawCountInfo.pBufferMemory = &m_DrawCountBuffer.bufferMemory;
+		drawCountInfo.bufferSize = m_DrawCountStride * MaxFrameDraws;
+		drawCountInfo.bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		drawCountInfo.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		VulkanUtilities::CreateBuffer(drawCountInfo);
+
+		// Only touched by the compute pass, the early phase writes every object's flag before the late phase reads it
+		VulkanUtilities::DestroyBuffer(m_OcclusionStateBuffer.buffer, m_OcclusionStateBuffer.bufferMemory);
+
+		BufferInfo occlusionStateInfo{};
+		occlusionStateInfo.pBuffer = &m_OcclusionStateBuffer.buffer;
+		occlusionStateInfo.pBufferMemory = &m_OcclusionStateBuffer.bufferMemory;
+		occlusionStateInfo.bufferSize = sizeof(uint32_t) * m_InstanceCapacity;
+		occlusionStateInfo.bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		occlusionStateInfo.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		VulkanUtilities::CreateBuffer(occlusionStateInfo);
+	}
+
+	if (!m_pCullStats)
+	{
+		BufferInfo cullStatsInfo{};
+		cullStatsInfo.pBuffer = &m_CullStatsBuffer.buffer;
+		cullStatsInfo.pBufferMemory = &m_CullStatsBuffer.bufferMemory;
+		cullStatsInfo.bufferSize = sizeof(CullStats) * MaxFrameDraws;
+		cullStatsInfo.bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		cullStatsInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		VulkanUtilities::CreateBuffer(cullStatsInfo);
+
+		// Frames that haven't been submitted yet read back as nothing culled
+		void* pStats = nullptr;
+		VulkanUtilities::MapMemory(m_CullStatsBuffer.bufferMemory, &pStats);
+		m_pCullStats = static_cast<CullStats*>(pStats);
+		std::fill(m_pCullStats, m_pCullStats + MaxFrameDraws, CullStats{});
+	}
+
+	// Mesh table mirrors the registry, released slots are left zeroed and never referenced by live objects
+	void* pData = nullptr;
+	VulkanUtilities::MapMemory(m_MeshTableBuffer.bufferMemory, &pData);
+	GpuMesh* pMeshes = static_cast<GpuMesh*>(pData);
+
+	for (uint32_t meshId = 0; meshId < VulkanMeshRegistry::GetMeshSlotCount(); ++meshId)
+	{
+		const Mesh& mesh = VulkanMeshRegistry::GetMesh(meshId);
+
+		GpuMesh gpuMesh{};
+		gpuMesh.indexCount = mesh.indexCount;
+		gpuMesh.firstIndex = mesh.firstIndex;
+		gpuMesh.vertexOffset = static_cast<int32_t>(mesh.vertexOffset);
+		gpuMesh.pageIndex = mesh.pageIndex;
+		gpuMesh.boundingSphere = VulkanMeshRegistry::GetStoredBoundingSphere(mesh);		// Instances carry the decode in their model matrix
+		gpuMesh.commandBase = mesh.pageIndex * m_InstanceCapacity;
+		pMeshes[meshId] = gpuMesh;
+	}
+
+	// Every object's data must be rewritten into each frame's slice
+	const uint32_t objectCount = m_Scene.GetObjectCount();
+	m_ObjectDirtyFrames.assign(objectCount, (1 << MaxFrameDraws) - 1);
+
+	// Entities without a mesh are never written by UpdateObjectBuffer, this is what tells the culling pass to skip them
+	for (uint32_t frame = 0; frame < MaxFrameDraws; ++frame)
+	{
+		ObjectData* pInstances = reinterpret_cast<ObjectData*>(m_pInstanceData + m_InstanceStride * frame);
+		for (uint32_t i = 0; i < objectCount; ++i) pInstances[i].meshId = InvalidMeshId;
+	}
+}
+
+void VulkanRenderer::DestroyCullBuffers()
+{
+	if (!m_Settings.gpuCulling) return;
+
+	VulkanUtilities::DestroyBuffer(m_MeshTableBuffer.buffer, m_MeshTableBuffer.bufferMemory);
+	VulkanUtilities::DestroyBuffer(m_DrawCommandBuffer.buffer, m_DrawCommandBuffer.bufferMemory);
+	VulkanUtilities::DestroyBuffer(m_DrawCountBuffer.buffer, m_DrawCountBuffer.bufferMemory);
+	VulkanUtilities::DestroyBuffer(m_OcclusionStateBuffer.buffer, m_OcclusionStateBuffer.bufferMemory);
+	VulkanUtilities::DestroyBuffer(m_CullStatsBuffer.buffer, m_CullStatsBuffer.bufferMemory);
+	m_pCullStats = nullptr;
+}
+
+void VulkanRenderer::CreateDepthPyramid()
+{
+	if (!m_Settings.gpuCulling) return;
+
+	// The culling pass always binds a pyramid, without occlusion culling a single texel stands in and is never tested
+	m_DepthPyramidExtent = { 1, 1 };
+	m_DepthPyramidLevelCount = 1;
+
+	if (m_Settings.occlusionCulling)
+	{
+		// Largest power of two that fits the render extent, so every level below the first halves exactly
+		const VkExtent2D renderExtent = GetRenderExtent();
+		while (m_DepthPyramidExtent.width * 2 <= renderExtent.width) m_DepthPyramidExtent.width *= 2;
+		while (m_DepthPyramidExtent.height * 2 <= renderExtent.height) m_DepthPyramidExtent.height *= 2;
+
+		// Down to a single texel
+		while ((std::max(m_DepthPyramidExtent.width, m_DepthPyramidExtent.height) >> m_DepthPyramidLevelCount) > 0) ++m_DepthPyramidLevelCount;
+		m_DepthPyramidLevelCount = std::min<uint32_t>(m_DepthPyramidLevelCount, DepthPyramidMaxLevels);
+	}
+
+	m_DepthPyramid = VulkanUtilities::CreateImage(m_DepthPyramidExtent, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DepthPyramidLevelCount);
+
+	VkImageViewCreateInfo imageViewCreateInfo = Vki::ImageViewCreateInfo(m_DepthPyramid.image, m_DepthPyramid.imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	imageViewCreateInfo.subresourceRange.levelCount = m_DepthPyramidLevelCount;
+
+	VkResult re = vkCreateImageView(m_MainDevice.device, &imageViewCreateInfo, nullptr, &m_DepthPyramid.imageView);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create an image view\n");
+
+	m_DepthPyramidLevelViews.resize(m_DepthPyramidLevelCount);
+
+	for (uint32_t level = 0; level < m_DepthPyramidLevelCount; ++level)
+	{
+		imageViewCreateInfo.subresourceRange.baseMipLevel = level;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+
+		re = vkCreateImageView(m_MainDevice.device, &imageViewCreateInfo, nullptr, &m_DepthPyramidLevelViews[level]);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create an image view\n");
+	}
+
+	if (!m_DepthPyramidSampler)
+	{
+		// Only read through texelFetch, the sampler just has to exist
+		VkSamplerCreateInfo samplerCreateInfo = Vki::SamplerCreateInfo(VK_FALSE);
+		samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+		samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		re = vkCreateSampler(m_MainDevice.device, &samplerCreateInfo, nullptr, &m_DepthPyramidSampler);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create sampler\n");
+	}
+
+	// The new image is moved to the general layout when the next frame is recorded, and each frame's sets are
+	// pointed at it before that frame is next recorded
+	m_DepthPyramidValid = false;
+	std::fill(m_DepthPyramidDescriptorsStale.begin(), m_DepthPyramidDescriptorsStale.end(), true);
+}
+
+void VulkanRenderer::DestroyDepthPyramid()
+{
+	if (!m_DepthPyramid.image) return;
+
+	for (const auto& levelView : m_DepthPyramidLevelViews)
+	{
+		VulkanUtilities::DestroyImageView(levelView);
+	}
+
+	m_DepthPyramidLevelViews.clear();
+	VulkanUtilities::DestroyImageView(m_DepthPyramid.imageView);
+	VulkanUtilities::DestroyImage(m_DepthPyramid.image, m_DepthPyramid.imageMemory);
+	m_DepthPyramid = {};
+}
+
+void VulkanRenderer::CreateDepthReducePipeline()
+{
+	if (!m_Settings.occlusionCulling) return;
+
+	const auto computeShaderCode = Utilities::ReadBinaryFile("src/Shaders/depthReduce.spv");
+	VkShaderModule computeShaderModule = VulkanUtilities::CreateShaderModule(computeShaderCode);
+
+	VkPushConstantRange reducePushConstants = Vki::PushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthReduceConstants));
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = Vki::LayoutCreateInfo();
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &reducePushConstants;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &m_DepthReduceDescriptorSetLayout;
+
+	VkResult re = vkCreatePipelineLayout(m_MainDevice.device, &layoutCreateInfo, nullptr, &m_DepthReducePipelineLayout);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create pipeline layout\n");
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo{};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.stage = Vki::ShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, computeShaderModule);
+	computePipelineCreateInfo.layout = m_DepthReducePipelineLayout;
+
+	re = vkCreateComputePipelines(m_MainDevice.device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &m_DepthReducePipeline);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create depth reduction pipeline\n");
+
+	vkDestroyShaderModule(m_MainDevice.device, computeShaderModule, nullptr);
+}
+
+void VulkanRenderer::CreateInstanceBuffer(const uint32_t _instanceCapacity)
+{
+	// One slice per frame in flight so the CPU never writes instances a previous frame is still reading
+	m_InstanceCapacity = _instanceCapacity;
+	m_InstanceStride = VulkanUtilities::PadStorageBufferSize(sizeof(ObjectData) * _instanceCapacity);
+
+	BufferInfo bufferInfo{};
+	bufferInfo.bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.bufferSize = m_InstanceStride * MaxFrameDraws;
+	bufferInfo.pBuffer = &m_InstanceBuffer.buffer;
+	bufferInfo.pBufferMemory = &m_InstanceBuffer.bufferMemory;
+	bufferInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VulkanUtilities::CreateBuffer(bufferInfo);
+
+	void* pData = nullptr;
+	VulkanUtilities::MapMemory(m_InstanceBuffer.bufferMemory, &pData);
+	m_pInstanceData = static_cast<uint8_t*>(pData);
+}
+
 void VulkanRenderer::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& _debugUtilsCreateInfo)
 {
 	_debugUtilsCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -833,16 +2140,20 @@ void VulkanRenderer::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreat
 	_debugUtilsCreateInfo.pUserData = nullptr;
 }
 
-void VulkanRenderer::RecordCommands()
+void VulkanRenderer::RecordCommands(const uint32_t _frameIndex, const uint32_t _imageIndex)
 {
+	VkCommandBuffer commandBuffer = m_CommandBuffers[_frameIndex];
+
 	VkCommandBufferBeginInfo bufferBeginInfo{};
 	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 	VkRenderPassBeginInfo renderPassBeginInfo{};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassBeginInfo.renderPass = m_RenderPass;												// Render Pass to begin
 	renderPassBeginInfo.renderArea.offset = { 0, 0 };											// Start point of render pass in pixels
-	renderPassBeginInfo.renderArea.extent = m_Swapchain.GetSwapchainImageExtent();				// Size of region to run render pass on (starting at offset)
+	renderPassBeginInfo.renderArea.extent = GetRenderExtent();									// Size of region to run render pass on (starting at offset)
+	renderPassBeginInfo.framebuffer = m_Framebuffers[_imageIndex];
 
 	std::array<VkClearValue, 2> clearValues{};
 	clearValues[0].color = { 0.1f, 0.1f, 0.45f, 1.0f };
@@ -851,61 +2162,340 @@ void VulkanRenderer::RecordCommands()
 	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());		// Number of clear values
 	renderPassBeginInfo.pClearValues = clearValues.data();									// List of clear values
 
-	m_Camera.SetView(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, -1.0f));
-	m_Camera.SetProjection(glm::radians(60.0f), (float)m_Swapchain.GetSwapchainImageExtent().width / m_Swapchain.GetSwapchainImageExtent().height, 0.1f, 100.0f);
+	vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+
+	if (m_TimestampQueryPool)
+	{
+		vkCmdResetQueryPool(commandBuffer, m_TimestampQueryPool, _frameIndex * 2, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_TimestampQueryPool, _frameIndex * 2);
+	}
+
+	// This frame's fence has signalled, so its sets are no longer in use and can follow a replaced pyramid
+	if (m_Settings.gpuCulling && m_DepthPyramidDescriptorsStale[_frameIndex]) WriteDepthPyramidDescriptors(_frameIndex);
+
+	// New pyramids start out undefined, culling reads them in the general layout from their first frame
+	if (m_Settings.gpuCulling && !m_DepthPyramidValid)
+	{
+		VkImageMemoryBarrier pyramidBarrier{};
+		pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.image = m_DepthPyramid.image;
+		pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_DepthPyramidLevelCount, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &pyramidBarrier);
+
+		// Without occlusion culling there is nothing to build, the stand-in only needed its layout
+		if (!m_Settings.occlusionCulling) m_DepthPyramidValid = true;
+	}
+
+	if (m_Settings.occlusionCulling)
+	{
+		// Early phase draws what last frame's pyramid doesn't hide, the pyramid is rebuilt from that depth
+		// and the late phase draws whatever the early phase rejected but is visible after all
+		RecordCulling(commandBuffer, _frameIndex, CullPhase::Early);
+		renderPassBeginInfo.renderPass = m_EarlyRenderPass;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		RecordIndirectDraws(commandBuffer, _frameIndex, CullPhase::Early);
+		vkCmdEndRenderPass(commandBuffer);
+
+		RecordDepthPyramid(commandBuffer, _frameIndex);
+		RecordCulling(commandBuffer, _frameIndex, CullPhase::Late);
+
+		// Loads both attachments, the clear values go unused
+		renderPassBeginInfo.renderPass = m_LateRenderPass;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		RecordIndirectDraws(commandBuffer, _frameIndex, CullPhase::Late);
+	}
+	else if (m_Settings.gpuCulling)
+	{
+		// Culling runs before the render pass, it fills this frame's indirect commands for RecordIndirectDraws
+		RecordCulling(commandBuffer, _frameIndex, CullPhase::Single);
+
+		// A handful of indirect draws, nothing worth spreading over threads
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		RecordIndirectDraws(commandBuffer, _frameIndex, CullPhase::Single);
+	}
+	else if (m_JobSystem)
+	{
+		// Draws are split into contiguous slices, each recorded into its own secondary command buffer on a worker
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		m_JobSystem->ParallelFor(m_Settings.recordThreadCount, [this, _frameIndex, _imageIndex](const uint32_t _slice)
+		{
+			RecordDrawSlice(_frameIndex, _imageIndex, _slice);
+		});
+
+		const std::vector<VkCommandBuffer>& secondaryBuffers = m_SecondaryCommandBuffers[_frameIndex];
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+	}
+	else
+	{
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		RecordDraws(commandBuffer, _frameIndex, 0, m_DrawGroups.size());
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (m_Settings.gpuCulling)
+	{
+		// Stats are read on the host once the frame's fence has signalled
+		VkMemoryBarrier statsBarrier{};
+		statsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &statsBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (m_TimestampQueryPool)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_TimestampQueryPool, _frameIndex * 2 + 1);
+	}
+
+	vkEndCommandBuffer(commandBuffer);
+}
+
+void VulkanRenderer::RecordDrawSlice(const uint32_t _frameIndex, const uint32_t _imageIndex, const uint32_t _slice)
+{
+	vkResetCommandPool(m_MainDevice.device, m_SecondaryCommandPools[_frameIndex][_slice], 0);
+
+	VkCommandBuffer commandBuffer = m_SecondaryCommandBuffers[_frameIndex][_slice];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_RenderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = m_Framebuffers[_imageIndex];
+
+	VkCommandBufferBeginInfo bufferBeginInfo{};
+	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	bufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+
+	// Even split of the draw groups, the last slices may be empty for scenes with few distinct meshes
+	const size_t sliceCount = m_Settings.recordThreadCount;
+	const size_t groupsPerSlice = (m_DrawGroups.size() + sliceCount - 1) / sliceCount;
+	const size_t firstGroup = std::min(m_DrawGroups.size(), groupsPerSlice * _slice);
+	const size_t lastGroup = std::min(m_DrawGroups.size(), firstGroup + groupsPerSlice);
 
-	for (uint16_t i = 0; i < m_CommandBuffers.size(); ++i)
+	RecordDraws(commandBuffer, _frameIndex, firstGroup, lastGroup);
+
+	vkEndCommandBuffer(commandBuffer);
+}
+
+void VulkanRenderer::RecordCulling(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex, const CullPhase _phase)
+{
+	const bool latePhase = _phase == CullPhase::Late;
+	const VkDeviceSize commandOffset = m_DrawCommandStride * _frameIndex + (latePhase ? m_DrawCommandPhaseStride : 0);
+	const VkDeviceSize countOffset = m_DrawCountStride * _frameIndex + (latePhase ? m_DrawCountPhaseStride : 0);
+
+	// Counts restart at zero. Without draw count support the whole command range is drawn, so unused commands must be empty
+	vkCmdFillBuffer(_commandBuffer, m_DrawCountBuffer.buffer, countOffset, sizeof(uint32_t) * m_CullPageCount, 0);
+
+	if (!m_MainDevice.drawIndirectCount)
 	{
-		renderPassBeginInfo.framebuffer = m_Framebuffers[i];
+		vkCmdFillBuffer(_commandBuffer, m_DrawCommandBuffer.buffer, commandOffset, sizeof(VkDrawIndexedIndirectCommand) * m_InstanceCapacity * m_CullPageCount, 0);
+	}
 
-		vkBeginCommandBuffer(m_CommandBuffers[i], &bufferBeginInfo);
-		vkCmdBeginRenderPass(m_CommandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Stats accumulate over both phases of the frame
+	if (!latePhase) vkCmdFillBuffer(_commandBuffer, m_CullStatsBuffer.buffer, sizeof(CullStats) * _frameIndex, sizeof(CullStats), 0);
+
+	// Also orders this dispatch after the previous one, the occlusion state is shared by every frame in flight
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	CullConstants cullConstants{};
+	const std::array<glm::vec4, 6> frustumPlanes = m_Camera.GetFrustumPlanes();
+	std::copy(frustumPlanes.begin(), frustumPlanes.end(), cullConstants.frustumPlanes);
+	cullConstants.objectCount = m_Scene.GetObjectCount();
+	cullConstants.phase = _phase;
+	cullConstants.previousPyramidValid = m_DepthPyramidValid ? 1 : 0;
+	cullConstants.statsOffset = _frameIndex * (sizeof(CullStats) / sizeof(uint32_t));
+	cullConstants.pyramidSize = glm::vec2(m_DepthPyramidExtent.width, m_DepthPyramidExtent.height);
+
+	// Dynamic offsets are consumed in binding order, objects, commands, counts, then this and the previous frame's camera.
+	// The previous camera is this frame's own copy, the previous frame's slot can be rewritten while this one is in flight
+	const uint32_t cullOffsets[] =
+	{
+		static_cast<uint32_t>(m_InstanceStride * _frameIndex),
+		static_cast<uint32_t>(commandOffset),
+		static_cast<uint32_t>(countOffset),
+		m_Camera.GetUniformOffset(_frameIndex),
+		m_Camera.GetPreviousUniformOffset(_frameIndex)
+	};
 
-		vkCmdBindPipeline(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayout, 0, 1, &m_CullDescriptorSets[_frameIndex], 5, cullOffsets);
+	vkCmdPushConstants(_commandBuffer, m_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &cullConstants);
+	vkCmdDispatch(_commandBuffer, (cullConstants.objectCount + 63) / 64, 1, 1);
 
-		vkCmdBindDescriptorSets(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_GlobalDescriptorSet[0], 0, nullptr);
-		vkCmdBindDescriptorSets(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &m_GlobalDescriptorSet[1], 0, nullptr);
-		vkCmdBindDescriptorSets(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 2, 1, &m_GlobalDescriptorSet[2], 0, nullptr);
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
 
-		for (auto& gameObject : m_GameObjects)
+void VulkanRenderer::RecordIndirectDraws(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex, const CullPhase _phase)
+{
+	const bool latePhase = _phase == CullPhase::Late;
+
+	BindDrawState(_commandBuffer, _frameIndex);
+
+	const uint32_t maxDrawCount = std::min(m_InstanceCapacity, m_MainDevice.physicalDeviceProperties.limits.maxDrawIndirectCount);
+	const uint32_t commandStride = sizeof(VkDrawIndexedIndirectCommand);
+
+	// One indirect draw per geometry page, each page's commands start at page * capacity
+	for (uint32_t page = 0; page < VulkanMeshRegistry::GetPageCount(); ++page)
+	{
+		VulkanMeshRegistry::BindPage(_commandBuffer, page);
+
+		const VkDeviceSize commandOffset = m_DrawCommandStride * _frameIndex + (latePhase ? m_DrawCommandPhaseStride : 0) + static_cast<VkDeviceSize>(commandStride) * m_InstanceCapacity * page;
+
+		if (m_MainDevice.drawIndirectCount)
+		{
+			const VkDeviceSize countOffset = m_DrawCountStride * _frameIndex + (latePhase ? m_DrawCountPhaseStride : 0) + sizeof(uint32_t) * page;
+			vkCmdDrawIndexedIndirectCount(_commandBuffer, m_DrawCommandBuffer.buffer, commandOffset, m_DrawCountBuffer.buffer, countOffset, maxDrawCount, commandStride);
+			continue;
+		}
+
+		// Culled slots were cleared to zero instance draws
+		for (uint32_t first = 0; first < m_InstanceCapacity; first += maxDrawCount)
 		{
-			gameObject.UpdateModelMatrix();
-			ObjectData objectData = gameObject.GetObjectData();
-			vkCmdPushConstants(m_CommandBuffers[i], m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectData), &objectData);
+			const uint32_t drawCount = std::min(maxDrawCount, m_InstanceCapacity - first);
+			vkCmdDrawIndexedIndirect(_commandBuffer, m_DrawCommandBuffer.buffer, commandOffset + static_cast<VkDeviceSize>(commandStride) * first, drawCount, commandStride);
+		}
+	}
+}
+
+void VulkanRenderer::RecordDepthPyramid(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex)
+{
+	// The early pass's render pass dependency covers its depth writes, this one orders the reduction's writes
+	// after the early culling dispatch that read the previous pyramid
+	VkMemoryBarrier readBarrier{};
+	readBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	readBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	readBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &readBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_DepthReducePipeline);
+
+	DepthReduceConstants reduceConstants{};
+	reduceConstants.sourceSize = glm::ivec2(GetRenderExtent().width, GetRenderExtent().height);
+
+	for (uint32_t level = 0; level < m_DepthPyramidLevelCount; ++level)
+	{
+		reduceConstants.destinationSize = glm::ivec2(std::max(1u, m_DepthPyramidExtent.width >> level), std::max(1u, m_DepthPyramidExtent.height >> level));
 
-			gameObject.Bind(m_CommandBuffers[i]);
-			gameObject.Render(m_CommandBuffers[i]);
+		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_DepthReducePipelineLayout, 0, 1, &m_DepthReduceDescriptorSets[_frameIndex * DepthPyramidMaxLevels + level], 0, nullptr);
+		vkCmdPushConstants(_commandBuffer, m_DepthReducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthReduceConstants), &reduceConstants);
+		vkCmdDispatch(_commandBuffer, (reduceConstants.destinationSize.x + 7) / 8, (reduceConstants.destinationSize.y + 7) / 8, 1);
+
+		// The next level reads this one, after the last level the late culling dispatch reads the whole pyramid
+		VkMemoryBarrier reduceBarrier{};
+		reduceBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		reduceBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		reduceBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &reduceBarrier, 0, nullptr, 0, nullptr);
+
+		reduceConstants.sourceSize = reduceConstants.destinationSize;
+	}
+
+	m_DepthPyramidValid = true;
+}
+
+void VulkanRenderer::BindDrawState(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex)
+{
+	// Dynamic offsets are consumed in binding order, camera then instances
+	const uint32_t frameOffsets[] = { m_Camera.GetUniformOffset(_frameIndex), static_cast<uint32_t>(m_InstanceStride * _frameIndex) };
+
+	// Secondary command buffers inherit no state, so every slice binds the pipeline and descriptors itself
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+
+	// Viewport and scissor are dynamic so the pipeline survives swapchain recreation
+	const VkViewport viewport = Vki::ViewportInfo(GetRenderExtent());
+	const VkRect2D scissor = Vki::ScissorInfo(GetRenderExtent());
+	vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_GlobalDescriptorSet[0], 2, frameOffsets);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &m_GlobalDescriptorSet[1], 0, nullptr);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 2, 1, &m_GlobalDescriptorSet[2], 0, nullptr);
+}
+
+void VulkanRenderer::RecordDraws(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex, const size_t _firstGroup, const size_t _lastGroup)
+{
+	BindDrawState(_commandBuffer, _frameIndex);
+
+	// Meshes share a few geometry pages, so buffers are only rebound when the page changes
+	uint32_t boundPage = UINT32_MAX;
+
+	for (size_t i = _firstGroup; i < _lastGroup; ++i)
+	{
+		const DrawGroup& drawGroup = m_DrawGroups[i];
+		const uint32_t page = VulkanMeshRegistry::GetMesh(drawGroup.meshId).pageIndex;
+
+		if (page != boundPage)
+		{
+			VulkanMeshRegistry::BindPage(_commandBuffer, page);
+			boundPage = page;
 		}
 
-		vkCmdEndRenderPass(m_CommandBuffers[i]);
-		vkEndCommandBuffer(m_CommandBuffers[i]);
+		// firstInstance offsets gl_InstanceIndex to the group's ObjectData
+		VulkanMeshRegistry::Draw(_commandBuffer, drawGroup.meshId, drawGroup.instanceCount, drawGroup.firstInstance);
 	}
 }
 
+void VulkanRenderer::SetupCamera()
+{
+	m_Camera.SetView(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+	SetupCameraProjection();
+}
+
+void VulkanRenderer::SetupCameraProjection()
+{
+	m_Camera.SetProjection(glm::radians(60.0f), (float)GetRenderExtent().width / GetRenderExtent().height, 0.1f, 100.0f);
+}
+
+void VulkanRenderer::DestroyAfterFrames(std::function<void()>&& _destroy)
+{
+	m_DeletionQueue.push_back({ m_SubmittedFrameCount, std::move(_destroy) });
+}
+
+void VulkanRenderer::ProcessDeletionQueue(const bool _flushAll)
+{
+	// Waiting on a frame's fence retires the submission made MaxFrameDraws frames earlier, so anything retired
+	// before that submission can no longer be in use by the GPU
+	while (!m_DeletionQueue.empty())
+	{
+		const PendingDeletion& pending = m_DeletionQueue.front();
+		if (!_flushAll && pending.retiredAtFrame + MaxFrameDraws > m_SubmittedFrameCount) break;
+
+		pending.destroy();
+		m_DeletionQueue.pop_front();
+	}
+}
+
+void VulkanRenderer::ResetObjectBounds()
+{
+	// Every transform starts flagged, so the first update fills these in
+	m_ObjectBounds.assign(m_Scene.GetObjectCount(), Aabb());
+}
+
 void VulkanRenderer::SetupScene()
 {
-	GameObject ground(VulkanPrimative::Primative::Quad, "volcanic_rock_0.jpg");
-	ground.SetPosition(glm::vec3(0.0f, 0.5f, 0.0f));
-	ground.SetScale(glm::vec3(10.0f, 10.0f, 1.0f));
-	ground.SetRotation(glm::vec3(1.57f, 0.0f, 0.0f));
-
-	GameObject box1(VulkanPrimative::Primative::Cube, "brick_0.jpg");
-	GameObject box2(VulkanPrimative::Primative::Cube, "brick_0.jpg");
-	GameObject box3(VulkanPrimative::Primative::Cube, "brick_0.jpg");
-	GameObject box4(VulkanPrimative::Primative::Cube, "brick_0.jpg");
-	GameObject box5(VulkanPrimative::Primative::Cube, "brick_0.jpg");
-
-	box2.SetPosition(glm::vec3(1.5f, 0.0f, 0.0f));
-	box2.SetRotation(glm::vec3(0.0f, 1.1f, 0.0f));
-	box3.SetPosition(glm::vec3(3.0f, 0.0f, 0.0f));
-	box4.SetPosition(glm::vec3(-1.5f, 0.0f, 0.0f));
-	box4.SetRotation(glm::vec3(0.0f, 1.1f, 0.0f));
-	box5.SetPosition(glm::vec3(-3.0f, 0.0f, 0.0f));
-	
-	m_GameObjects.emplace_back(ground);
-	m_GameObjects.emplace_back(box1);
-	m_GameObjects.emplace_back(box2);
-	m_GameObjects.emplace_back(box3);
-	m_GameObjects.emplace_back(box4);
-	m_GameObjects.emplace_back(box5);
+	m_Scene.CreateRenderable(VulkanPrimative::Primative::Quad, "volcanic_rock_0.jpg", glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.57f, 0.0f, 0.0f), glm::vec3(10.0f, 10.0f, 1.0f));
+
+	m_Scene.CreateRenderable(VulkanPrimative::Primative::Cube, "brick_0.jpg", glm::vec3(0.0f));
+	m_Scene.CreateRenderable(VulkanPrimative::Primative::Cube, "brick_0.jpg", glm::vec3(1.5f, 0.0f, 0.0f), glm::vec3(0.0f, 1.1f, 0.0f));
+	m_Scene.CreateRenderable(VulkanPrimative::Primative::Cube, "brick_0.jpg", glm::vec3(3.0f, 0.0f, 0.0f));
+	m_Scene.CreateRenderable(VulkanPrimative::Primative::Cube, "brick_0.jpg", glm::vec3(-1.5f, 0.0f, 0.0f), glm::vec3(0.0f, 1.1f, 0.0f));
+	m_Scene.CreateRenderable(VulkanPrimative::Primative::Cube, "brick_0.jpg", glm::vec3(-3.0f, 0.0f, 0.0f));
 }
\ No newline at end of file
@@ -3,44 +3,161 @@
 #include "VulkanDevice.h"
 #include "VulkanSwapchain.h"
 #include "VulkanPipelineBuilder.h"
-#include "../GameObject.h"
+#include "../Scene.h"
 #include "../Camera.h"
+#include "../JobSystem.h"
+#include "../FrustumCuller.h"
+#include "../Bvh.h"
 #include <string>
+#include <memory>
+#include <deque>
+#include <functional>
 
 class Window;
 
+struct RendererSettings
+{
+	bool headless = false;			// Render into offscreen images instead of a window surface
+	uint32_t width = 800;			// Offscreen image width (headless only)
+	uint32_t height = 600;			// Offscreen image height (headless only)
+	uint32_t recordThreadCount = 1;	// Threads recording draws into secondary command buffers, 1 records inline
+	uint32_t textureDecodeThreadCount = 0;	// Workers decoding texture files in the background, 0 uses every spare hardware thread
+	bool gpuCulling = false;		// Frustum cull on the GPU and draw through indirect commands, ignored without the device features
+	bool frustumCulling = true;		// Frustum cull object bounds on the CPU before building draw groups (CPU path only)
+	bool bvhCulling = true;			// Cull through the scene BVH instead of testing every object's bounds
+	bool occlusionCulling = true;	// Test GPU culled objects against a depth pyramid, ignored without gpuCulling
+	bool keepMeshData = false;		// Keep CPU copies of mesh vertices and indices after upload instead of only counts and bounds
+	bool textureMipmaps = true;		// Give loaded textures a full mip chain, off samples minified textures from the top level only
+	bool cookedTextures = true;		// Load textures from the files TextureCooker wrote when they exist, off always decodes the source
+	bool textureStreaming = true;	// Upload only small mip levels at first and stream finer ones by screen size, needs textureMipmaps
+	uint64_t textureBudget = 0;		// Bytes texture streaming may keep resident, 0 follows the device's memory budget
+	VertexFormat vertexFormat = VertexFormat::Full;	// Layout of the geometry pages, Compact halves vertex fetch bandwidth
+};
+
+// Occlusion culling splits the frame in two: the early phase draws what the previous frame's depth doesn't hide,
+// the late phase retests what it rejected against depth from the early phase, so disoccluded objects never go missing
+enum class CullPhase : uint32_t
+{
+	Single,		// Frustum only, one render pass
+	Early,
+	Late
+};
+
+// Matches the std430 layout of the instance buffer in shader.vert
+struct ObjectData
+{
+	glm::mat4 model;
+	uint32_t texId;
+	uint32_t meshId;		// Read by the culling pass to find the mesh's bounds and draw range
+	uint32_t padding[2];
+};
+
+// Matches the push constants in cull.comp
+struct CullConstants
+{
+	glm::vec4 frustumPlanes[6];
+	uint32_t objectCount;
+	CullPhase phase;
+	uint32_t previousPyramidValid;	// The early phase skips the occlusion test until a pyramid has been built
+	uint32_t statsOffset;			// First of this frame's counters in the stats buffer
+	glm::vec2 pyramidSize;			// Texels in the pyramid's top level
+};
+
+// Matches the push constants in depth_reduce.comp
+struct DepthReduceConstants
+{
+	glm::ivec2 sourceSize;
+	glm::ivec2 destinationSize;
+};
+
+// Counters written by cull.comp, one set per frame in flight
+struct CullStats
+{
+	uint32_t visibleObjects;
+	uint32_t frustumCulledObjects;
+	uint32_t occludedObjects;
+	uint32_t occludedTriangles;
+};
+
+struct RendererStats
+{
+	double gpuFrameTime = 0.0;		// Milliseconds the GPU spent on the most recently completed frame
+	bool gpuTimeValid = false;		// False when timestamps are unsupported or no frame has completed yet
+	uint64_t uploadBytes = 0;		// Bytes staged for upload during the previous frame
+	double cpuRecordTime = 0.0;		// Milliseconds spent recording the most recent frame's command buffer
+	uint32_t visibleObjects = 0;	// Objects drawn in the most recent frame
+	uint32_t culledObjects = 0;		// Objects rejected by the frustum test in the most recent frame
+	uint32_t occludedObjects = 0;	// Draws skipped by occlusion culling, GPU culling reports these (and the counts above) MaxFrameDraws frames late
+	uint32_t occludedTriangles = 0;	// Triangles in the draws skipped by occlusion culling
+};
+
 class VulkanRenderer
 {
 public:
-	VulkanRenderer(Window* _window);
+	VulkanRenderer(Window* _window, const RendererSettings& _settings = RendererSettings());
 	~VulkanRenderer();
 
 	void Draw();
+	void ReadFrame(std::vector<uint8_t>& _pixels);
+	void SetScene(Scene&& _scene);		// Takes the scene's entities and their mesh references, the previous scene is released
+	VkExtent2D GetRenderExtent() const;
+	RendererStats GetStats() const { return m_Stats; }
+	const RendererSettings& GetSettings() const { return m_Settings; }
+	Camera& GetCamera() { return m_Camera; }
+	const Scene& GetScene() const { return m_Scene; }
+	TransformSystem& GetTransforms() { return m_Scene.GetTransforms(); }	// Entities are moved through here, by their transform id
+	const Bvh& GetSceneBvh() const { return m_SceneBvh; }		// Object world bounds as of the last drawn frame, for picking and proximity queries
 
 private:
 	void CreateInstance();
 	void CreateLogicalDevice();
 	void CreateSurface();
-	void CreateSwapchain();
+	void CreateSwapchain(const VkSwapchainKHR _oldSwapchain = VK_NULL_HANDLE);
+	bool RecreateSwapchain();
+	void CreateOffscreenImages();
 	void CreateRenderPass();
+	VkRenderPass BuildRenderPass(const bool _firstPass, const bool _lastPass);
 	void CreateGraphicsPipeline();
 	void CreateDepthBufferImage();
 	void CreateFramebuffers();
 	void CreateCommandPool();
 	void CreateCommandBuffers();
+	void CreateSecondaryCommandBuffers();
 	void CreateSynchronization();
 	void CreateDescriptorPool();
 	void CreateDescriptorLayout();
 	void AllocateDescriptorSets();
 	void WriteDescriptors();
+	void WriteDepthPyramidDescriptors(const uint32_t _frameIndex);
 	void CreateTextureSampler();
+	void CreateTimestampQueries();
+	void CreateInstanceBuffer(const uint32_t _instanceCapacity);
+	void CreateCullPipeline();
+	void UpdateCullBuffers();
+	void DestroyCullBuffers();
+	void CreateDepthPyramid();
+	void DestroyDepthPyramid();
+	void CreateDepthReducePipeline();
+	void SetupCamera();
+	void SetupCameraProjection();
 	void SetupScene();
+	void ResetObjectBounds();
+
+	// Deferred destruction
+	void DestroyAfterFrames(std::function<void()>&& _destroy);
+	void ProcessDeletionQueue(const bool _flushAll = false);
 
 	// Support 
 	void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& _debugUtilsCreateInfo);
 
 	// Recorders
-	void RecordCommands();
+	void RecordCommands(const uint32_t _frameIndex, const uint32_t _imageIndex);
+	void RecordDrawSlice(const uint32_t _frameIndex, const uint32_t _imageIndex, const uint32_t _slice);
+	void RecordDraws(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex, const size_t _firstGroup, const size_t _lastGroup);
+	void RecordCulling(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex, const CullPhase _phase);
+	void RecordIndirectDraws(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex, const CullPhase _phase);
+	void RecordDepthPyramid(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex);
+	void BindDrawState(const VkCommandBuffer& _commandBuffer, const uint32_t _frameIndex);
 
 	// Getters
 	void SelectPhysicalDevice();
@@ -55,13 +172,22 @@ private:
 	void DestroyDebugMessenger();
 
 	// Choose
+	VkFormat GetColorFormat() const;
 	VkFormat ChooseSupportedFormat(const std::vector<VkFormat>& _formats, const VkImageTiling _tiling, const VkFormatFeatureFlags _featureFlags);
 
 	// Updates
 	void UpdateUniformBuffers();
+	void UpdateGpuTimings();
+	void UpdateCullStats();
+	void BuildDrawGroups(const uint32_t _frameIndex);
+	void UpdateObjectBuffer(const uint32_t _frameIndex);
+	void UpdateTransforms();
+	void UpdateSceneBvh();
+	void UpdateTextureStreaming();
 
 private:
 	Window* m_Window;
+	RendererSettings m_Settings;
 	VkInstance m_VkInstance;
 	MainDevice m_MainDevice;
 	VkDebugUtilsMessengerEXT m_DebugMessenger;
@@ -70,21 +196,102 @@ private:
 	VkPipelineLayout m_PipelineLayout;
 	VkPipeline m_GraphicsPipeline;
 	VkDescriptorPool m_DescriptorPool;
+	VkDescriptorPool m_TextureDescriptorPool;		// Update-after-bind pool holding only the bindless texture table
 	std::vector<VkDescriptorSetLayout> m_DescriptorSetLayout;
 	std::vector<VkDescriptorSet> m_GlobalDescriptorSet;
 	VkRenderPass m_RenderPass;
 	VkCommandPool m_GraphicsCommandPool;
+	std::vector<VkCommandPool> m_FrameCommandPools;
+	std::unique_ptr<JobSystem> m_JobSystem;
+	std::unique_ptr<JobSystem> m_TextureJobSystem;		// Separate from recording so long decodes never hold up a frame's slices
 	VkSampler m_Sampler;
+	VkQueryPool m_TimestampQueryPool;
 	CustomImage m_DepthImage;
 	VulkanPipelineBuilder m_PipelineBuilder;
 
 	uint32_t m_CurrentFrameIndex;
+	uint32_t m_LastImageIndex;
+	uint64_t m_SubmittedFrameCount;
+	bool m_SwapchainOutOfDate;
+	RendererStats m_Stats;
 	Camera m_Camera;
 
-	std::vector<GameObject> m_GameObjects;
+	Scene m_Scene;
+	std::vector<CustomImage> m_OffscreenImages;
 	std::vector<VkFramebuffer> m_Framebuffers;
 	std::vector<VkCommandBuffer> m_CommandBuffers;
+	std::vector<std::vector<VkCommandPool>> m_SecondaryCommandPools;		// [frame][slice], each slice is recorded by one thread
+	std::vector<std::vector<VkCommandBuffer>> m_SecondaryCommandBuffers;	// [frame][slice]
 	std::vector<VkSemaphore> m_WaitForImageSph;
 	std::vector<VkSemaphore> m_WaitForRenderingSph;
 	std::vector<VkFence> m_RenderCompleteFence;
+	std::vector<bool> m_FrameHasTimestamps;
+
+	// Objects sharing a mesh are drawn with one instanced call, their ObjectData is written to the frame's instance slice
+	struct DrawGroup
+	{
+		MeshId meshId;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+	std::vector<DrawGroup> m_DrawGroups;
+	std::vector<std::pair<MeshId, uint32_t>> m_DrawOrder;		// (mesh, object index), sorted so instances of a mesh are contiguous
+	FrustumCuller m_FrustumCuller;
+	std::vector<std::pair<MeshId, uint32_t>> m_CullCandidates;	// (mesh, object index) of every drawable object, in the order boxes are added to the culler
+	std::vector<uint32_t> m_VisibleCandidates;					// Culler output indexing m_CullCandidates, or object indices when culling through the BVH
+	UniformBuffer m_InstanceBuffer;
+	VkDeviceSize m_InstanceStride;								// Size of one frame's slice, padded to the device's offset alignment
+	uint8_t* m_pInstanceData;									// Persistently mapped start of the instance buffer
+	uint32_t m_InstanceCapacity;								// Instances one frame's slice can hold
+
+	// GPU culling, objects keep their scene index as instance and the compute pass writes one indirect command per visible object
+	VkDescriptorSetLayout m_CullDescriptorSetLayout;
+	std::vector<VkDescriptorSet> m_CullDescriptorSets;			// Per frame in flight, so a resize can repoint one while the others are in use
+	VkPipelineLayout m_CullPipelineLayout;
+	VkPipeline m_CullPipeline;
+	UniformBuffer m_MeshTableBuffer;							// GpuMesh per registry slot
+	UniformBuffer m_DrawCommandBuffer;							// [frame][page][capacity] indirect commands
+	UniformBuffer m_DrawCountBuffer;							// [frame][page] visible draw counts
+	uint32_t m_MeshTableCapacity;
+	uint32_t m_CullPageCount;
+	VkDeviceSize m_DrawCommandStride;							// One frame's commands, both phases when occlusion culling
+	VkDeviceSize m_DrawCountStride;
+	VkDeviceSize m_DrawCommandPhaseStride;						// Offset of the late phase's commands within a frame
+	VkDeviceSize m_DrawCountPhaseStride;
+	std::vector<uint8_t> m_ObjectDirtyFrames;					// Per object, bit n set while frame n's slice holds stale data
+
+	// An object index is the entity's transform id in m_Scene
+	std::vector<Aabb> m_ObjectBounds;							// Mesh bounds in world space, refreshed with the transform
+	std::vector<TransformId> m_UpdatedTransforms;				// Transforms rebuilt this frame
+	std::vector<uint32_t> m_StreamingObjects;					// Objects in view at the last texture streaming update
+
+	// Spatial index over object world bounds, refit as objects move and rebuilt when it degrades
+	Bvh m_SceneBvh;												// Indexed by object index
+	bool m_SceneBvhStale;										// Set when the object list is replaced, the tree is rebuilt on the next update
+
+	// Occlusion culling, a max-depth pyramid built from the early phase's depth each frame
+	VkRenderPass m_EarlyRenderPass;								// Clears and keeps depth for the pyramid
+	VkRenderPass m_LateRenderPass;								// Loads the early phase's results and finishes the frame
+	CustomImage m_DepthPyramid;									// imageView covers every level, for the culling pass
+	std::vector<VkImageView> m_DepthPyramidLevelViews;			// One view per level, for the reduction
+	VkExtent2D m_DepthPyramidExtent;
+	uint32_t m_DepthPyramidLevelCount;
+	bool m_DepthPyramidValid;									// False until a pyramid has been built at the current size
+	VkSampler m_DepthPyramidSampler;
+	VkDescriptorSetLayout m_DepthReduceDescriptorSetLayout;
+	std::vector<VkDescriptorSet> m_DepthReduceDescriptorSets;	// [frame][level], the previous level (or the depth buffer) in and this level out
+	std::vector<bool> m_DepthPyramidDescriptorsStale;			// Per frame, set when the pyramid is replaced until that frame's sets point at the new one
+	VkPipelineLayout m_DepthReducePipelineLayout;
+	VkPipeline m_DepthReducePipeline;
+	UniformBuffer m_OcclusionStateBuffer;						// Per object, set when the early phase deferred it to the late phase
+	UniformBuffer m_CullStatsBuffer;							// CullStats per frame in flight, read back once the frame's fence has signalled
+	CullStats* m_pCullStats;
+
+	// Resources retired while frames in flight may still reference them, destroyed once those frames have completed
+	struct PendingDeletion
+	{
+		uint64_t retiredAtFrame;
+		std::function<void()> destroy;
+	};
+	std::deque<PendingDeletion> m_DeletionQueue;
 };
@@ -0,0 +1,170 @@
+#include "VulkanStagingRing.h"
+#include "VulkanUtilities.h"
+#include <stdexcept>
+
+VulkanStagingRing::VulkanStagingRing() :
+	m_UploadManager(nullptr),
+	m_Buffer(VK_NULL_HANDLE),
+	m_BufferMemory{},
+	m_Capacity(0),
+	m_Head(0),
+	m_Tail(0),
+	m_Regions{},
+	m_Stats{}
+{}
+
+void VulkanStagingRing::Init(VulkanUploadManager* _uploadManager, const VkDeviceSize _capacity)
+{
+	m_UploadManager = _uploadManager;
+	m_Capacity = _capacity;
+	m_Stats.capacity = _capacity;
+
+	BufferInfo ringBufferInfo{};
+	ringBufferInfo.pBuffer = &m_Buffer;
+	ringBufferInfo.pBufferMemory = &m_BufferMemory;
+	ringBufferInfo.bufferSize = _capacity;
+	ringBufferInfo.bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	ringBufferInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VulkanUtilities::CreateBuffer(ringBufferInfo);
+}
+
+void VulkanStagingRing::CleanUp()
+{
+	// The upload manager has already waited for every batch by the time this runs
+	VulkanUtilities::DestroyBuffer(m_Buffer, m_BufferMemory);
+	m_Buffer = VK_NULL_HANDLE;
+	m_Regions.clear();
+	m_Head = 0;
+	m_Tail = 0;
+}
+
+StagingAllocation VulkanStagingRing::Allocate(const VkDeviceSize _size, const VkDeviceSize _alignment)
+{
+	m_Stats.bytesThisFrame += _size;
+	m_Stats.totalBytes += _size;
+
+	if (_size > m_Capacity) return AllocateFallback(_size);
+
+	ReclaimCompletedRegions();
+
+	VkDeviceSize offset = 0;
+
+	// Out of room, wait for the oldest batch to finish reading its region and try again
+	while (!TryAllocate(_size, _alignment, offset))
+	{
+		m_Stats.stallCount++;
+		m_UploadManager->Wait(m_Regions.front().ticket);
+		ReclaimCompletedRegions();
+	}
+
+	// Everything staged before the next flush is read by the same batch, so one region covers it
+	const UploadTicket ticket = m_UploadManager->GetPendingTicket();
+
+	if (!m_Regions.empty() && m_Regions.back().ticket == ticket)
+	{
+		m_Regions.back().end = offset + _size;
+	}
+	else
+	{
+		m_Regions.push_back({ ticket, offset + _size });
+	}
+
+	m_Head = offset + _size;
+
+	StagingAllocation allocation{};
+	allocation.buffer = m_Buffer;
+	allocation.offset = offset;
+	allocation.pData = static_cast<uint8_t*>(m_BufferMemory.pMapped) + offset;
+	return allocation;
+}
+
+void VulkanStagingRing::EndFrame()
+{
+	m_Stats.bytesLastFrame = m_Stats.bytesThisFrame;
+	m_Stats.bytesThisFrame = 0;
+}
+
+StagingStats VulkanStagingRing::GetStats() const
+{
+	StagingStats stats = m_Stats;
+
+	if (m_Regions.empty())		stats.bytesInFlight = 0;
+	else if (m_Head > m_Tail)	stats.bytesInFlight = m_Head - m_Tail;
+	else						stats.bytesInFlight = m_Capacity - m_Tail + m_Head;
+
+	return stats;
+}
+
+bool VulkanStagingRing::TryAllocate(const VkDeviceSize _size, const VkDeviceSize _alignment, VkDeviceSize& _offset)
+{
+	if (m_Regions.empty())
+	{
+		_offset = 0;
+		return true;
+	}
+
+	const VkDeviceSize alignedHead = (m_Head + _alignment - 1) / _alignment * _alignment;
+
+	if (m_Head > m_Tail)
+	{
+		// Used space is [tail, head), try the end of the ring first and then wrap to the start
+		if (alignedHead + _size <= m_Capacity)
+		{
+			_offset = alignedHead;
+			return true;
+		}
+
+		if (_size <= m_Tail)
+		{
+			_offset = 0;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Wrapped, used space is [tail, capacity) + [0, head)
+	if (alignedHead + _size <= m_Tail)
+	{
+		_offset = alignedHead;
+		return true;
+	}
+
+	return false;
+}
+
+void VulkanStagingRing::ReclaimCompletedRegions()
+{
+	while (!m_Regions.empty() && m_UploadManager->IsComplete(m_Regions.front().ticket))
+	{
+		m_Tail = m_Regions.front().end;
+		m_Regions.pop_front();
+	}
+
+	if (m_Regions.empty())
+	{
+		m_Head = 0;
+		m_Tail = 0;
+	}
+}
+
+StagingAllocation VulkanStagingRing::AllocateFallback(const VkDeviceSize _size)
+{
+	m_Stats.fallbackCount++;
+
+	StagingAllocation allocation{};
+	MemoryAllocation bufferMemory{};
+
+	BufferInfo stagingBufferInfo{};
+	stagingBufferInfo.pBuffer = &allocation.buffer;
+	stagingBufferInfo.pBufferMemory = &bufferMemory;
+	stagingBufferInfo.bufferSize = _size;
+	stagingBufferInfo.bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	stagingBufferInfo.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VulkanUtilities::CreateBuffer(stagingBufferInfo);
+
+	allocation.pData = bufferMemory.pMapped;
+	VulkanUtilities::DestroyBufferAfterUpload(allocation.buffer, bufferMemory);
+
+	return allocation;
+}
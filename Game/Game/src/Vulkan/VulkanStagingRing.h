@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUploadManager.h"
+
+struct StagingAllocation
+{
+	VkBuffer buffer = VK_NULL_HANDLE;	// Buffer to copy from
+	VkDeviceSize offset = 0;			// Offset of the staged data in the buffer
+	void* pData = nullptr;				// Host pointer to write the data to
+};
+
+struct StagingStats
+{
+	VkDeviceSize capacity;			// Size of the staging ring
+	VkDeviceSize bytesInFlight;		// Ring bytes still waiting on their upload batch
+	VkDeviceSize bytesThisFrame;	// Bytes staged since the last EndFrame
+	VkDeviceSize bytesLastFrame;	// Bytes staged during the previous frame
+	VkDeviceSize totalBytes;		// Bytes staged since initialization
+	uint32_t stallCount;			// Allocations that had to wait for the GPU to release ring space
+	uint32_t fallbackCount;			// Uploads larger than the ring that went through a temporary buffer
+};
+
+// Persistently mapped host visible buffer that all uploads are staged through.
+// Space is handed out linearly and wraps around, regions are reclaimed once the upload batch reading them has completed.
+class VulkanStagingRing
+{
+public:
+	VulkanStagingRing();
+
+	void Init(VulkanUploadManager* _uploadManager, const VkDeviceSize _capacity);
+	void CleanUp();
+	StagingAllocation Allocate(const VkDeviceSize _size, const VkDeviceSize _alignment);
+	void EndFrame();
+	StagingStats GetStats() const;
+
+private:
+	struct StagingRegion
+	{
+		UploadTicket ticket;	// Upload batch reading the region
+		VkDeviceSize end;		// Ring offset the region ends at
+	};
+
+	bool TryAllocate(const VkDeviceSize _size, const VkDeviceSize _alignment, VkDeviceSize& _offset);
+	void ReclaimCompletedRegions();
+	StagingAllocation AllocateFallback(const VkDeviceSize _size);
+
+private:
+	VulkanUploadManager* m_UploadManager;
+	VkBuffer m_Buffer;
+	MemoryAllocation m_BufferMemory;
+	VkDeviceSize m_Capacity;
+	VkDeviceSize m_Head;					// Next free byte
+	VkDeviceSize m_Tail;					// Oldest byte still in use
+	std::deque<StagingRegion> m_Regions;	// Regions in use, oldest first
+	StagingStats m_Stats;
+};
@@ -10,10 +10,11 @@ VulkanSwapchain::VulkanSwapchain() :
 	m_SwapchainSurfaceFormat{},
 	m_SwapchainImageExtent{},
 	m_WidthPixel(0),
-	m_HeightPixel(0)
+	m_HeightPixel(0),
+	m_QueueFamilyIndices{}
 {}
 
-VkSwapchainCreateInfoKHR VulkanSwapchain::Init(const VkPhysicalDevice& _physicalDevice, const VkDevice& _logicalDevice, const VkSurfaceKHR& _surface, const std::pair<uint32_t, uint32_t>& _graphicsPresentQueueIndices, const int _widthInPixels, const int _heightInPixels)
+VkSwapchainCreateInfoKHR VulkanSwapchain::Init(const VkPhysicalDevice& _physicalDevice, const VkDevice& _logicalDevice, const VkSurfaceKHR& _surface, const std::pair<uint32_t, uint32_t>& _graphicsPresentQueueIndices, const int _widthInPixels, const int _heightInPixels, const VkSwapchainKHR _oldSwapchain)
 {
 	VulkanUtilities::GetSwapchainInfo(_physicalDevice, _surface, m_SwapchainInfo);
 
@@ -40,15 +41,17 @@ VkSwapchainCreateInfoKHR VulkanSwapchain::Init(const VkPhysicalDevice& _physical
 	swapchainCreateInfo.imageExtent = m_SwapchainImageExtent;
 	swapchainCreateInfo.minImageCount = imageCount;
 	swapchainCreateInfo.preTransform = m_SwapchainInfo.surfaceCapabilities.currentTransform;
+	swapchainCreateInfo.oldSwapchain = _oldSwapchain;								// Lets the driver hand over resources from the swapchain being replaced
 
 	// If Graphics and Presentation families are different, then swapchain must let images be shared between them
 	if (_graphicsPresentQueueIndices.first != _graphicsPresentQueueIndices.second)
 	{
-		uint32_t queueFamilyIndices[] = { _graphicsPresentQueueIndices.first, _graphicsPresentQueueIndices.second };
+		m_QueueFamilyIndices[0] = _graphicsPresentQueueIndices.first;
+		m_QueueFamilyIndices[1] = _graphicsPresentQueueIndices.second;
 	
 		swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;		// Image share handling
 		swapchainCreateInfo.queueFamilyIndexCount = 2;							// Number of queues to share images between
-		swapchainCreateInfo.pQueueFamilyIndices = queueFamilyIndices;			// Array of queues to share images between
+		swapchainCreateInfo.pQueueFamilyIndices = m_QueueFamilyIndices;		// Array of queues to share images between
 	}
 
 	return swapchainCreateInfo;
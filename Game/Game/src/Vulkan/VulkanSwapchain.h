@@ -21,7 +21,7 @@ class VulkanSwapchain
 public:
 	VulkanSwapchain();
 
-	VkSwapchainCreateInfoKHR Init(const VkPhysicalDevice& _physicalDevice, const VkDevice& _logicalDevice, const VkSurfaceKHR& _surface, const std::pair<uint32_t, uint32_t>& _graphicsPresentQueueIndices, const int _widthInPixels, const int _heightInPixels);
+	VkSwapchainCreateInfoKHR Init(const VkPhysicalDevice& _physicalDevice, const VkDevice& _logicalDevice, const VkSurfaceKHR& _surface, const std::pair<uint32_t, uint32_t>& _graphicsPresentQueueIndices, const int _widthInPixels, const int _heightInPixels, const VkSwapchainKHR _oldSwapchain = VK_NULL_HANDLE);
 	void CreateSwapchainImageViews(const VkDevice& _logicalDevice);
 	void CleanUp(const VkDevice& _logicalDevice);
 	std::vector<SwapchainImage> GetSwapchainImages() const;
@@ -44,4 +44,5 @@ private:
 	const VkDevice* m_Device;
 	int m_WidthPixel;
 	int m_HeightPixel;
+	uint32_t m_QueueFamilyIndices[2];		// Referenced by the returned create info, so it must outlive Init
 };
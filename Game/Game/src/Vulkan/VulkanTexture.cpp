@@ -1,69 +1,740 @@
 #include "VulkanTexture.h"
 #include "VulkanInit.h"
+#include "../JobSystem.h"
+#include "../Ktx2.h"
 #include "../Utilities.h"
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 
-uint32_t VulkanTexture::s_TextureInstanceCount = 0;
+#define TextureFormat VK_FORMAT_R8G8B8A8_UNORM		// Decoded source images
+#define StreamingTailSize 64						// Streamed textures keep the levels this size and smaller resident
+#define MaxStreamingLoads 4							// Stream loads decoding or uploading at once
+#define BudgetHeadroom 0.1							// Share of the device's memory budget texture streaming leaves free
+
+std::vector<VulkanTexture::TextureSlot> VulkanTexture::s_Textures{};
+std::vector<uint32_t> VulkanTexture::s_FreeSlots{};
+std::vector<uint32_t> VulkanTexture::s_FreeDescriptors{};
+uint32_t VulkanTexture::s_DescriptorCount = 0;
+std::vector<uint32_t> VulkanTexture::s_UploadingTextures{};
+std::vector<VulkanTexture::StreamUpload> VulkanTexture::s_StreamUploads{};
 std::map<std::string, uint32_t> VulkanTexture::s_TextureDatabase{};
+std::vector<VulkanTexture::DecodedTexture> VulkanTexture::s_DecodedTextures{};
+std::mutex VulkanTexture::s_DecodedMutex{};
+JobSystem* VulkanTexture::s_pJobSystem = nullptr;
+uint32_t VulkanTexture::s_PendingCount = 0;
+uint64_t VulkanTexture::s_NextLoadId = 0;
+bool VulkanTexture::s_GenerateMipmaps = true;
+bool VulkanTexture::s_UseCookedTextures = true;
+std::vector<VkFormat> VulkanTexture::s_CookedFormats{};
+bool VulkanTexture::s_Streaming = false;
+uint64_t VulkanTexture::s_StreamingBudget = 0;
+uint64_t VulkanTexture::s_StreamingUpdate = 1;
+uint32_t VulkanTexture::s_StreamingLoads = 0;
+TextureStreamingStats VulkanTexture::s_StreamingStats{};
+std::function<void(std::function<void()>&&)> VulkanTexture::s_DestroyAfterFrames{};
+bool VulkanTexture::s_BlitMipmaps = false;
+bool VulkanTexture::s_CopyEvictions = false;
+VkDescriptorSet VulkanTexture::s_DescriptorSet = VK_NULL_HANDLE;
+uint32_t VulkanTexture::s_Capacity = 0;
+
+VulkanTexture::VulkanTexture() :
+	m_TextureId(0)
+{}
 
 uint32_t VulkanTexture::CreateTextureImage(const std::string& _fileName)
 {
+	// Textures are shared between every object that loads the same file
 	if (s_TextureDatabase.find(_fileName) != s_TextureDatabase.end())
 	{
-		return s_TextureDatabase[_fileName];
+		m_TextureId = s_TextureDatabase[_fileName];
+		AddReference(m_TextureId);
+		return m_TextureId;
+	}
+
+	if (s_DescriptorSet == VK_NULL_HANDLE) throw std::runtime_error("VULKAN ERROR: Textures can't be loaded before the texture table is allocated\n");
+	if (s_FreeSlots.empty() && s_Textures.size() >= s_Capacity) throw std::runtime_error("VULKAN ERROR: The texture table is full\n");
+
+	// Freed slots are reused before the table grows
+	if (!s_FreeSlots.empty())
+	{
+		m_TextureId = s_FreeSlots.back();
+		s_FreeSlots.pop_back();
+	}
+	else
+	{
+		m_TextureId = static_cast<uint32_t>(s_Textures.size());
+		s_Textures.emplace_back();
+	}
+
+	TextureSlot& slot = s_Textures[m_TextureId];
+	slot.fileName = _fileName;
+	slot.refCount = 1;
+	slot.state = TextureState::Decoding;
+	slot.loadId = ++s_NextLoadId;
+	s_TextureDatabase.insert(std::pair(_fileName, m_TextureId));
+	++s_PendingCount;
+
+	// Streamed textures start out with only their small levels
+	QueueLoad(m_TextureId, s_Streaming ? TailLevel : 0, false);
+	return m_TextureId;
+}
+
+void VulkanTexture::QueueLoad(const uint32_t _textureId, const uint32_t _firstLevel, const bool _streamed)
+{
+	TextureSlot& slot = s_Textures[_textureId];
+
+	DecodedTexture request{};
+	request.textureId = _textureId;
+	request.loadId = slot.loadId;
+	request.streamed = _streamed;
+	request.firstLevel = _firstLevel;
+
+	if (_streamed)
+	{
+		slot.streaming = true;
+		slot.streamLevel = _firstLevel;
+		++s_StreamingLoads;
+	}
+
+	// The worker only touches the decoded list, the slot is filled in by Update. Levels that aren't uploaded whole are
+	// built on the CPU, a blit needs the top level on the GPU
+	const std::string fileName = slot.fileName;
+	const bool generateMipmaps = s_GenerateMipmaps;
+	const bool buildMipChain = s_GenerateMipmaps && (!s_BlitMipmaps || s_Streaming);
+	const std::vector<VkFormat> cookedFormats = s_UseCookedTextures ? s_CookedFormats : std::vector<VkFormat>{};
+	auto decode = [request, fileName, cookedFormats, generateMipmaps, buildMipChain]()
+	{
+		DecodedTexture decoded = Decode(request, fileName, cookedFormats, generateMipmaps, buildMipChain);
+
+		std::lock_guard<std::mutex> lock(s_DecodedMutex);
+		s_DecodedTextures.emplace_back(std::move(decoded));
+	};
+
+	if (s_pJobSystem) s_pJobSystem->Submit(decode);
+	else decode();
+}
+
+void VulkanTexture::SetDescriptorTable(const VkDescriptorSet _descriptorSet, const uint32_t _capacity)
+{
+	s_DescriptorSet = _descriptorSet;
+	s_Capacity = _capacity;
+	s_BlitMipmaps = VulkanUtilities::CanBlitMipmaps(TextureFormat);
+	s_CopyEvictions = VulkanUtilities::CanCopyImagesInUse();
+
+	// Best quality first. BC7 keeps alpha and smooth gradients at twice BC1's size, uncompressed cooked files still save
+	// the decode and the mip chain
+	s_CookedFormats.clear();
+	for (const VkFormat format : { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK, TextureFormat })
+	{
+		if (VulkanUtilities::SupportsSampledFormat(format)) s_CookedFormats.emplace_back(format);
+	}
+
+	// Mid grey checker in slot 0, it's uploaded with the rest of the renderer's startup work before any frame draws
+	const uint32_t grey = 0xFF808080;
+	const uint32_t lightGrey = 0xFFA0A0A0;
+	const uint32_t placeholderPixels[4] = { grey, lightGrey, lightGrey, grey };
+	const unsigned char* pPlaceholderBytes = reinterpret_cast<const unsigned char*>(placeholderPixels);
+
+	TextureData placeholderTexture{};
+	placeholderTexture.width = 2;
+	placeholderTexture.height = 2;
+	placeholderTexture.levels.emplace_back(pPlaceholderBytes, pPlaceholderBytes + sizeof(placeholderPixels));
+
+	TextureSlot placeholder{};
+	placeholder.image = CreateImage(placeholderTexture, 1);
+	placeholder.refCount = 1;
+	placeholder.format = TextureFormat;
+	placeholder.width = placeholderTexture.width;
+	placeholder.height = placeholderTexture.height;
+	placeholder.byteSize = sizeof(placeholderPixels);
+	placeholder.state = TextureState::Resident;
+
+	s_Textures.assign(1, placeholder);
+	s_FreeDescriptors.clear();
+	s_DescriptorCount = 1;
+	WriteDescriptor(PlaceholderTextureId, placeholder.image.imageView);
+}
+
+uint32_t VulkanTexture::Update()
+{
+	std::vector<DecodedTexture> decodedTextures;
+
+	{
+		std::lock_guard<std::mutex> lock(s_DecodedMutex);
+		decodedTextures.swap(s_DecodedTextures);
+	}
+
+	// Images are created and their copies recorded here, workers never touch the device
+	const size_t firstStreamUpload = s_StreamUploads.size();
+
+	for (const DecodedTexture& decoded : decodedTextures)
+	{
+		TextureSlot& slot = s_Textures[decoded.textureId];
+		const TextureData& texture = decoded.texture;
+
+		if (decoded.streamed)
+		{
+			// Released, and maybe reused, while it reloaded. A reload that failed keeps what's resident
+			if (slot.loadId != decoded.loadId || !decoded.loaded)
+			{
+				if (slot.loadId == decoded.loadId) slot.streaming = false;
+				--s_StreamingLoads;
+				continue;
+			}
+
+			// Uploaded next to the image that's drawn until the new one is bound
+			StreamUpload upload{};
+			upload.textureId = decoded.textureId;
+			upload.loadId = decoded.loadId;
+			upload.image = CreateImage(texture, decoded.mipLevels - decoded.firstLevel);
+			upload.format = texture.format;
+			upload.firstLevel = decoded.firstLevel;
+			s_StreamUploads.emplace_back(upload);
+			continue;
+		}
+
+		// Released while it was decoding, the slot was kept until now so the id couldn't be handed out twice
+		if (slot.refCount == 0)
+		{
+			slot = TextureSlot{};
+			s_FreeSlots.emplace_back(decoded.textureId);
+			--s_PendingCount;
+			continue;
+		}
+
+		if (!decoded.loaded) throw std::runtime_error("ERROR: Failed to load texture file " + slot.fileName + "\n");
+
+		slot.image = CreateImage(texture, decoded.mipLevels - decoded.firstLevel);
+		slot.format = texture.format;
+		slot.width = decoded.width;
+		slot.height = decoded.height;
+		slot.mipLevels = decoded.mipLevels;
+		slot.residentLevel = decoded.firstLevel;
+		slot.byteSize = GetLevelBytes(slot, decoded.firstLevel);
+		slot.state = TextureState::Uploading;
+		s_UploadingTextures.emplace_back(decoded.textureId);
+	}
+
+	if (!decodedTextures.empty())
+	{
+		const UploadTicket ticket = VulkanUtilities::FlushUploads();
+		for (const DecodedTexture& decoded : decodedTextures)
+		{
+			if (s_Textures[decoded.textureId].state == TextureState::Uploading) s_Textures[decoded.textureId].uploadTicket = ticket;
+		}
+
+		for (size_t i = firstStreamUpload; i < s_StreamUploads.size(); ++i) s_StreamUploads[i].uploadTicket = ticket;
+	}
+
+	// Free elements were never drawn from, or their last frame has completed, so they can be written while frames
+	// using the rest of the table are in flight. Objects switch over the next time their instance data is written.
+	// When every element is taken the texture waits for a retired one to come back
+	uint32_t boundCount = 0;
+
+	for (size_t i = 0; i < s_UploadingTextures.size();)
+	{
+		const uint32_t textureId = s_UploadingTextures[i];
+		TextureSlot& slot = s_Textures[textureId];
+		const uint32_t descriptor = VulkanUtilities::IsUploadComplete(slot.uploadTicket) ? AllocateDescriptor() : InvalidDescriptor;
+
+		if (descriptor == InvalidDescriptor)
+		{
+			++i;
+			continue;
+		}
+
+		slot.descriptor = descriptor;
+		WriteDescriptor(descriptor, slot.image.imageView);
+		slot.state = TextureState::Resident;
+		s_UploadingTextures[i] = s_UploadingTextures.back();
+		s_UploadingTextures.pop_back();
+		--s_PendingCount;
+		++boundCount;
+	}
+
+	// Reloaded textures swap images, the old one and its element are retired rather than overwritten
+	for (size_t i = 0; i < s_StreamUploads.size();)
+	{
+		const StreamUpload upload = s_StreamUploads[i];
+		if (!VulkanUtilities::IsUploadComplete(upload.uploadTicket))
+		{
+			++i;
+			continue;
+		}
+
+		TextureSlot& slot = s_Textures[upload.textureId];
+
+		if (slot.loadId == upload.loadId)
+		{
+			const uint32_t descriptor = AllocateDescriptor();
+			if (descriptor == InvalidDescriptor)
+			{
+				++i;
+				continue;
+			}
+
+			WriteDescriptor(descriptor, upload.image.imageView);
+			Retire(slot.image, slot.descriptor);
+
+			slot.image = upload.image;
+			slot.descriptor = descriptor;
+			slot.format = upload.format;
+			slot.residentLevel = upload.firstLevel;
+			slot.byteSize = GetLevelBytes(slot, upload.firstLevel);
+			slot.streaming = false;
+			++boundCount;
+		}
+		else
+		{
+			// Released while it uploaded, the image was never bound
+			VulkanUtilities::DestroyImageView(upload.image.imageView);
+			VulkanUtilities::DestroyImage(upload.image.image, upload.image.imageMemory);
+		}
+
+		s_StreamUploads[i] = s_StreamUploads.back();
+		s_StreamUploads.pop_back();
+		--s_StreamingLoads;
+	}
+
+	return boundCount;
+}
+
+void VulkanTexture::WaitForLoads()
+{
+	// Every decode has been handed over once the tasks are done, after one Update the rest is waiting on uploads
+	if (s_pJobSystem) s_pJobSystem->WaitForTasks();
+	Update();
+
+	for (const uint32_t textureId : s_UploadingTextures)
+	{
+		VulkanUtilities::WaitForUpload(s_Textures[textureId].uploadTicket);
+	}
+
+	Update();
+}
+
+void VulkanTexture::AddReference(const uint32_t _textureId)
+{
+	++s_Textures[_textureId].refCount;
+}
+
+void VulkanTexture::Release(const uint32_t _textureId)
+{
+	TextureSlot& slot = s_Textures[_textureId];
+	if (_textureId == PlaceholderTextureId || slot.refCount == 0 || --slot.refCount > 0) return;
+
+	s_TextureDatabase.erase(slot.fileName);
+
+	// A decoding worker still owns the slot, Update frees it when the pixels arrive
+	if (slot.state == TextureState::Decoding) return;
+
+	if (slot.state == TextureState::Uploading)
+	{
+		VulkanUtilities::WaitForUpload(slot.uploadTicket);
+		s_UploadingTextures.erase(std::find(s_UploadingTextures.begin(), s_UploadingTextures.end(), _textureId));
+		--s_PendingCount;
+	}
+
+	// Copies of dropped levels read the image that's about to be destroyed
+	for (const StreamUpload& upload : s_StreamUploads)
+	{
+		if (upload.textureId == _textureId && upload.loadId == slot.loadId) VulkanUtilities::WaitForUpload(upload.uploadTicket);
+	}
+
+	// Stream loads still in flight no longer match the slot's load id, Update drops them when they arrive. The element
+	// is left pointing at the destroyed view, the table is partially bound and nothing indexes a free element
+	DestroySlot(_textureId);
+	s_FreeSlots.emplace_back(_textureId);
+}
+
+void VulkanTexture::RequestFootprint(const uint32_t _textureId, const float _pixelsPerRepeat)
+{
+	TextureSlot& slot = s_Textures[_textureId];
+	if (!s_Streaming || _textureId == PlaceholderTextureId || slot.state != TextureState::Resident) return;
+
+	// The level sampling lands on at this size, finer ones would only be filtered away
+	const float texelsPerPixel = static_cast<float>(std::max(slot.width, slot.height)) / std::max(_pixelsPerRepeat, 1.0f);
+	const uint32_t level = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::log2(texelsPerPixel)) : 0;
+
+	slot.requestedLevel = std::min({ slot.requestedLevel, level, GetTailLevel(slot.width, slot.height, slot.mipLevels) });
+	slot.lastRequested = s_StreamingUpdate;
+}
+
+void VulkanTexture::UpdateStreaming()
+{
+	if (!s_Streaming) return;
+
+	const uint64_t budget = GetStreamingBudget();
+	s_StreamingStats.budgetBytes = budget;
+
+	// What every texture will hold once the loads in flight land, the tails are counted but never evicted
+	uint64_t committedBytes = 0;
+
+	for (uint32_t textureId = 1; textureId < s_Textures.size(); ++textureId)
+	{
+		const TextureSlot& slot = s_Textures[textureId];
+		if (slot.state == TextureState::Resident) committedBytes += GetLevelBytes(slot, slot.streaming ? slot.streamLevel : slot.residentLevel);
+	}
+
+	// Textures nobody asked for since the last update only need their tail
+	auto getNeededLevel = [](const TextureSlot& _slot)
+	{
+		return _slot.lastRequested == s_StreamingUpdate ? _slot.requestedLevel : GetTailLevel(_slot.width, _slot.height, _slot.mipLevels);
+	};
+
+	std::vector<uint32_t> candidates;
+
+	// Over budget, the least recently needed textures drop the levels nothing needs now
+	if (committedBytes > budget)
+	{
+		for (uint32_t textureId = 1; textureId < s_Textures.size(); ++textureId)
+		{
+			const TextureSlot& slot = s_Textures[textureId];
+			if (slot.state == TextureState::Resident && !slot.streaming && slot.residentLevel < getNeededLevel(slot)) candidates.emplace_back(textureId);
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const uint32_t _a, const uint32_t _b) { return s_Textures[_a].lastRequested < s_Textures[_b].lastRequested; });
+
+		// The kept levels are already on the GPU, so they're copied into the smaller image instead of decoding the file
+		const size_t firstStreamUpload = s_StreamUploads.size();
+
+		for (const uint32_t textureId : candidates)
+		{
+			if (committedBytes <= budget || s_StreamingLoads >= MaxStreamingLoads) break;
+
+			TextureSlot& slot = s_Textures[textureId];
+			const uint32_t neededLevel = getNeededLevel(slot);
+			committedBytes -= GetLevelBytes(slot, slot.residentLevel) - GetLevelBytes(slot, neededLevel);
+			++s_StreamingStats.evictions;
+
+			if (!s_CopyEvictions)
+			{
+				QueueLoad(textureId, neededLevel, true);
+				continue;
+			}
+
+			s_StreamUploads.emplace_back(CopyLevels(textureId, neededLevel));
+			slot.streaming = true;
+			slot.streamLevel = neededLevel;
+			++s_StreamingLoads;
+		}
+
+		if (s_StreamUploads.size() > firstStreamUpload)
+		{
+			const UploadTicket ticket = VulkanUtilities::FlushUploads();
+			for (size_t i = firstStreamUpload; i < s_StreamUploads.size(); ++i) s_StreamUploads[i].uploadTicket = ticket;
+		}
+	}
+
+	// Then finer levels for what's needed, the largest shortfall first and only as fine as the budget allows
+	candidates.clear();
+
+	for (uint32_t textureId = 1; textureId < s_Textures.size(); ++textureId)
+	{
+		const TextureSlot& slot = s_Textures[textureId];
+		if (slot.state == TextureState::Resident && !slot.streaming && getNeededLevel(slot) < slot.residentLevel) candidates.emplace_back(textureId);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [&getNeededLevel](const uint32_t _a, const uint32_t _b)
+	{
+		return s_Textures[_a].residentLevel - getNeededLevel(s_Textures[_a]) > s_Textures[_b].residentLevel - getNeededLevel(s_Textures[_b]);
+	});
+
+	for (const uint32_t textureId : candidates)
+	{
+		if (s_StreamingLoads >= MaxStreamingLoads) break;
+
+		const TextureSlot& slot = s_Textures[textureId];
+		const uint64_t residentBytes = GetLevelBytes(slot, slot.residentLevel);
+		uint32_t level = getNeededLevel(slot);
+
+		while (level < slot.residentLevel && committedBytes + GetLevelBytes(slot, level) - residentBytes > budget) ++level;
+		if (level == slot.residentLevel) continue;
+
+		committedBytes += GetLevelBytes(slot, level) - residentBytes;
+		QueueLoad(textureId, level, true);
+		++s_StreamingStats.streamedLoads;
+	}
+
+	// Requests start over for the next update
+	for (TextureSlot& slot : s_Textures) slot.requestedLevel = UINT32_MAX;
+	++s_StreamingUpdate;
+}
+
+uint32_t VulkanTexture::GetLoadedCount()
+{
+	// The placeholder isn't counted
+	return s_Textures.empty() ? 0 : static_cast<uint32_t>(s_Textures.size() - s_FreeSlots.size() - 1);
+}
+
+uint32_t VulkanTexture::GetCompressedCount()
+{
+	uint32_t count = 0;
+
+	for (const TextureSlot& slot : s_Textures)
+	{
+		if (slot.state == TextureState::Resident && TextureCompression::IsBlockCompressed(slot.format)) ++count;
 	}
 
-	int width = 0;
-	int height = 0;
-	int desiredChannels = 0;
+	return count;
+}
+
+uint64_t VulkanTexture::GetResidentBytes()
+{
+	uint64_t bytes = 0;
+
+	for (const TextureSlot& slot : s_Textures)
+	{
+		if (slot.state == TextureState::Resident) bytes += slot.byteSize;
+	}
+
+	return bytes;
+}
 
-	unsigned char* imageData = Utilities::LoadTextureFile(_fileName, &width, &height, &desiredChannels);
+VulkanTexture::DecodedTexture VulkanTexture::Decode(const DecodedTexture& _request, const std::string& _fileName, const std::vector<VkFormat>& _cookedFormats, const bool _generateMipmaps, const bool _buildMipChain)
+{
+	DecodedTexture decoded = _request;
+	TextureData& texture = decoded.texture;
 
-	VkBuffer imageBuffer{};
-	VkDeviceMemory imageBufferMemory{};
-	VkDeviceSize imageBufferSize = width * height * desiredChannels;
+	// Cooked files carry their whole chain, only the top level is kept when mipmaps are off
+	for (const VkFormat format : _cookedFormats)
+	{
+		if (!Ktx2::Load(Utilities::GetTexturePath(TextureCompression::GetCookedFileName(_fileName, format)), texture)) continue;
 
-	BufferInfo imageStagingBuffer{};
-	imageStagingBuffer.bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	imageStagingBuffer.memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	imageStagingBuffer.bufferSize = imageBufferSize;
-	imageStagingBuffer.pBufferMemory = &imageBufferMemory;
-	imageStagingBuffer.pBuffer = &imageBuffer;
-	VulkanUtilities::CreateBuffer(imageStagingBuffer);
+		if (!_generateMipmaps) texture.levels.resize(1);
+		decoded.mipLevels = static_cast<uint32_t>(texture.levels.size());
+		decoded.loaded = true;
+		break;
+	}
 
-	// Copy image data to staging buffer
-	void* data = nullptr;
-	VulkanUtilities::MapMemory(imageBufferMemory, imageBufferSize, &data);
-	memcpy(data, imageData, static_cast<size_t>(imageBufferSize));
-	VulkanUtilities::UnmapMemory(imageBufferMemory);
+	if (!decoded.loaded)
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		unsigned char* pixels = Utilities::LoadTextureFile(_fileName, &width, &height, &channels);
+		if (!pixels) return decoded;
+
+		texture.format = TextureFormat;
+		texture.width = static_cast<uint32_t>(width);
+		texture.height = static_cast<uint32_t>(height);
+		texture.levels.clear();
+		texture.levels.emplace_back(pixels, pixels + TextureCompression::GetLevelSize(TextureFormat, texture.width, texture.height));
+		Utilities::FreeImage(pixels);
 
-	Utilities::FreeImage(imageData);
+		decoded.mipLevels = _generateMipmaps ? TextureCompression::GetMipLevelCount(texture.width, texture.height) : 1;
+		decoded.loaded = true;
 
+		if (_buildMipChain) TextureCompression::BuildMipChain(texture, decoded.mipLevels);
+	}
+
+	decoded.width = texture.width;
+	decoded.height = texture.height;
+
+	// Streamed loads drop the levels above the first one they keep. Only stored levels can be dropped, and the file may
+	// have changed since the level was picked, so it's clamped to the chain that was loaded
+	const uint32_t firstLevel = std::min(_request.firstLevel == TailLevel ? GetTailLevel(decoded.width, decoded.height, decoded.mipLevels) : _request.firstLevel, static_cast<uint32_t>(texture.levels.size()) - 1);
+
+	texture.levels.erase(texture.levels.begin(), texture.levels.begin() + firstLevel);
+	texture.width = std::max(1u, decoded.width >> firstLevel);
+	texture.height = std::max(1u, decoded.height >> firstLevel);
+	decoded.firstLevel = firstLevel;
+	return decoded;
+}
+
+CustomImage VulkanTexture::CreateImage(const TextureData& _texture, const uint32_t _mipLevels)
+{
 	// Create texture image
 	VkExtent2D imageDimensions{};
-	imageDimensions.width = static_cast<uint32_t>(width);
-	imageDimensions.height = static_cast<uint32_t>(height);
+	imageDimensions.width = _texture.width;
+	imageDimensions.height = _texture.height;
+
+	// Levels missing from the texture are blitted, each one reads from the level above
+	const uint32_t storedLevels = static_cast<uint32_t>(_texture.levels.size());
+	// Streamed images may later have their kept levels copied out when levels are dropped
+	const bool blitMipmaps = _mipLevels > storedLevels;
+	const VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (blitMipmaps || s_Streaming ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
 
-	m_Texture = VulkanUtilities::CreateImage(imageDimensions, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	CustomImage texture = VulkanUtilities::CreateImage(imageDimensions, _texture.format, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _mipLevels);
 
 	// Transition layout of the image to be compatible for copy operation
-	VulkanUtilities::TransitionImageLayout(m_Texture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	VulkanUtilities::TransitionImageLayout(texture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, _mipLevels);
+
+	// Copy each stored level to the image through the staging ring, block compressed levels go in as they are
+	for (uint32_t level = 0; level < storedLevels; ++level)
+	{
+		VkExtent2D levelDimensions{};
+		levelDimensions.width = std::max(1u, _texture.width >> level);
+		levelDimensions.height = std::max(1u, _texture.height >> level);
+
+		const std::vector<unsigned char>& levelData = _texture.levels[level];
+		VulkanUtilities::UploadToImage(levelData.data(), static_cast<VkDeviceSize>(levelData.size()), texture.image, levelDimensions, level);
+	}
+
+	if (blitMipmaps)
+	{
+		// Leaves every level ready for shader reading
+		VulkanUtilities::GenerateMipmaps(texture.image, imageDimensions, _mipLevels);
+	}
+	else
+	{
+		// Transition layout of the image to be compatible for shader reading
+		VulkanUtilities::TransitionImageLayout(texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, _mipLevels);
+	}
+
+	CreateImageView(texture, _mipLevels);
+	return texture;
+}
+
+VulkanTexture::StreamUpload VulkanTexture::CopyLevels(const uint32_t _textureId, const uint32_t _firstLevel)
+{
+	const TextureSlot& slot = s_Textures[_textureId];
+	const uint32_t mipLevels = slot.mipLevels - _firstLevel;
 
-	// Copy image buffer data to image
-	VulkanUtilities::CopyBufferToImage(*imageStagingBuffer.pBuffer, m_Texture.image, { static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
+	VkExtent2D imageDimensions{};
+	imageDimensions.width = std::max(1u, slot.width >> _firstLevel);
+	imageDimensions.height = std::max(1u, slot.height >> _firstLevel);
+
+	StreamUpload upload{};
+	upload.textureId = _textureId;
+	upload.loadId = slot.loadId;
+	upload.format = slot.format;
+	upload.firstLevel = _firstLevel;
+	upload.image = VulkanUtilities::CreateImage(imageDimensions, slot.format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels);
 
-	// Transition layout of the image to be compatible for shader reading
-	VulkanUtilities::TransitionImageLayout(m_Texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	// The resident image holds the chain from residentLevel, so the kept levels start further into it
+	VulkanUtilities::TransitionImageLayout(upload.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, mipLevels);
+	VulkanUtilities::CopyImageLevels(slot.image.image, _firstLevel - slot.residentLevel, upload.image.image, imageDimensions, mipLevels);
 
-	VulkanUtilities::DestroyBuffer(*imageStagingBuffer.pBuffer, *imageStagingBuffer.pBufferMemory);
+	CreateImageView(upload.image, mipLevels);
+	return upload;
+}
 
-	// Create image view for the texture
-	VkImageViewCreateInfo imageViewCreateInfo = Vki::ImageViewCreateInfo(m_Texture.image, m_Texture.imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+void VulkanTexture::CreateImageView(CustomImage& _image, const uint32_t _mipLevels)
+{
+	VkImageViewCreateInfo imageViewCreateInfo = Vki::ImageViewCreateInfo(_image.image, _image.imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	imageViewCreateInfo.subresourceRange.levelCount = _mipLevels;
 
-	VkResult re = vkCreateImageView(*VulkanUtilities::GetDevice(), &imageViewCreateInfo, nullptr, &m_Texture.imageView);
+	VkResult re = vkCreateImageView(*VulkanUtilities::GetDevice(), &imageViewCreateInfo, nullptr, &_image.imageView);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create an image view\n");
+}
+
+void VulkanTexture::DestroySlot(const uint32_t _textureId)
+{
+	TextureSlot& slot = s_Textures[_textureId];
+
+	if (slot.state == TextureState::Uploading || slot.state == TextureState::Resident)
+	{
+		VulkanUtilities::DestroyImageView(slot.image.imageView);
+		VulkanUtilities::DestroyImage(slot.image.image, slot.image.imageMemory);
+	}
+
+	if (slot.state == TextureState::Resident && _textureId != PlaceholderTextureId) s_FreeDescriptors.emplace_back(slot.descriptor);
+
+	slot = TextureSlot{};
+}
+
+uint32_t VulkanTexture::AllocateDescriptor()
+{
+	if (!s_FreeDescriptors.empty())
+	{
+		const uint32_t descriptor = s_FreeDescriptors.back();
+		s_FreeDescriptors.pop_back();
+		return descriptor;
+	}
+
+	return s_DescriptorCount < s_Capacity ? s_DescriptorCount++ : InvalidDescriptor;
+}
+
+void VulkanTexture::WriteDescriptor(const uint32_t _descriptor, const VkImageView _imageView)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = _imageView;
+	imageInfo.sampler = VK_NULL_HANDLE;
+
+	VkWriteDescriptorSet descriptorWriter{};
+	descriptorWriter.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWriter.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	descriptorWriter.dstSet = s_DescriptorSet;
+	descriptorWriter.dstBinding = 0;
+	descriptorWriter.dstArrayElement = _descriptor;
+	descriptorWriter.descriptorCount = 1;
+	descriptorWriter.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(*VulkanUtilities::GetDevice(), 1, &descriptorWriter, 0, nullptr);
+}
+
+void VulkanTexture::Retire(const CustomImage& _image, const uint32_t _descriptor)
+{
+	// The element goes back on the free list with the image, frames recorded before the swap still sample both
+	const CustomImage image = _image;
+	auto destroy = [image, _descriptor]()
+	{
+		VulkanUtilities::DestroyImageView(image.imageView);
+		VulkanUtilities::DestroyImage(image.image, image.imageMemory);
+		s_FreeDescriptors.emplace_back(_descriptor);
+	};
+
+	if (s_DestroyAfterFrames) s_DestroyAfterFrames(destroy);
+	else destroy();
+}
+
+uint32_t VulkanTexture::GetTailLevel(const uint32_t _width, const uint32_t _height, const uint32_t _mipLevels)
+{
+	uint32_t level = 0;
+	while (level + 1 < _mipLevels && (std::max(_width, _height) >> level) > StreamingTailSize) ++level;
+	return level;
+}
+
+uint64_t VulkanTexture::GetLevelBytes(const TextureSlot& _slot, const uint32_t _firstLevel)
+{
+	return TextureCompression::GetChainSize(_slot.format, std::max(1u, _slot.width >> _firstLevel), std::max(1u, _slot.height >> _firstLevel), _slot.mipLevels - _firstLevel);
+}
+
+uint64_t VulkanTexture::GetStreamingBudget()
+{
+	// Textures can grow into whatever the device has spare past the headroom, on top of what they already hold. The
+	// configured budget caps that when it's set
+	const DeviceMemoryBudget memoryBudget = VulkanUtilities::GetDeviceMemoryBudget();
+	const double spareBytes = static_cast<double>(memoryBudget.budget) * (1.0 - BudgetHeadroom) - static_cast<double>(memoryBudget.usage);
+	const uint64_t allowance = static_cast<uint64_t>(std::max(0.0, static_cast<double>(GetResidentBytes()) + spareBytes));
+
+	return s_StreamingBudget > 0 ? std::min(allowance, s_StreamingBudget) : allowance;
+}
+
+void VulkanTexture::CleanUp()
+{
+	// Workers may still be decoding, their pixels have to come back before the lists are dropped
+	if (s_pJobSystem) s_pJobSystem->WaitForTasks();
+
+	for (const StreamUpload& upload : s_StreamUploads)
+	{
+		VulkanUtilities::WaitForUpload(upload.uploadTicket);
+		VulkanUtilities::DestroyImageView(upload.image.imageView);
+		VulkanUtilities::DestroyImage(upload.image.image, upload.image.imageMemory);
+	}
+
+	for (uint32_t textureId = 0; textureId < s_Textures.size(); ++textureId)
+	{
+		DestroySlot(textureId);
+	}
 
-	uint32_t textureId = s_TextureInstanceCount;
-	s_TextureDatabase.insert(std::pair(_fileName, textureId++));
-	return s_TextureInstanceCount++;
+	s_Textures.clear();
+	s_FreeSlots.clear();
+	s_FreeDescriptors.clear();
+	s_DescriptorCount = 0;
+	s_UploadingTextures.clear();
+	s_StreamUploads.clear();
+	s_TextureDatabase.clear();
+	s_DecodedTextures.clear();
+	s_pJobSystem = nullptr;
+	s_PendingCount = 0;
+	s_StreamingLoads = 0;
+	s_StreamingStats = TextureStreamingStats{};
+	s_DestroyAfterFrames = nullptr;
+	s_DescriptorSet = VK_NULL_HANDLE;
+	s_Capacity = 0;
+	s_CookedFormats.clear();
 }
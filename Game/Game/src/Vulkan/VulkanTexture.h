@@ -1,18 +1,177 @@
 #pragma once
 
 #include "VulkanUtilities.h"
+#include "../TextureCompression.h"
 #include <string>
 #include <map>
+#include <mutex>
+#include <functional>
 
+class JobSystem;
+
+struct TextureStreamingStats
+{
+	uint64_t budgetBytes = 0;		// Texture memory allowed at the last streaming update
+	uint32_t streamedLoads = 0;		// Loads that brought in finer levels, since startup
+	uint32_t evictions = 0;			// Copies (or loads) that dropped levels to stay within the budget
+};
+
+// Textures are drawn through elements of one bindless descriptor table, GetBoundSlot maps a texture id to its element.
+// An element is only written while no frame uses it, so loading a texture never touches other descriptors or the
+// recorded command buffers.
+// Files are decoded on the job system's workers and uploaded from Update on the render thread. Until a texture's
+// upload has finished it's drawn with the placeholder in element 0.
+// With streaming on only the small levels are uploaded at first. The renderer reports each texture's screen footprint
+// and UpdateStreaming reloads textures with finer levels to match it within the memory budget. Levels nothing needs are
+// dropped by copying the rest out of the resident image, only reloaded when uploads go through a transfer queue. The
+// new image goes into a free element and the old one is destroyed once the frames drawing it have completed.
+// Files cooked by TextureCooker are preferred over the source image, in the best format the device samples, and their
+// blocks and mip levels are uploaded as stored. Source images get a full mip chain, blitted on the GPU when uploads
+// share the graphics queue and the format can be linearly blitted, otherwise box filtered by the decoding worker
 class VulkanTexture
 {
 public:
+	static constexpr uint32_t PlaceholderTextureId = 0;
+
+	VulkanTexture();
+
+	// Adds a reference if the file is already loaded or loading, otherwise queues its decode and returns straight away
 	uint32_t CreateTextureImage(const std::string& _fileName);
-	CustomImage GetTextureData() const { return m_Texture; }
+	CustomImage GetTextureData() const { return s_Textures[m_TextureId].image; }
 	static std::map<std::string, uint32_t> GetTextureDatabase() { return s_TextureDatabase; };
 
+	// The renderer's update-after-bind texture set and the number of slots it was allocated with. Creates the placeholder
+	static void SetDescriptorTable(const VkDescriptorSet _descriptorSet, const uint32_t _capacity);
+	// Decodes run inline without one
+	static void SetJobSystem(JobSystem* _pJobSystem) { s_pJobSystem = _pJobSystem; }
+	// Off loads only the top level, set before any texture loads
+	static void SetGenerateMipmaps(const bool _generateMipmaps) { s_GenerateMipmaps = _generateMipmaps; }
+	// Off always decodes the source image, set before any texture loads
+	static void SetUseCookedTextures(const bool _useCookedTextures) { s_UseCookedTextures = _useCookedTextures; }
+	// Needs mipmaps, set before any texture loads. A budget of 0 leaves it to the device's memory budget
+	static void SetStreaming(const bool _streaming, const uint64_t _budgetBytes) { s_Streaming = _streaming; s_StreamingBudget = _budgetBytes; }
+	// Replaced images and descriptor elements are handed over here to be destroyed once no frame in flight uses them,
+	// they're destroyed straight away without one
+	static void SetDestroyAfterFrames(std::function<void(std::function<void()>&&)> _destroyAfterFrames) { s_DestroyAfterFrames = std::move(_destroyAfterFrames); }
+	// Uploads decoded textures and binds those whose upload finished, returns how many were bound to a new element
+	static uint32_t Update();
+	// Blocks until every queued texture is resident
+	static void WaitForLoads();
+	// The slot to draw a texture with this frame
+	static uint32_t GetBoundSlot(const uint32_t _textureId) { return s_Textures[_textureId].state == TextureState::Resident ? s_Textures[_textureId].descriptor : PlaceholderTextureId; }
+	static bool IsStreaming() { return s_Streaming; }
+	// An object using the texture covers this many pixels per repeat of its UVs. The finest level asked for since the last
+	// UpdateStreaming is the one it streams towards
+	static void RequestFootprint(const uint32_t _textureId, const float _pixelsPerRepeat);
+	// Queues loads for textures whose needed level changed, evicting the least recently needed levels when over budget
+	static void UpdateStreaming();
+	static TextureStreamingStats GetStreamingStats() { return s_StreamingStats; }
+	static void AddReference(const uint32_t _textureId);
+	// Destroys the texture when the last reference goes, the caller makes sure the GPU is no longer sampling it
+	static void Release(const uint32_t _textureId);
+	static uint32_t GetLoadedCount();
+	static uint32_t GetPendingCount() { return s_PendingCount; }
+	static uint64_t GetResidentBytes();		// Texel bytes of every resident texture's levels, placeholder included
+	static uint32_t GetCompressedCount();	// Resident textures stored block compressed
+	static bool BlitsMipmaps() { return s_BlitMipmaps; }
+	static const std::vector<VkFormat>& GetCookedFormats() { return s_CookedFormats; }
+	static void CleanUp();
+
 private:
-	CustomImage m_Texture;
-	static uint32_t s_TextureInstanceCount;
+	enum class TextureState
+	{
+		Free,
+		Decoding,
+		Uploading,
+		Resident
+	};
+
+	struct TextureSlot
+	{
+		CustomImage image{};
+		std::string fileName;
+		uint32_t refCount = 0;
+		uint32_t descriptor = PlaceholderTextureId;		// Table element, valid once resident
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;								// Of the file's top level, the image may start further down
+		uint32_t height = 0;
+		uint32_t mipLevels = 1;							// Levels in the whole chain
+		uint32_t residentLevel = 0;						// First level of the chain the image holds
+		uint64_t byteSize = 0;
+		TextureState state = TextureState::Free;
+		UploadTicket uploadTicket = 0;
+		uint64_t loadId = 0;							// Tells stale stream loads apart once the slot is released or reused
+		bool streaming = false;							// A load for streamLevel is in flight
+		uint32_t streamLevel = 0;
+		uint32_t requestedLevel = UINT32_MAX;			// Finest level asked for since the last streaming update
+		uint64_t lastRequested = 0;						// Streaming update the texture was last asked for in
+	};
+
+	// A reloaded texture being uploaded next to the image that's still drawn
+	struct StreamUpload
+	{
+		uint32_t textureId = 0;
+		uint64_t loadId = 0;
+		CustomImage image{};
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t firstLevel = 0;
+		UploadTicket uploadTicket = 0;
+	};
+
+	// Written by the decoding worker, picked up by Update
+	struct DecodedTexture
+	{
+		uint32_t textureId = 0;
+		uint64_t loadId = 0;
+		bool streamed = false;		// A reload of a resident texture rather than its first load
+		bool loaded = false;
+		TextureData texture;		// Levels from firstLevel down, sized as firstLevel
+		uint32_t width = 0;			// Of the file's top level
+		uint32_t height = 0;
+		uint32_t firstLevel = 0;
+		uint32_t mipLevels = 1;		// Levels in the whole chain, those past the ones in texture are blitted on the GPU
+	};
+
+	static constexpr uint32_t TailLevel = UINT32_MAX;		// Asks Decode for the first level streaming keeps resident
+	static constexpr uint32_t InvalidDescriptor = UINT32_MAX;
+
+	static void QueueLoad(const uint32_t _textureId, const uint32_t _firstLevel, const bool _streamed);
+	static DecodedTexture Decode(const DecodedTexture& _request, const std::string& _fileName, const std::vector<VkFormat>& _cookedFormats, const bool _generateMipmaps, const bool _buildMipChain);
+	static CustomImage CreateImage(const TextureData& _texture, const uint32_t _mipLevels);
+	static StreamUpload CopyLevels(const uint32_t _textureId, const uint32_t _firstLevel);		// Smaller image from the resident one
+	static void CreateImageView(CustomImage& _image, const uint32_t _mipLevels);
+	static void DestroySlot(const uint32_t _textureId);
+	static uint32_t AllocateDescriptor();
+	static void WriteDescriptor(const uint32_t _descriptor, const VkImageView _imageView);
+	static void Retire(const CustomImage& _image, const uint32_t _descriptor);
+	static uint32_t GetTailLevel(const uint32_t _width, const uint32_t _height, const uint32_t _mipLevels);
+	static uint64_t GetLevelBytes(const TextureSlot& _slot, const uint32_t _firstLevel);		// Chain size from _firstLevel down
+	static uint64_t GetStreamingBudget();
+
+	uint32_t m_TextureId;
+	static std::vector<TextureSlot> s_Textures;				// Indexed by texture id
+	static std::vector<uint32_t> s_FreeSlots;
+	static std::vector<uint32_t> s_FreeDescriptors;			// Table elements below s_DescriptorCount not bound to a texture
+	static uint32_t s_DescriptorCount;
+	static std::vector<uint32_t> s_UploadingTextures;
+	static std::vector<StreamUpload> s_StreamUploads;
 	static std::map<std::string, uint32_t> s_TextureDatabase;
+	static std::vector<DecodedTexture> s_DecodedTextures;		// Guarded by s_DecodedMutex
+	static std::mutex s_DecodedMutex;
+	static JobSystem* s_pJobSystem;
+	static uint32_t s_PendingCount;							// Decoding or uploading
+	static uint64_t s_NextLoadId;
+	static bool s_GenerateMipmaps;
+	static bool s_UseCookedTextures;
+	static bool s_Streaming;
+	static uint64_t s_StreamingBudget;
+	static uint64_t s_StreamingUpdate;						// Counts UpdateStreaming calls, for least recently needed order
+	static uint32_t s_StreamingLoads;						// Stream loads decoding or uploading
+	static TextureStreamingStats s_StreamingStats;
+	static std::function<void(std::function<void()>&&)> s_DestroyAfterFrames;
+	static std::vector<VkFormat> s_CookedFormats;			// Cooked formats the device samples, best first
+	static bool s_BlitMipmaps;								// Decided once the device is known, see SetDescriptorTable
+	static bool s_CopyEvictions;							// Dropped levels are copied out of the resident image rather than reloaded
+	static VkDescriptorSet s_DescriptorSet;
+	static uint32_t s_Capacity;
 };
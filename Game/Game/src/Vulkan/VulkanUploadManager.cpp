@@ -0,0 +1,336 @@
+#include "VulkanUploadManager.h"
+#include "VulkanDevice.h"
+#include "VulkanInit.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+VulkanUploadManager::VulkanUploadManager() :
+	m_MainDevice(nullptr),
+	m_Queue(VK_NULL_HANDLE),
+	m_CommandPool(VK_NULL_HANDLE),
+	m_UsesTransferQueue(false),
+	m_IsRecording(false),
+	m_RecordingBatch{},
+	m_InFlightBatches{},
+	m_FreeBatches{},
+	m_NextTicket(1),
+	m_CompletedTicket(0)
+{}
+
+void VulkanUploadManager::Init(const MainDevice* _mainDevice)
+{
+	m_MainDevice = _mainDevice;
+
+	// Prefer the dedicated transfer queue so uploads overlap with rendering
+	m_UsesTransferQueue = m_MainDevice->queueFamilyIndices.HasDedicatedTransfer();
+	m_Queue = m_UsesTransferQueue ? m_MainDevice->transferQueue : m_MainDevice->graphicsQueue;
+
+	const uint32_t queueFamily = m_UsesTransferQueue ? m_MainDevice->queueFamilyIndices.transferFamily : m_MainDevice->queueFamilyIndices.graphicsFamily;
+
+	VkCommandPoolCreateInfo commandPoolInfo = Vki::CommandPoolCreateInfo(queueFamily);
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkResult re = vkCreateCommandPool(m_MainDevice->device, &commandPoolInfo, nullptr, &m_CommandPool);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create upload command pool\n");
+}
+
+void VulkanUploadManager::CleanUp()
+{
+	if (m_IsRecording) Flush();
+	Wait(m_NextTicket - 1);
+
+	for (const auto& batch : m_FreeBatches)
+	{
+		vkDestroyFence(m_MainDevice->device, batch.fence, nullptr);
+	}
+
+	m_FreeBatches.clear();
+	vkDestroyCommandPool(m_MainDevice->device, m_CommandPool, nullptr);
+}
+
+void VulkanUploadManager::CopyBuffer(const VkBuffer& _srcBuffer, const VkBuffer& _dstBuffer, const VkBufferCopy& _region)
+{
+	vkCmdCopyBuffer(GetRecordingCommandBuffer(), _srcBuffer, _dstBuffer, 1, &_region);
+}
+
+void VulkanUploadManager::CopyBufferToImage(const VkBuffer& _srcBuffer, const VkImage& _dstImage, const VkBufferImageCopy& _region)
+{
+	vkCmdCopyBufferToImage(GetRecordingCommandBuffer(), _srcBuffer, _dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &_region);
+}
+
+void VulkanUploadManager::TransitionImageLayout(const VkImage& _image, const VkImageLayout& _oldLayout, const VkImageLayout& _newLayout, const VkPipelineStageFlags _startStage, const VkPipelineStageFlags _endStage, const uint32_t _mipLevels)
+{
+	VkImageMemoryBarrier imageMemoryBarrier{};
+	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageMemoryBarrier.oldLayout = _oldLayout;										// Layout to transition from
+	imageMemoryBarrier.newLayout = _newLayout;										// Layout to transition to
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;				// Queue family to transition from
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;				// Queue family to transition to
+	imageMemoryBarrier.image = _image;												// Image to be modified by memory barrier
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;		// Aspect of image being altered
+	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;							// First mip level to start alterations on
+	imageMemoryBarrier.subresourceRange.levelCount = _mipLevels;					// Number of mip levels to alter starting from baseMipLevel
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;							// First layer to start alterations on
+	imageMemoryBarrier.subresourceRange.layerCount = 1;								// Number of layers to alter starting from base baseArrayLayer
+
+	if (_oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && _newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	{
+		imageMemoryBarrier.srcAccessMask = 0;								// Memory access stage transition must happen after...
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;	// Memory access stage transition must happen before...
+	}
+	else if (_oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && _newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		// Shader reads can't be expressed on a transfer queue, the batch fence makes the writes visible instead
+		imageMemoryBarrier.dstAccessMask = m_UsesTransferQueue ? 0 : VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	vkCmdPipelineBarrier
+	(
+		GetRecordingCommandBuffer(),
+		ClampStages(_startStage), ClampStages(_endStage),	// Pipeline stages (match to src and dst AccessMasks)
+		0,													// Dependency flags
+		0, nullptr,											// Memory Barrier count + data
+		0, nullptr,											// Buffer Memory Barrier count + data
+		1, &imageMemoryBarrier								// Image Memory Barrier count + data
+	);
+}
+
+void VulkanUploadManager::GenerateMipmaps(const VkImage& _image, const VkExtent2D& _dimensions, const uint32_t _mipLevels)
+{
+	if (m_UsesTransferQueue) throw std::runtime_error("VULKAN ERROR: Mipmaps can't be blitted on a transfer queue\n");
+
+	const VkCommandBuffer commandBuffer = GetRecordingCommandBuffer();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	int32_t mipWidth = static_cast<int32_t>(_dimensions.width);
+	int32_t mipHeight = static_cast<int32_t>(_dimensions.height);
+
+	for (uint32_t level = 1; level < _mipLevels; ++level)
+	{
+		// The level above has finished being written (copied or blitted into), read it as the blit source
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		const int32_t nextWidth = std::max(1, mipWidth / 2);
+		const int32_t nextHeight = std::max(1, mipHeight / 2);
+
+		VkImageBlit blit{};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		vkCmdBlitImage(commandBuffer, _image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		// Done as a source, hand it to the fragment shader
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	// The last level was only ever written
+	barrier.subresourceRange.baseMipLevel = _mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void VulkanUploadManager::CopyImageLevels(const VkImage& _srcImage, const uint32_t _srcFirstLevel, const VkImage& _dstImage, const VkExtent2D& _dstDimensions, const uint32_t _levelCount)
+{
+	if (m_UsesTransferQueue) throw std::runtime_error("VULKAN ERROR: Images in use can't be copied on a transfer queue\n");
+
+	const VkCommandBuffer commandBuffer = GetRecordingCommandBuffer();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _srcImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, _srcFirstLevel, _levelCount, 0, 1 };
+
+	// Frames submitted before the batch may still be sampling the source, the copy waits for them
+	barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkImageCopy> regions(_levelCount);
+
+	for (uint32_t level = 0; level < _levelCount; ++level)
+	{
+		regions[level].srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, _srcFirstLevel + level, 0, 1 };
+		regions[level].dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		regions[level].extent = { std::max(1u, _dstDimensions.width >> level), std::max(1u, _dstDimensions.height >> level), 1 };
+	}
+
+	vkCmdCopyImage(commandBuffer, _srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, _levelCount, regions.data());
+
+	// Back to the frames drawing with it until the copy replaces it
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	barrier.image = _dstImage;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void VulkanUploadManager::ReleaseAfterUpload(const std::function<void()>& _release)
+{
+	GetRecordingCommandBuffer();
+	m_RecordingBatch.releases.emplace_back(_release);
+}
+
+UploadTicket VulkanUploadManager::Flush()
+{
+	RetireCompletedBatches();
+
+	if (!m_IsRecording)
+	{
+		// Nothing recorded since the last flush, so everything handed out so far is covered by the previous ticket
+		return m_NextTicket - 1;
+	}
+
+	VkResult re = vkEndCommandBuffer(m_RecordingBatch.commandBuffer);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to record upload command buffer\n");
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &m_RecordingBatch.commandBuffer;
+
+	re = vkQueueSubmit(m_Queue, 1, &submitInfo, m_RecordingBatch.fence);
+	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to submit upload command buffer\n");
+
+	const UploadTicket ticket = m_NextTicket++;
+	m_RecordingBatch.ticket = ticket;
+	m_InFlightBatches.emplace_back(std::move(m_RecordingBatch));
+	m_RecordingBatch = UploadBatch{};
+	m_IsRecording = false;
+
+	return ticket;
+}
+
+bool VulkanUploadManager::IsComplete(const UploadTicket _ticket)
+{
+	RetireCompletedBatches();
+	return _ticket <= m_CompletedTicket;
+}
+
+void VulkanUploadManager::Wait(const UploadTicket _ticket)
+{
+	// Waiting on the batch still being recorded means it has to go out first
+	if (_ticket >= m_NextTicket && m_IsRecording) Flush();
+
+	for (const auto& batch : m_InFlightBatches)
+	{
+		if (batch.ticket > _ticket) break;
+
+		vkWaitForFences(m_MainDevice->device, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+
+	RetireCompletedBatches();
+}
+
+UploadTicket VulkanUploadManager::GetPendingTicket()
+{
+	// Opening the batch guarantees the ticket is submitted on the next flush even if nothing else is recorded
+	GetRecordingCommandBuffer();
+	return m_NextTicket;
+}
+
+VkCommandBuffer VulkanUploadManager::GetRecordingCommandBuffer()
+{
+	if (m_IsRecording) return m_RecordingBatch.commandBuffer;
+
+	if (!m_FreeBatches.empty())
+	{
+		m_RecordingBatch = std::move(m_FreeBatches.back());
+		m_FreeBatches.pop_back();
+
+		vkResetFences(m_MainDevice->device, 1, &m_RecordingBatch.fence);
+		vkResetCommandBuffer(m_RecordingBatch.commandBuffer, 0);
+	}
+	else
+	{
+		VkCommandBufferAllocateInfo bufferAllocateInfo = Vki::AllocateCommandBuffer(m_CommandPool, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+		VkResult re = vkAllocateCommandBuffers(m_MainDevice->device, &bufferAllocateInfo, &m_RecordingBatch.commandBuffer);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate upload command buffer\n");
+
+		VkFenceCreateInfo fenceCreateInfo{};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		re = vkCreateFence(m_MainDevice->device, &fenceCreateInfo, nullptr, &m_RecordingBatch.fence);
+		if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create upload fence\n");
+	}
+
+	VkCommandBufferBeginInfo bufferBeginInfo{};
+	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(m_RecordingBatch.commandBuffer, &bufferBeginInfo);
+	m_IsRecording = true;
+
+	return m_RecordingBatch.commandBuffer;
+}
+
+void VulkanUploadManager::RetireCompletedBatches()
+{
+	// Batches on one queue complete in submission order, so stop at the first one still running
+	while (!m_InFlightBatches.empty())
+	{
+		UploadBatch& batch = m_InFlightBatches.front();
+
+		if (vkGetFenceStatus(m_MainDevice->device, batch.fence) != VK_SUCCESS) break;
+
+		for (const auto& release : batch.releases)
+		{
+			release();
+		}
+
+		batch.releases.clear();
+		m_CompletedTicket = batch.ticket;
+		m_FreeBatches.emplace_back(std::move(batch));
+		m_InFlightBatches.erase(m_InFlightBatches.begin());
+	}
+}
+
+VkPipelineStageFlags VulkanUploadManager::ClampStages(const VkPipelineStageFlags _stages) const
+{
+	if (!m_UsesTransferQueue) return _stages;
+
+	// Transfer queues only support these stages, anything graphics related becomes ALL_COMMANDS
+	const VkPipelineStageFlags transferStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT;
+
+	return (_stages & ~transferStages) ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT) : _stages;
+}
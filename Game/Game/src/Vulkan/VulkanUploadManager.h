@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+
+struct MainDevice;
+
+typedef uint64_t UploadTicket;
+
+// Records copies and layout transitions into a shared command buffer and submits them as one batch.
+// Each batch is tagged with a ticket that callers can poll or wait on instead of stalling the queue.
+class VulkanUploadManager
+{
+public:
+	VulkanUploadManager();
+
+	void Init(const MainDevice* _mainDevice);
+	void CleanUp();
+	void CopyBuffer(const VkBuffer& _srcBuffer, const VkBuffer& _dstBuffer, const VkBufferCopy& _region);
+	void CopyBufferToImage(const VkBuffer& _srcBuffer, const VkImage& _dstImage, const VkBufferImageCopy& _region);
+	void TransitionImageLayout(const VkImage& _image, const VkImageLayout& _oldLayout, const VkImageLayout& _newLayout, const VkPipelineStageFlags _startStage, const VkPipelineStageFlags _endStage, const uint32_t _mipLevels = 1);
+	// Blits each level from the one above, every level must be in TRANSFER_DST and level 0 filled. Leaves them all in
+	// SHADER_READ_ONLY. Blits need a graphics queue, only valid when UsesTransferQueue is false
+	void GenerateMipmaps(const VkImage& _image, const VkExtent2D& _dimensions, const uint32_t _mipLevels);
+	// Copies _levelCount levels from _srcFirstLevel of an image frames may be sampling into the top levels of _dstImage.
+	// The source stays in SHADER_READ_ONLY either side, the destination goes from TRANSFER_DST to SHADER_READ_ONLY. Only
+	// valid when UsesTransferQueue is false, the same queue orders the copy against the frames reading the source
+	void CopyImageLevels(const VkImage& _srcImage, const uint32_t _srcFirstLevel, const VkImage& _dstImage, const VkExtent2D& _dstDimensions, const uint32_t _levelCount);
+	void ReleaseAfterUpload(const std::function<void()>& _release);
+	UploadTicket Flush();
+	bool IsComplete(const UploadTicket _ticket);
+	void Wait(const UploadTicket _ticket);
+	UploadTicket GetPendingTicket();
+	bool UsesTransferQueue() const { return m_UsesTransferQueue; }
+
+private:
+	struct UploadBatch
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		UploadTicket ticket = 0;
+		std::vector<std::function<void()>> releases;	// Run once the batch has finished executing
+	};
+
+	VkCommandBuffer GetRecordingCommandBuffer();
+	void RetireCompletedBatches();
+	VkPipelineStageFlags ClampStages(const VkPipelineStageFlags _stages) const;
+
+private:
+	const MainDevice* m_MainDevice;
+	VkQueue m_Queue;
+	VkCommandPool m_CommandPool;
+	bool m_UsesTransferQueue;
+	bool m_IsRecording;
+	UploadBatch m_RecordingBatch;
+	std::vector<UploadBatch> m_InFlightBatches;		// Submitted batches in submission order
+	std::vector<UploadBatch> m_FreeBatches;			// Retired batches whose command buffer and fence can be reused
+	UploadTicket m_NextTicket;
+	UploadTicket m_CompletedTicket;
+};
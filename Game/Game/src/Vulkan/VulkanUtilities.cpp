@@ -2,13 +2,30 @@
 #include "VulkanDevice.h"
 #include "VulkanInit.h"
 #include "VulkanSwapchain.h"
+#include <algorithm>
 #include <stdexcept>
 
+#define StagingRingSize (32ull * 1024 * 1024)
+
 const MainDevice* VulkanUtilities::m_MainDevice = nullptr;
+VulkanMemoryAllocator VulkanUtilities::m_MemoryAllocator{};
+VulkanUploadManager VulkanUtilities::m_UploadManager{};
+VulkanStagingRing VulkanUtilities::m_StagingRing{};
 
 void VulkanUtilities::Initialize(const MainDevice* _mainDevice)
 {
 	m_MainDevice = _mainDevice;
+	m_MemoryAllocator.Init(_mainDevice);
+	m_UploadManager.Init(_mainDevice);
+	m_StagingRing.Init(&m_UploadManager, StagingRingSize);
+}
+
+void VulkanUtilities::CleanUp()
+{
+	// Pending uploads still own staging buffers, release them before the memory blocks go
+	m_UploadManager.CleanUp();
+	m_StagingRing.CleanUp();
+	m_MemoryAllocator.CleanUp();
 }
 
 void VulkanUtilities::CheckRequiredInstanceExtensions(const std::vector<const char*>& _requiredInstanceExtensions)
@@ -84,6 +101,18 @@ uint32_t VulkanUtilities::FindMemoryIndex(const uint32_t _memoryTypeBits, const
 	throw std::runtime_error("VULKAN ERROR: Failed to find memory index\n");
 }
 
+VkDeviceSize VulkanUtilities::PadUniformBufferSize(const VkDeviceSize _size)
+{
+	const VkDeviceSize alignment = m_MainDevice->physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+	return alignment > 0 ? (_size + alignment - 1) / alignment * alignment : _size;
+}
+
+VkDeviceSize VulkanUtilities::PadStorageBufferSize(const VkDeviceSize _size)
+{
+	const VkDeviceSize alignment = m_MainDevice->physicalDeviceProperties.limits.minStorageBufferOffsetAlignment;
+	return alignment > 0 ? (_size + alignment - 1) / alignment * alignment : _size;
+}
+
 VkShaderModule VulkanUtilities::CreateShaderModule(const std::vector<char>& _shaderCode)
 {
 	VkShaderModuleCreateInfo shaderModuleCreateInfo = Vki::ShaderModuleCreateInfo(_shaderCode);
@@ -95,11 +124,10 @@ VkShaderModule VulkanUtilities::CreateShaderModule(const std::vector<char>& _sha
 	return shaderModule;
 }
 
-CustomImage VulkanUtilities::CreateImage(const VkExtent2D& _dimensions, const VkFormat _format, const VkImageUsageFlags _usage, const VkMemoryPropertyFlags _memoryProperty)
+CustomImage VulkanUtilities::CreateImage(const VkExtent2D& _dimensions, const VkFormat _format, const VkImageUsageFlags _usage, const VkMemoryPropertyFlags _memoryProperty, const uint32_t _mipLevels)
 {
 	CustomImage customImage{};
 	customImage.image = VK_NULL_HANDLE;
-	customImage.imageMemory = VK_NULL_HANDLE;
 	customImage.imageView = VK_NULL_HANDLE;
 	customImage.imageFormat = _format;
 
@@ -108,7 +136,7 @@ CustomImage VulkanUtilities::CreateImage(const VkExtent2D& _dimensions, const Vk
 	imageCreateInfo.extent.width = _dimensions.width;				// Width of image extent
 	imageCreateInfo.extent.height = _dimensions.height;				// Height of image extent
 	imageCreateInfo.extent.depth = 1;								// Depth of image (just 1, no 3D aspect)
-	imageCreateInfo.mipLevels = 1;									// Number of mipmap levels
+	imageCreateInfo.mipLevels = _mipLevels;							// Number of mipmap levels
 	imageCreateInfo.arrayLayers = 1;								// Number of levels in image array
 	imageCreateInfo.format = _format;								// Format type of the image
 	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;		// Layout of image data on creation
@@ -116,6 +144,7 @@ CustomImage VulkanUtilities::CreateImage(const VkExtent2D& _dimensions, const Vk
 	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;				// How image data should be "tiled" (arranged for optimal reading)
 	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;				// Number of samples for multisampling		
 	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;		// Whether image can be shared between queues
+	SetUploadSharingMode(_usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageCreateInfo.sharingMode, imageCreateInfo.queueFamilyIndexCount, imageCreateInfo.pQueueFamilyIndices);
 
 	VkResult re = vkCreateImage(m_MainDevice->device, &imageCreateInfo, nullptr, &customImage.image);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create image\n");
@@ -123,16 +152,12 @@ CustomImage VulkanUtilities::CreateImage(const VkExtent2D& _dimensions, const Vk
 	VkMemoryRequirements memoryRequirements{};
 	vkGetImageMemoryRequirements(m_MainDevice->device, customImage.image, &memoryRequirements);
 
-	VkMemoryAllocateInfo memoryAllocInfo{};
-	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memoryAllocInfo.allocationSize = memoryRequirements.size;
-	memoryAllocInfo.memoryTypeIndex = VulkanUtilities::FindMemoryIndex(memoryRequirements.memoryTypeBits, _memoryProperty);
-
-	re = vkAllocateMemory(m_MainDevice->device, &memoryAllocInfo, nullptr, &customImage.imageMemory);
-	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate memory for image\n");
+	// Optimal tiling images are kept apart from linear resources (bufferImageGranularity)
+	const uint32_t memoryTypeIndex = FindMemoryIndex(memoryRequirements.memoryTypeBits, _memoryProperty);
+	customImage.imageMemory = m_MemoryAllocator.Allocate(memoryRequirements, memoryTypeIndex, false);
 
 	// Connect memory to image
-	vkBindImageMemory(m_MainDevice->device, customImage.image, customImage.imageMemory, 0);
+	vkBindImageMemory(m_MainDevice->device, customImage.image, customImage.imageMemory.memory, customImage.imageMemory.offset);
 
 	return customImage;
 }
@@ -199,6 +224,7 @@ void VulkanUtilities::SubmitCommandBuffer(VkCommandBuffer* _commandBuffer)
 void VulkanUtilities::CreateBuffer(BufferInfo& _bufferInfo)
 {
 	VkBufferCreateInfo bufferCreateInfo = Vki::BufferCreateInfo(_bufferInfo.bufferUsage, _bufferInfo.bufferSize);
+	SetUploadSharingMode(_bufferInfo.bufferUsage & VK_BUFFER_USAGE_TRANSFER_DST_BIT, bufferCreateInfo.sharingMode, bufferCreateInfo.queueFamilyIndexCount, bufferCreateInfo.pQueueFamilyIndices);
 
 	VkResult re = vkCreateBuffer(m_MainDevice->device, &bufferCreateInfo, nullptr, _bufferInfo.pBuffer);
 	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to create buffer\n");
@@ -207,25 +233,101 @@ void VulkanUtilities::CreateBuffer(BufferInfo& _bufferInfo)
 	vkGetBufferMemoryRequirements(m_MainDevice->device, *_bufferInfo.pBuffer, &memoryRequirements);
 
 	const uint32_t memoryTypeIndex = FindMemoryIndex(memoryRequirements.memoryTypeBits, _bufferInfo.memoryProperties);
-	VkMemoryAllocateInfo memoryAllocation = Vki::AllocateMemoryInfo(memoryRequirements.size, memoryTypeIndex);
-
-	re = vkAllocateMemory(m_MainDevice->device, &memoryAllocation, nullptr, _bufferInfo.pBufferMemory);
-	if (re != VK_SUCCESS) throw std::runtime_error("VULKAN ERROR: Failed to allocate buffer memory\n");
+	*_bufferInfo.pBufferMemory = m_MemoryAllocator.Allocate(memoryRequirements, memoryTypeIndex, true);
 
 	// Connect memory to buffer
-	vkBindBufferMemory(m_MainDevice->device, *_bufferInfo.pBuffer, *_bufferInfo.pBufferMemory, 0);
+	vkBindBufferMemory(m_MainDevice->device, *_bufferInfo.pBuffer, _bufferInfo.pBufferMemory->memory, _bufferInfo.pBufferMemory->offset);
 }
 
-void VulkanUtilities::DestroyBuffer(const VkBuffer& _buffer, const VkDeviceMemory& _bufferMemory)
+void VulkanUtilities::DestroyBuffer(const VkBuffer& _buffer, const MemoryAllocation& _bufferMemory)
 {
 	vkDestroyBuffer(m_MainDevice->device, _buffer, nullptr);
-	vkFreeMemory(m_MainDevice->device, _bufferMemory, nullptr);
+	m_MemoryAllocator.Free(_bufferMemory);
 }
 
-void VulkanUtilities::DestroyImage(const VkImage& _image, const VkDeviceMemory& _imageMemory)
+void VulkanUtilities::DestroyBufferAfterUpload(const VkBuffer& _buffer, const MemoryAllocation& _bufferMemory)
+{
+	// Staging buffers are read by the pending upload batch, so they live until its fence signals
+	const VkBuffer buffer = _buffer;
+	const MemoryAllocation bufferMemory = _bufferMemory;
+	m_UploadManager.ReleaseAfterUpload([buffer, bufferMemory]() { DestroyBuffer(buffer, bufferMemory); });
+}
+
+void VulkanUtilities::SetUploadSharingMode(const bool _isUploadTarget, VkSharingMode& _sharingMode, uint32_t& _queueFamilyIndexCount, const uint32_t*& _pQueueFamilyIndices)
+{
+	if (!_isUploadTarget || !m_UploadManager.UsesTransferQueue()) return;
+
+	// Written on the transfer queue and read on the graphics queue without ownership transfers
+	static uint32_t queueFamilyIndices[2];
+	queueFamilyIndices[0] = static_cast<uint32_t>(m_MainDevice->queueFamilyIndices.graphicsFamily);
+	queueFamilyIndices[1] = static_cast<uint32_t>(m_MainDevice->queueFamilyIndices.transferFamily);
+
+	_sharingMode = VK_SHARING_MODE_CONCURRENT;
+	_queueFamilyIndexCount = 2;
+	_pQueueFamilyIndices = queueFamilyIndices;
+}
+
+void VulkanUtilities::DestroyImage(const VkImage& _image, const MemoryAllocation& _imageMemory)
 {
 	vkDestroyImage(m_MainDevice->device, _image, nullptr);
-	vkFreeMemory(m_MainDevice->device, _imageMemory, nullptr);
+	m_MemoryAllocator.Free(_imageMemory);
+}
+
+MemoryStats VulkanUtilities::GetMemoryStats()
+{
+	return m_MemoryAllocator.GetStats();
+}
+
+DeviceMemoryBudget VulkanUtilities::GetDeviceMemoryBudget()
+{
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	if (m_MainDevice->memoryBudget) memoryProperties.pNext = &budgetProperties;
+	vkGetPhysicalDeviceMemoryProperties2(m_MainDevice->physicalDevice, &memoryProperties);
+
+	DeviceMemoryBudget memoryBudget{};
+
+	for (uint32_t heap = 0; heap < memoryProperties.memoryProperties.memoryHeapCount; ++heap)
+	{
+		const VkMemoryHeap& memoryHeap = memoryProperties.memoryProperties.memoryHeaps[heap];
+		if (!(memoryHeap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+
+		memoryBudget.budget += m_MainDevice->memoryBudget ? budgetProperties.heapBudget[heap] : memoryHeap.size;
+		memoryBudget.usage += m_MainDevice->memoryBudget ? budgetProperties.heapUsage[heap] : 0;
+	}
+
+	// Without the extension only this process's own device memory is known, and every heap is assumed to be its alone
+	if (!m_MainDevice->memoryBudget) memoryBudget.usage = m_MemoryAllocator.GetStats().bytesAllocated;
+
+	return memoryBudget;
+}
+
+UploadTicket VulkanUtilities::FlushUploads()
+{
+	return m_UploadManager.Flush();
+}
+
+bool VulkanUtilities::IsUploadComplete(const UploadTicket _ticket)
+{
+	return m_UploadManager.IsComplete(_ticket);
+}
+
+void VulkanUtilities::WaitForUpload(const UploadTicket _ticket)
+{
+	m_UploadManager.Wait(_ticket);
+}
+
+StagingStats VulkanUtilities::GetStagingStats()
+{
+	return m_StagingRing.GetStats();
+}
+
+void VulkanUtilities::EndStagingFrame()
+{
+	m_StagingRing.EndFrame();
 }
 
 void VulkanUtilities::DestroyImageView(const VkImageView& _imageView)
@@ -235,28 +337,19 @@ void VulkanUtilities::DestroyImageView(const VkImageView& _imageView)
 
 void VulkanUtilities::CopyBuffer(VkBuffer& _srcBuffer, VkBuffer& _dstBuffer, const VkDeviceSize& _bufferSize)
 {
-	VkCommandBuffer transferCommandBuffer{};
-	BeginCommandBuffer(&transferCommandBuffer);
-
 	// Copy buffer - buffer 
 	// Configure buffer region to copy to
 	VkBufferCopy bufferRegion{};
 	bufferRegion.srcOffset = 0;			// Start copying from start of source buffer
 	bufferRegion.dstOffset = 0;			// Start pasting to start of destination buffer
 	bufferRegion.size = _bufferSize;	// Size of the buffer to copy
-	vkCmdCopyBuffer(transferCommandBuffer, _srcBuffer, _dstBuffer, 1, &bufferRegion);
-
-	EndCommandBuffer(&transferCommandBuffer);
-	SubmitCommandBuffer(&transferCommandBuffer);
 
-	vkFreeCommandBuffers(m_MainDevice->device, *m_MainDevice->queueFamilyIndices.commandPool, 1, &transferCommandBuffer);
+	// Recorded into the current upload batch, submitted on the next FlushUploads
+	m_UploadManager.CopyBuffer(_srcBuffer, _dstBuffer, bufferRegion);
 }
 
 void VulkanUtilities::CopyBufferToImage(VkBuffer& _srcBuffer, VkImage& _dstImage, const VkExtent2D& _imageDimensions)
 {
-	VkCommandBuffer transferCommandBuffer{};
-	BeginCommandBuffer(&transferCommandBuffer);
-
 	// Copy buffer - image
 	// Configure image region to copy to
 	VkBufferImageCopy imageRegion{};
@@ -269,7 +362,61 @@ void VulkanUtilities::CopyBufferToImage(VkBuffer& _srcBuffer, VkImage& _dstImage
 	imageRegion.imageSubresource.layerCount = 1;										// Number of layers to copy starting at base array later
 	imageRegion.imageOffset = { 0, 0, 0 };												// Offset into image (as opposed to raw data in buffer offset)
 	imageRegion.imageExtent = { _imageDimensions.width, _imageDimensions.height, 1 };	// Size of region to copy as (x, y, z) values
-	vkCmdCopyBufferToImage(transferCommandBuffer, _srcBuffer, _dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+
+	m_UploadManager.CopyBufferToImage(_srcBuffer, _dstImage, imageRegion);
+}
+
+void VulkanUtilities::UploadToBuffer(const void* _data, const VkDeviceSize _size, const VkBuffer& _dstBuffer, const VkDeviceSize _dstOffset)
+{
+	StagingAllocation staging = m_StagingRing.Allocate(_size, 4);
+	memcpy(staging.pData, _data, static_cast<size_t>(_size));
+
+	VkBufferCopy bufferRegion{};
+	bufferRegion.srcOffset = staging.offset;
+	bufferRegion.dstOffset = _dstOffset;
+	bufferRegion.size = _size;
+	m_UploadManager.CopyBuffer(staging.buffer, _dstBuffer, bufferRegion);
+}
+
+void VulkanUtilities::UploadToImage(const void* _data, const VkDeviceSize _size, const VkImage& _dstImage, const VkExtent2D& _imageDimensions, const uint32_t _mipLevel)
+{
+	// Buffer offsets for image copies must be a multiple of the texel size, 16 covers every format we upload
+	const VkDeviceSize alignment = std::max<VkDeviceSize>(16, m_MainDevice->physicalDeviceProperties.limits.optimalBufferCopyOffsetAlignment);
+
+	StagingAllocation staging = m_StagingRing.Allocate(_size, alignment);
+	memcpy(staging.pData, _data, static_cast<size_t>(_size));
+
+	VkBufferImageCopy imageRegion{};
+	imageRegion.bufferOffset = staging.offset;
+	imageRegion.bufferRowLength = 0;
+	imageRegion.bufferImageHeight = 0;
+	imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageRegion.imageSubresource.mipLevel = _mipLevel;
+	imageRegion.imageSubresource.baseArrayLayer = 0;
+	imageRegion.imageSubresource.layerCount = 1;
+	imageRegion.imageOffset = { 0, 0, 0 };
+	imageRegion.imageExtent = { _imageDimensions.width, _imageDimensions.height, 1 };
+	m_UploadManager.CopyBufferToImage(staging.buffer, _dstImage, imageRegion);
+}
+
+void VulkanUtilities::CopyImageToBuffer(const VkImage& _srcImage, const VkBuffer& _dstBuffer, const VkExtent2D& _imageDimensions)
+{
+	VkCommandBuffer transferCommandBuffer{};
+	BeginCommandBuffer(&transferCommandBuffer);
+
+	// Copy image - buffer
+	// Configure image region to copy from (tightly packed in the buffer)
+	VkBufferImageCopy imageRegion{};
+	imageRegion.bufferOffset = 0;
+	imageRegion.bufferRowLength = 0;
+	imageRegion.bufferImageHeight = 0;
+	imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageRegion.imageSubresource.mipLevel = 0;
+	imageRegion.imageSubresource.baseArrayLayer = 0;
+	imageRegion.imageSubresource.layerCount = 1;
+	imageRegion.imageOffset = { 0, 0, 0 };
+	imageRegion.imageExtent = { _imageDimensions.width, _imageDimensions.height, 1 };
+	vkCmdCopyImageToBuffer(transferCommandBuffer, _srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _dstBuffer, 1, &imageRegion);
 
 	EndCommandBuffer(&transferCommandBuffer);
 	SubmitCommandBuffer(&transferCommandBuffer);
@@ -277,57 +424,56 @@ void VulkanUtilities::CopyBufferToImage(VkBuffer& _srcBuffer, VkImage& _dstImage
 	vkFreeCommandBuffers(m_MainDevice->device, *m_MainDevice->queueFamilyIndices.commandPool, 1, &transferCommandBuffer);
 }
 
-void VulkanUtilities::MapMemory(const VkDeviceMemory& _memoryToMap, const VkDeviceSize& _sizeOfMemory, void** _pData)
+void VulkanUtilities::MapMemory(const MemoryAllocation& _memoryToMap, void** _pData)
 {
-	vkMapMemory(m_MainDevice->device, _memoryToMap, 0, _sizeOfMemory, 0, _pData);
+	// Host visible blocks are persistently mapped by the allocator
+	if (!_memoryToMap.pMapped) throw std::runtime_error("VULKAN ERROR: Failed to map memory that isn't host visible\n");
+
+	*_pData = _memoryToMap.pMapped;
 }
 
-void VulkanUtilities::UnmapMemory(const VkDeviceMemory& _memoryToUnmap)
+void VulkanUtilities::TransitionImageLayout(const VkImage& _image, const VkImageLayout& _oldLayout, const VkImageLayout& _newLayout, const VkPipelineStageFlagBits _startStage, const VkPipelineStageFlagBits _endStage, const uint32_t _mipLevels)
 {
-	vkUnmapMemory(m_MainDevice->device, _memoryToUnmap);
+	m_UploadManager.TransitionImageLayout(_image, _oldLayout, _newLayout, _startStage, _endStage, _mipLevels);
 }
 
-void VulkanUtilities::TransitionImageLayout(const VkImage& _image, const VkImageLayout& _oldLayout, const VkImageLayout& _newLayout, const VkPipelineStageFlagBits _startStage, const VkPipelineStageFlagBits _endStage)
+bool VulkanUtilities::CanBlitMipmaps(const VkFormat _format)
 {
-	VkCommandBuffer transitionCommandBuffer;
-	BeginCommandBuffer(&transitionCommandBuffer);
+	// Uploads recorded for a dedicated transfer queue can't contain blits
+	if (m_UploadManager.UsesTransferQueue()) return false;
 
-	VkImageMemoryBarrier imageMemoryBarrier{};
-	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	imageMemoryBarrier.oldLayout = _oldLayout;										// Layout to transition from
-	imageMemoryBarrier.newLayout = _newLayout;										// Layout to transition to
-	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;				// Queue family to transition from
-	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;				// Queue family to transition to
-	imageMemoryBarrier.image = _image;												// Image to be modified by memory barrier
-	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;		// Aspect of image being altered
-	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;							// First mip level to start alterations on
-	imageMemoryBarrier.subresourceRange.levelCount = 1;								// Number of mip levels to alter starting from baseMipLevel
-	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;							// First layer to start alterations on
-	imageMemoryBarrier.subresourceRange.layerCount = 1;								// Number of layers to alter starting from base baseArrayLayer
+	VkFormatProperties formatProperties{};
+	vkGetPhysicalDeviceFormatProperties(m_MainDevice->physicalDevice, _format, &formatProperties);
 
-	if (_oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && _newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		imageMemoryBarrier.srcAccessMask = 0;								// Memory access stage transition must happen after...
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;	// Memory access stage transition must happen before...
-	}
-	else if (_oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && _newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	}
-	
-	vkCmdPipelineBarrier
-	(
-		transitionCommandBuffer, 
-		_startStage, _endStage,							// Pipeline stages (match to src and dst AccessMasks)
-		0,												// Dependency flags
-		0, nullptr,										// Memory Barrier count + data
-		0, nullptr,										// Buffer Memory Barrier count + data
-		1, &imageMemoryBarrier							// Image Memory Barrier count + data
-	);
-
-	EndCommandBuffer(&transitionCommandBuffer);
-	SubmitCommandBuffer(&transitionCommandBuffer);
-
-	vkFreeCommandBuffers(m_MainDevice->device, *m_MainDevice->queueFamilyIndices.commandPool, 1, &transitionCommandBuffer);
+	const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
+bool VulkanUtilities::SupportsSampledFormat(const VkFormat _format)
+{
+	// BC formats need the feature, which the device enables whenever it's supported
+	const bool blockCompressed = _format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && _format <= VK_FORMAT_BC7_SRGB_BLOCK;
+	if (blockCompressed && !m_MainDevice->physicalDeviceFeatures.textureCompressionBC) return false;
+
+	VkFormatProperties formatProperties{};
+	vkGetPhysicalDeviceFormatProperties(m_MainDevice->physicalDevice, _format, &formatProperties);
+
+	const VkFormatFeatureFlags sampleFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+	return (formatProperties.optimalTilingFeatures & sampleFeatures) == sampleFeatures;
+}
+
+void VulkanUtilities::GenerateMipmaps(const VkImage& _image, const VkExtent2D& _dimensions, const uint32_t _mipLevels)
+{
+	m_UploadManager.GenerateMipmaps(_image, _dimensions, _mipLevels);
+}
+
+bool VulkanUtilities::CanCopyImagesInUse()
+{
+	// A transfer queue can't order its copies against the graphics queue's frames, or change a layout they sample in
+	return !m_UploadManager.UsesTransferQueue();
 }
+
+void VulkanUtilities::CopyImageLevels(const VkImage& _srcImage, const uint32_t _srcFirstLevel, const VkImage& _dstImage, const VkExtent2D& _dstDimensions, const uint32_t _levelCount)
+{
+	m_UploadManager.CopyImageLevels(_srcImage, _srcFirstLevel, _dstImage, _dstDimensions, _levelCount);
+}
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUploadManager.h"
+#include "VulkanStagingRing.h"
 
 struct MainDevice;
 struct SwapchainInfo;
@@ -10,14 +13,21 @@ struct CustomImage
 {
 	VkImage image;
 	VkImageView imageView;
-	VkDeviceMemory imageMemory;
+	MemoryAllocation imageMemory;
 	VkFormat imageFormat;
 };
 
 struct UniformBuffer
 {
 	VkBuffer buffer;
-	VkDeviceMemory bufferMemory;
+	MemoryAllocation bufferMemory;
+};
+
+// Summed over the device local heaps
+struct DeviceMemoryBudget
+{
+	VkDeviceSize budget;		// What the process can allocate before the driver starts evicting or failing
+	VkDeviceSize usage;			// Allocated by the process
 };
 
 struct BufferInfo
@@ -26,35 +36,57 @@ struct BufferInfo
 	VkBufferUsageFlags bufferUsage; 
 	VkMemoryPropertyFlags memoryProperties;
 	VkBuffer* pBuffer; 
-	VkDeviceMemory* pBufferMemory;
+	MemoryAllocation* pBufferMemory;
 };
 
 class VulkanUtilities
 {
 public:
 	static void Initialize(const MainDevice* _mainDevice);
+	static void CleanUp();
 	static const VkDevice* GetDevice();
 	static void CheckRequiredInstanceExtensions(const std::vector<const char*>& _requiredInstanceExtensions);
 	static void CheckRequiredLayers(const std::vector<const char*>& _requiredLayers);
 	static void CreateBuffer(BufferInfo& _bufferInfo);
-	static void DestroyBuffer(const VkBuffer& _buffer, const VkDeviceMemory& _bufferMemory);
-	static void DestroyImage(const VkImage& _image, const VkDeviceMemory& _imageMemory);
+	static void DestroyBuffer(const VkBuffer& _buffer, const MemoryAllocation& _bufferMemory);
+	static void DestroyBufferAfterUpload(const VkBuffer& _buffer, const MemoryAllocation& _bufferMemory);
+	static void DestroyImage(const VkImage& _image, const MemoryAllocation& _imageMemory);
 	static void DestroyImageView(const VkImageView& _imageView);
 	static void CopyBuffer(VkBuffer& _srcBuffer, VkBuffer& _dstBuffer, const VkDeviceSize& _bufferSize);
 	static void CopyBufferToImage(VkBuffer& _srcBuffer, VkImage& _dstImage, const VkExtent2D& _imageDimensions);
-	static void MapMemory(const VkDeviceMemory& _memoryToMap, const VkDeviceSize& _sizeOfMemory, void** _ppData);
-	static void UnmapMemory(const VkDeviceMemory& _memoryToUnmap);
-	static void TransitionImageLayout(const VkImage& _image, const VkImageLayout& _oldLayout, const VkImageLayout& _newLayout, const VkPipelineStageFlagBits _startStage, const VkPipelineStageFlagBits _endStage);
+	static void UploadToBuffer(const void* _data, const VkDeviceSize _size, const VkBuffer& _dstBuffer, const VkDeviceSize _dstOffset = 0);
+	static void UploadToImage(const void* _data, const VkDeviceSize _size, const VkImage& _dstImage, const VkExtent2D& _imageDimensions, const uint32_t _mipLevel = 0);
+	static void CopyImageToBuffer(const VkImage& _srcImage, const VkBuffer& _dstBuffer, const VkExtent2D& _imageDimensions);
+	static void MapMemory(const MemoryAllocation& _memoryToMap, void** _ppData);
+	static void TransitionImageLayout(const VkImage& _image, const VkImageLayout& _oldLayout, const VkImageLayout& _newLayout, const VkPipelineStageFlagBits _startStage, const VkPipelineStageFlagBits _endStage, const uint32_t _mipLevels = 1);
+	static bool CanBlitMipmaps(const VkFormat _format);
+	static bool SupportsSampledFormat(const VkFormat _format);		// Optimal tiling images of the format can be uploaded to and linearly sampled
+	static void GenerateMipmaps(const VkImage& _image, const VkExtent2D& _dimensions, const uint32_t _mipLevels);
+	static bool CanCopyImagesInUse();								// Uploads share the graphics queue, so CopyImageLevels can read images frames are sampling
+	static void CopyImageLevels(const VkImage& _srcImage, const uint32_t _srcFirstLevel, const VkImage& _dstImage, const VkExtent2D& _dstDimensions, const uint32_t _levelCount);
 	static void GetSwapchainInfo(const VkPhysicalDevice& _physicalDevice, const VkSurfaceKHR& _surface, SwapchainInfo& _swapchainInfo);
+	static VkDeviceSize PadUniformBufferSize(const VkDeviceSize _size);
+	static VkDeviceSize PadStorageBufferSize(const VkDeviceSize _size);
 	static uint32_t FindMemoryIndex(const uint32_t _memoryTypeBits, const VkMemoryPropertyFlags& _memoryProperties);
 	static VkShaderModule CreateShaderModule(const std::vector<char>& _shaderCode);
-	static CustomImage CreateImage(const VkExtent2D& _dimensions, const VkFormat _format, const VkImageUsageFlags _usage, const VkMemoryPropertyFlags _memoryProperty);
+	static CustomImage CreateImage(const VkExtent2D& _dimensions, const VkFormat _format, const VkImageUsageFlags _usage, const VkMemoryPropertyFlags _memoryProperty, const uint32_t _mipLevels = 1);
+	static MemoryStats GetMemoryStats();
+	static DeviceMemoryBudget GetDeviceMemoryBudget();		// Heap sizes and this allocator's bytes without VK_EXT_memory_budget
+	static UploadTicket FlushUploads();
+	static bool IsUploadComplete(const UploadTicket _ticket);
+	static void WaitForUpload(const UploadTicket _ticket);
+	static StagingStats GetStagingStats();
+	static void EndStagingFrame();
 
 private:
 	static void BeginCommandBuffer(VkCommandBuffer* _commandBuffer);
 	static void EndCommandBuffer(VkCommandBuffer* _commandBuffer);
 	static void SubmitCommandBuffer(VkCommandBuffer* _commandBuffer);
+	static void SetUploadSharingMode(const bool _isUploadTarget, VkSharingMode& _sharingMode, uint32_t& _queueFamilyIndexCount, const uint32_t*& _pQueueFamilyIndices);
 
 private:
 	static const MainDevice* m_MainDevice;
+	static VulkanMemoryAllocator m_MemoryAllocator;
+	static VulkanUploadManager m_UploadManager;
+	static VulkanStagingRing m_StagingRing;
 };
\ No newline at end of file
@@ -1,12 +1,39 @@
 #include "Window.h"
+#include "Benchmark.h"
+#include "BvhBenchmark.h"
+#include "TextureCooker.h"
 #include "Events/EventHandler.h"
 #include "Vulkan/VulkanRenderer.h"
 #include <iostream>
 
-int main()
+int main(int argc, char* argv[])
 {
 	try
 	{
+		// The BVH benchmark is CPU only
+		if (BvhBenchmark::IsRequested(argc, argv))
+		{
+			BvhBenchmark benchmark(BvhBenchmark::ParseArguments(argc, argv));
+			benchmark.Run();
+			return 0;
+		}
+
+		// Cooking textures is CPU only too
+		if (TextureCooker::IsRequested(argc, argv))
+		{
+			TextureCooker cooker(TextureCooker::ParseArguments(argc, argv));
+			cooker.Run();
+			return 0;
+		}
+
+		// Benchmarks render headless with a scripted camera, so no window is created
+		if (Benchmark::IsRequested(argc, argv))
+		{
+			Benchmark benchmark(Benchmark::ParseArguments(argc, argv));
+			benchmark.Run();
+			return 0;
+		}
+
 		Window window(800, 600, "Game");
 		VulkanRenderer renderer(&window);
 		EventHandler eventHandler(window.GetWindow());